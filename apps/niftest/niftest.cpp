@@ -3,8 +3,15 @@
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
+#include <map>
+#include <memory>
+
+#include <osg/Timer>
 
 #include <components/nif/niffile.hpp>
+#include <components/nif/node.hpp>
+#include <components/nif/data.hpp>
+#include <components/sceneutil/skinning.hpp>
 #include <components/files/constrainedfilestream.hpp>
 #include <components/vfs/manager.hpp>
 #include <components/vfs/bsaarchive.hpp>
@@ -43,10 +50,171 @@ bool isBSA(std::string filename)
     return hasExtension(filename,"bsa");
 }
 
+/// Collects the skinned meshes of all checked files, and measures how long each skinning kernel takes to skin them.
+class SkinningBenchmark
+{
+public:
+    SkinningBenchmark()
+        : mNumVertices(0)
+    {
+    }
+
+    void addFile(const Nif::NIFFile& nif)
+    {
+        for (size_t i=0; i<nif.numRecords(); ++i)
+        {
+            const Nif::NiTriShape* shape = dynamic_cast<const Nif::NiTriShape*>(nif.getRecord(i));
+            if (!shape || shape->data.empty() || shape->skin.empty() || shape->skin->data.empty())
+                continue;
+            addShape(shape->data.getPtr(), shape->skin->data.getPtr());
+        }
+    }
+
+    void run(int iterations)
+    {
+        std::cout << "Skinning " << mMeshes.size() << " meshes with " << mNumVertices << " vertices, "
+                  << iterations << " iterations" << std::endl;
+
+        double scalarTime = run(iterations, SceneUtil::SkinnedVertices::Kernel_Scalar);
+        std::cout << "  scalar: " << scalarTime << " ms" << std::endl;
+
+        if (!SceneUtil::SkinnedVertices::isKernelSupported(SceneUtil::SkinnedVertices::Kernel_SSE))
+        {
+            std::cout << "  SSE: not supported by this build" << std::endl;
+            return;
+        }
+        double sseTime = run(iterations, SceneUtil::SkinnedVertices::Kernel_SSE);
+        std::cout << "  SSE: " << sseTime << " ms";
+        if (sseTime > 0)
+            std::cout << " (" << scalarTime / sseTime << "x)";
+        std::cout << std::endl;
+    }
+
+private:
+    struct Mesh
+    {
+        SceneUtil::SkinnedVertices mVertices;
+        std::vector<osg::Matrixf> mMatrices; // one per group
+        osg::ref_ptr<osg::Vec3Array> mPositions;
+        osg::ref_ptr<osg::Vec3Array> mNormals;
+    };
+
+    std::vector<Mesh> mMeshes;
+    size_t mNumVertices;
+
+    void addShape(const Nif::NiTriShapeData* data, const Nif::NiSkinData* skin)
+    {
+        // group vertices by their bone influences, like SceneUtil::RigGeometry does
+        typedef std::vector<std::pair<size_t, float> > Influences;
+        std::map<unsigned short, Influences> vertexInfluences;
+        for (size_t bone=0; bone<skin->bones.size(); ++bone)
+        {
+            const std::vector<Nif::NiSkinData::VertWeight>& weights = skin->bones[bone].weights;
+            for (std::vector<Nif::NiSkinData::VertWeight>::const_iterator it = weights.begin(); it != weights.end(); ++it)
+            {
+                if (it->vertex < data->vertices.size())
+                    vertexInfluences[it->vertex].push_back(std::make_pair(bone, it->weight));
+            }
+        }
+
+        std::map<Influences, std::vector<unsigned short> > groups;
+        for (std::map<unsigned short, Influences>::const_iterator it = vertexInfluences.begin(); it != vertexInfluences.end(); ++it)
+            groups[it->second].push_back(it->first);
+
+        if (groups.empty())
+            return;
+
+        mMeshes.push_back(Mesh());
+        Mesh& mesh = mMeshes.back();
+        mesh.mPositions = new osg::Vec3Array(data->vertices.begin(), data->vertices.end());
+        if (data->normals.size() == data->vertices.size())
+            mesh.mNormals = new osg::Vec3Array(data->normals.begin(), data->normals.end());
+
+        for (std::map<Influences, std::vector<unsigned short> >::const_iterator it = groups.begin(); it != groups.end(); ++it)
+        {
+            mesh.mVertices.addGroup(it->second, mesh.mPositions, mesh.mNormals, NULL);
+            // the bone's bind transformation is as good as any matrix for timing purposes
+            mesh.mMatrices.push_back(skin->bones[it->first.front().first].trafo.toMatrix());
+            mNumVertices += it->second.size();
+        }
+    }
+
+    /// @return the time in milliseconds
+    double run(int iterations, SceneUtil::SkinnedVertices::Kernel kernel)
+    {
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        for (int i=0; i<iterations; ++i)
+        {
+            for (std::vector<Mesh>::iterator mesh = mMeshes.begin(); mesh != mMeshes.end(); ++mesh)
+            {
+                for (unsigned int group=0; group<mesh->mVertices.getNumGroups(); ++group)
+                    mesh->mVertices.transform(group, mesh->mMatrices[group], mesh->mPositions, mesh->mNormals, NULL, kernel);
+            }
+        }
+        return osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+    }
+};
+
+/// Measures how long each file takes to parse, to benchmark the NIF reader.
+class ParseTimer
+{
+public:
+    ParseTimer()
+        : mNumFiles(0)
+        , mTotalBytes(0)
+        , mTotalTime(0.0)
+    {
+    }
+
+    void addFile(const std::string& name, size_t bytes, double milliseconds)
+    {
+        std::cout << name << ": " << bytes / 1024.0 << " KiB in " << milliseconds << " ms"
+                  << " (" << getThroughput(bytes, milliseconds) << " MiB/s)" << std::endl;
+        ++mNumFiles;
+        mTotalBytes += bytes;
+        mTotalTime += milliseconds;
+    }
+
+    void report() const
+    {
+        std::cout << "Parsed " << mNumFiles << " files, " << mTotalBytes / (1024.0 * 1024.0) << " MiB in " << mTotalTime << " ms"
+                  << " (" << getThroughput(mTotalBytes, mTotalTime) << " MiB/s)" << std::endl;
+    }
+
+private:
+    static double getThroughput(size_t bytes, double milliseconds)
+    {
+        if (milliseconds <= 0)
+            return 0;
+        return bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0);
+    }
+
+    size_t mNumFiles;
+    size_t mTotalBytes;
+    double mTotalTime;
+};
+
+/// Parse a nif file, and pass it on to the optional benchmarks
+void readNIF(Files::IStreamPtr stream, const std::string& name, SkinningBenchmark* benchmark, ParseTimer* timer)
+{
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    Nif::NIFFile nif(stream, name);
+    double milliseconds = osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick());
+
+    if (timer)
+    {
+        // the whole file has been read at this point
+        std::streamoff size = stream->tellg();
+        timer->addFile(name, size > 0 ? static_cast<size_t>(size) : 0, milliseconds);
+    }
+    if (benchmark)
+        benchmark->addFile(nif);
+}
+
 /// Check all the nif files in a given VFS::Archive
 /// \note Takes ownership!
 /// \note Can not read a bsa file inside of a bsa file.
-void readVFS(VFS::Archive* anArchive,std::string archivePath = "")
+void readVFS(VFS::Archive* anArchive, SkinningBenchmark* benchmark, ParseTimer* timer, std::string archivePath = "")
 {
     VFS::Manager myManager(true);
     myManager.addArchive(anArchive);
@@ -61,14 +229,14 @@ void readVFS(VFS::Archive* anArchive,std::string archivePath = "")
             if(isNIF(name))
             {
             //           std::cout << "Decoding: " << name << std::endl;
-                Nif::NIFFile temp_nif(myManager.get(name),archivePath+name);
+                readNIF(myManager.get(name), archivePath+name, benchmark, timer);
             }
             else if(isBSA(name))
             {
                 if(!archivePath.empty() && !isBSA(archivePath))
                 {
 //                     std::cout << "Reading BSA File: " << name << std::endl;
-                    readVFS(new VFS::BsaArchive(archivePath+name),archivePath+name+"/");
+                    readVFS(new VFS::BsaArchive(archivePath+name),benchmark,timer,archivePath+name+"/");
 //                     std::cout << "Done with BSA File: " << name << std::endl;
                 }
             }
@@ -80,7 +248,7 @@ void readVFS(VFS::Archive* anArchive,std::string archivePath = "")
     }
 }
 
-std::vector<std::string> parseOptions (int argc, char** argv)
+std::vector<std::string> parseOptions (int argc, char** argv, int& skinningIterations, bool& parseTimes)
 {
     bpo::options_description desc("Ensure that OpenMW can use the provided NIF and BSA files\n\n"
         "Usages:\n"
@@ -90,6 +258,9 @@ std::vector<std::string> parseOptions (int argc, char** argv)
     desc.add_options()
         ("help,h", "print help message.")
         ("input-file", bpo::value< std::vector<std::string> >(), "input file")
+        ("skinning-benchmark", bpo::value<int>()->implicit_value(1000),
+            "after checking, skin all meshes found the given number of times with each skinning kernel and report the time taken")
+        ("parse-times", "report the time taken to parse each file, and the overall throughput")
         ;
 
     //Default option if none provided
@@ -116,6 +287,9 @@ std::vector<std::string> parseOptions (int argc, char** argv)
         std::cout << desc << std::endl;
         exit(1);
     }
+    skinningIterations = variables.count("skinning-benchmark") ? variables["skinning-benchmark"].as<int>() : 0;
+    parseTimes = variables.count("parse-times") != 0;
+
     if (variables.count("input-file"))
     {
         return variables["input-file"].as< std::vector<std::string> >();
@@ -128,7 +302,17 @@ std::vector<std::string> parseOptions (int argc, char** argv)
 
 int main(int argc, char **argv)
 {
-    std::vector<std::string> files = parseOptions (argc, argv);
+    int skinningIterations = 0;
+    bool parseTimes = false;
+    std::vector<std::string> files = parseOptions (argc, argv, skinningIterations, parseTimes);
+
+    std::unique_ptr<SkinningBenchmark> benchmark;
+    if (skinningIterations > 0)
+        benchmark.reset(new SkinningBenchmark);
+
+    std::unique_ptr<ParseTimer> timer;
+    if (parseTimes)
+        timer.reset(new ParseTimer);
 
 //     std::cout << "Reading Files" << std::endl;
     for(std::vector<std::string>::const_iterator it=files.begin(); it!=files.end(); ++it)
@@ -139,17 +323,17 @@ int main(int argc, char **argv)
             if(isNIF(name))
             {
                 //std::cout << "Decoding: " << name << std::endl;
-                Nif::NIFFile temp_nif(Files::openConstrainedFileStream(name.c_str()),name);
+                readNIF(Files::openConstrainedFileStream(name.c_str()), name, benchmark.get(), timer.get());
              }
              else if(isBSA(name))
              {
 //                 std::cout << "Reading BSA File: " << name << std::endl;
-                readVFS(new VFS::BsaArchive(name));
+                readVFS(new VFS::BsaArchive(name), benchmark.get(), timer.get());
              }
              else if(bfs::is_directory(bfs::path(name)))
              {
 //                 std::cout << "Reading All Files in: " << name << std::endl;
-                readVFS(new VFS::FileSystemArchive(name),name);
+                readVFS(new VFS::FileSystemArchive(name), benchmark.get(), timer.get(), name);
              }
              else
              {
@@ -161,5 +345,10 @@ int main(int argc, char **argv)
             std::cerr << "ERROR, an exception has occurred:  " << e.what() << std::endl;
         }
      }
+
+     if (timer)
+         timer->report();
+     if (benchmark)
+         benchmark->run(skinningIterations);
      return 0;
 }
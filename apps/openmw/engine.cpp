@@ -25,6 +25,8 @@
 #include <components/compiler/extensions0.hpp>
 
 #include <components/sceneutil/workqueue.hpp>
+#include <components/sceneutil/skinning.hpp>
+#include <components/sceneutil/riggeometry.hpp>
 
 #include <components/files/configurationmanager.hpp>
 
@@ -187,6 +189,9 @@ void OMW::Engine::frame(float frametime)
 
             stats->setAttribute(frameNumber, "WorkQueue", mWorkQueue->getNumItems());
             stats->setAttribute(frameNumber, "WorkThread", mWorkQueue->getNumActiveThreads());
+
+            SceneUtil::WorkQueue::Stats workQueueStats = mWorkQueue->takeStats();
+            stats->setAttribute(frameNumber, "WorkQueue Wait", workQueueStats.mMaxWaitTime * 1000.0);
         }
 
     }
@@ -244,6 +249,10 @@ OMW::Engine::~Engine()
 
     mViewer = NULL;
 
+    // only after all RigGeometries are gone, since they may wait for their work items
+    SceneUtil::RigGeometry::setWorkQueue(NULL);
+    mSkinningWorkQueue = NULL;
+
     if (mWindow)
     {
         SDL_DestroyWindow(mWindow);
@@ -458,12 +467,24 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
         Settings::Manager::getString("texture mipmap", "General"),
         Settings::Manager::getInt("anisotropy", "General")
     );
+    if (Settings::Manager::getBool("mesh disk cache", "Cells"))
+        mResourceSystem->getSceneManager()->setTemplateCachePath((mCfgMgr.getCachePath() / "meshes").string());
+
+    SceneUtil::SkinnedVertices::setKernel(Settings::Manager::getBool("vectorized skinning", "General")
+                                          ? SceneUtil::SkinnedVertices::Kernel_SSE : SceneUtil::SkinnedVertices::Kernel_Scalar);
 
     int numThreads = Settings::Manager::getInt("preload num threads", "Cells");
     if (numThreads <= 0)
         throw std::runtime_error("Invalid setting: 'preload num threads' must be >0");
     mWorkQueue = new SceneUtil::WorkQueue(numThreads);
 
+    int numSkinningThreads = Settings::Manager::getInt("skinning num threads", "General");
+    if (numSkinningThreads > 0)
+    {
+        mSkinningWorkQueue = new SceneUtil::WorkQueue(numSkinningThreads);
+        SceneUtil::RigGeometry::setWorkQueue(mSkinningWorkQueue);
+    }
+
     // Create input and UI first to set up a bootstrapping environment for
     // showing a loading screen and keeping the window responsive while doing so
 
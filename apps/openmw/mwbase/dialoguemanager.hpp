@@ -44,6 +44,9 @@ namespace MWBase
 
             virtual void startDialogue (const MWWorld::Ptr& actor) = 0;
 
+            /// The actor of the current dialogue, or of the last one if no dialogue is open.
+            virtual const MWWorld::Ptr& getActor() const = 0;
+
             virtual void addTopic (const std::string& topic) = 0;
 
             virtual void askQuestion (const std::string& question,int choice) = 0;
@@ -90,8 +90,9 @@ namespace MWBase
             virtual void setPlayerClass (const ESM::Class& class_) = 0;
             ///< Set player class to custom class.
 
-            virtual void rest(bool sleep) = 0;
-            ///< If the player is sleeping or waiting, this should be called every hour.
+            virtual void rest(float hours, bool sleep) = 0;
+            ///< If the player is sleeping or waiting, this should be called before advancing the game time.
+            /// @param hours may be more than one, e.g. for the whole period of a jail sentence
             /// @param sleep is the player sleeping or waiting?
 
             virtual int getHoursToRest() const = 0;
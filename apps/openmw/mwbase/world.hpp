@@ -52,6 +52,7 @@ namespace MWRender
 namespace MWMechanics
 {
     struct Movement;
+    class ExteriorPathgridGraph;
 }
 
 namespace MWWorld
@@ -141,6 +142,9 @@ namespace MWBase
 
             virtual bool isCellQuasiExterior() const = 0;
 
+            virtual const MWMechanics::ExteriorPathgridGraph& getExteriorPathgridGraph() const = 0;
+            ///< Pathgrid graph spanning all active exterior cells
+
             virtual osg::Vec2f getNorthVector (const MWWorld::CellStore* cell) = 0;
             ///< get north vector for given interior cell
 
@@ -506,6 +510,10 @@ namespace MWBase
             virtual void teleportToClosestMarker (const MWWorld::Ptr& ptr,
                                                   const std::string& id) = 0;
 
+            /// Find the reference of \a id that teleportToClosestMarker() would teleport \a ptr to.
+            /// @note id must be lower case
+            virtual MWWorld::ConstPtr getClosestMarker (const MWWorld::Ptr& ptr, const std::string& id) = 0;
+
             enum DetectionType
             {
                 Detect_Enchantment,
@@ -79,6 +79,11 @@ namespace MWDialogue
         mPermanentDispositionChange = 0;
     }
 
+    const MWWorld::Ptr& DialogueManager::getActor() const
+    {
+        return mActor;
+    }
+
     void DialogueManager::addTopic (const std::string& topic)
     {
         mKnownTopics.insert( Misc::StringUtils::lowerCase(topic) );
@@ -176,8 +176,7 @@ namespace MWGui
         MWBase::Environment::get().getDialogueManager()->goodbyeSelected();
 
         // advance time
-        MWBase::Environment::get().getMechanicsManager()->rest(false);
-        MWBase::Environment::get().getMechanicsManager()->rest(false);
+        MWBase::Environment::get().getMechanicsManager()->rest(2, false);
         MWBase::Environment::get().getWorld ()->advanceTime (2);
 
         mProgressBar.setVisible(true);
@@ -20,6 +20,7 @@
 #include "../mwmechanics/creaturestats.hpp"
 #include "../mwmechanics/npcstats.hpp"
 #include "../mwmechanics/actorutil.hpp"
+#include "../mwmechanics/spellcasting.hpp"
 
 #include "../mwstate/charactermanager.hpp"
 
@@ -55,6 +56,7 @@ namespace MWGui
         , mSleeping(false)
         , mHours(1)
         , mManualHours(1)
+        , mPendingHours(0)
         , mFadeTimeRemaining(0)
         , mInterruptAt(-1)
         , mProgressBar()
@@ -143,6 +145,7 @@ namespace MWGui
         setVisible(false);
 
         mHours = hoursToWait;
+        mPendingHours = 0;
 
         // FIXME: move this somewhere else?
         mInterruptAt = -1;
@@ -189,16 +192,32 @@ namespace MWGui
     void WaitDialog::onWaitingProgressChanged(int cur, int total)
     {
         mProgressBar.setProgress(cur, total);
-        MWBase::Environment::get().getMechanicsManager()->rest(mSleeping);
-        MWBase::Environment::get().getWorld()->advanceTime(1);
+        ++mPendingHours;
 
+        // The game is paused while waiting, so the hours can be simulated all at once when waiting ends.
+        // Only magic effects could kill the player in the meantime, then waiting has to stop in the hour of death.
         MWWorld::Ptr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
+        if (!MWMechanics::hasTickingEffects(player.getClass().getCreatureStats(player).getMagicEffects()))
+            return;
+
+        passPendingHours();
         if (player.getClass().getCreatureStats(player).isDead())
             stopWaiting();
     }
 
+    void WaitDialog::passPendingHours()
+    {
+        if (mPendingHours <= 0)
+            return;
+
+        MWBase::Environment::get().getMechanicsManager()->rest(static_cast<float>(mPendingHours), mSleeping);
+        MWBase::Environment::get().getWorld()->advanceTime(mPendingHours);
+        mPendingHours = 0;
+    }
+
     void WaitDialog::onWaitingInterrupted()
     {
+        passPendingHours();
         MWBase::Environment::get().getWindowManager()->messageBox("#{sSleepInterrupt}");
         MWBase::Environment::get().getWorld()->spawnRandomCreature(mInterruptCreatureList);
         stopWaiting();
@@ -262,6 +281,7 @@ namespace MWGui
 
     void WaitDialog::stopWaiting ()
     {
+        passPendingHours();
         MWBase::Environment::get().getWindowManager()->fadeScreenIn(0.2f);
         mProgressBar.setVisible (false);
         MWBase::Environment::get().getWindowManager()->removeGuiMode (GM_Rest);
@@ -272,6 +292,7 @@ namespace MWGui
 
     void WaitDialog::wakeUp ()
     {
+        passPendingHours();
         mSleeping = false;
         mTimeAdvancer.stop();
         stopWaiting();
@@ -52,6 +52,7 @@ namespace MWGui
         bool mSleeping;
         int mHours;
         int mManualHours; // stores the hours to rest selected via slider
+        int mPendingHours; // hours shown as passed by the progress bar, but not simulated yet
         float mFadeTimeRemaining;
 
         int mInterruptAt;
@@ -72,6 +73,9 @@ namespace MWGui
 
         void startWaiting(int hoursToWait);
         void stopWaiting();
+
+        /// Simulate the hours that passed since the last call in a single step.
+        void passPendingHours();
     };
 
 }
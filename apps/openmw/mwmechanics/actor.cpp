@@ -25,4 +25,9 @@ namespace MWMechanics
         return mAiState;
     }
 
+    AiScheduleState& Actor::getAiScheduleState()
+    {
+        return mAiScheduleState;
+    }
+
 }
@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "aistate.hpp"
+#include "aischeduler.hpp"
 
 namespace MWRender
 {
@@ -31,10 +32,13 @@ namespace MWMechanics
 
         AiState& getAiState();
 
+        AiScheduleState& getAiScheduleState();
+
     private:
         std::unique_ptr<CharacterController> mCharacterController;
 
         AiState mAiState;
+        AiScheduleState mAiScheduleState;
     };
 
 }
@@ -2,6 +2,7 @@
 
 #include <typeinfo>
 #include <iostream>
+#include <cmath>
 
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
@@ -442,17 +443,13 @@ namespace MWMechanics
         if (creatureStats.isDead())
             return;
 
-        MagicEffects now = creatureStats.getSpells().getMagicEffects();
-
+        const MagicEffects* equipment = NULL;
         if (creature.getTypeName()==typeid (ESM::NPC).name())
-        {
-            MWWorld::InventoryStore& store = creature.getClass().getInventoryStore (creature);
-            now += store.getMagicEffects();
-        }
-
-        now += creatureStats.getActiveSpells().getMagicEffects();
+            equipment = &creature.getClass().getInventoryStore (creature).getMagicEffects();
 
-        creatureStats.modifyMagicEffects(now);
+        // only recalculated if one of the sources changed, e.g. a spell was added or expired or equipment changed
+        creatureStats.updateMagicEffects(creatureStats.getSpells().getMagicEffects(), equipment,
+                                         creatureStats.getActiveSpells().getMagicEffects());
     }
 
     void Actors::calculateDynamicStats (const MWWorld::Ptr& ptr)
@@ -478,7 +475,7 @@ namespace MWMechanics
         creatureStats.setMagicka(magicka);
     }
 
-    void Actors::restoreDynamicStats (const MWWorld::Ptr& ptr, bool sleep)
+    void Actors::restoreDynamicStats (const MWWorld::Ptr& ptr, float hours, bool sleep)
     {
         if (ptr.getClass().getCreatureStats(ptr).isDead())
             return;
@@ -492,11 +489,11 @@ namespace MWMechanics
             getRestorationPerHourOfSleep(ptr, health, magicka);
 
             DynamicStat<float> stat = stats.getHealth();
-            stat.setCurrent(stat.getCurrent() + health);
+            stat.setCurrent(stat.getCurrent() + health * hours);
             stats.setHealth(stat);
 
             stat = stats.getMagicka();
-            stat.setCurrent(stat.getCurrent() + magicka);
+            stat.setCurrent(stat.getCurrent() + magicka * hours);
             stats.setMagicka(stat);
         }
 
@@ -515,7 +512,7 @@ namespace MWMechanics
         x *= fEndFatigueMult * endurance;
 
         DynamicStat<float> fatigue = stats.getFatigue();
-        fatigue.setCurrent (fatigue.getCurrent() + 3600 * x);
+        fatigue.setCurrent (fatigue.getCurrent() + 3600 * x * hours);
         stats.setFatigue (fatigue);
     }
 
@@ -1055,7 +1052,14 @@ namespace MWMechanics
         }
     }
 
-    Actors::Actors() {
+    Actors::Actors()
+        : mAiScheduler(aiProcessingDistance)
+        , mSharedSkinningDistance(std::max(0.f, Settings::Manager::getFloat("shared skinning distance", "General")))
+        , mAnimationLodDistance(std::max(0.f, Settings::Manager::getFloat("animation lod distance", "General")))
+        , mAnimationLodMaxInterval(std::max(0.f, Settings::Manager::getFloat("animation lod max update interval", "General")))
+        , mRelationshipsRevision(0)
+        , mRelationshipsValid(false)
+    {
         mTimerDisposeSummonsCorpses = 0.2f; // We should add a delay between summoned creature death and its corpse despawning
     }
 
@@ -1072,6 +1076,7 @@ namespace MWMechanics
         if (!anim)
             return;
         mActors.insert(std::make_pair(ptr, new Actor(ptr, anim)));
+        invalidateRelationships();
         if (updateImmediately)
             mActors[ptr]->getCharacterController()->update(0);
     }
@@ -1083,6 +1088,7 @@ namespace MWMechanics
         {
             delete iter->second;
             mActors.erase(iter);
+            invalidateRelationships();
         }
     }
 
@@ -1096,6 +1102,7 @@ namespace MWMechanics
 
             actor->updatePtr(ptr);
             mActors.insert(std::make_pair(ptr, actor));
+            invalidateRelationships();
         }
     }
 
@@ -1108,6 +1115,7 @@ namespace MWMechanics
             {
                 delete iter->second;
                 mActors.erase(iter++);
+                invalidateRelationships();
             }
             else
                 ++iter;
@@ -1135,7 +1143,7 @@ namespace MWMechanics
 
             /// \todo move update logic to Actor class where appropriate
 
-            std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> > cachedAllies; // will be filled as engageCombat iterates
+            mAiScheduler.beginFrame(player);
 
              // AI and magic effects update
             for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
@@ -1144,11 +1152,29 @@ namespace MWMechanics
                 // (it only does some throttling for targets beyond the "AI distance", so doesn't give any guarantees as to whether AI will be enabled or not)
                 // This distance could be made configurable later, but the setting must be marked with a big warning:
                 // using higher values will make a quest in Bloodmoon harder or impossible to complete (bug #1876)
-                bool inProcessingRange = (player.getRefData().getPosition().asVec3() - iter->first.getRefData().getPosition().asVec3()).length2()
-                        <= sqrAiProcessingDistance;
+                float sqrDist = (player.getRefData().getPosition().asVec3() - iter->first.getRefData().getPosition().asVec3()).length2();
+                bool inProcessingRange = sqrDist <= sqrAiProcessingDistance;
 
                 iter->second->getCharacterController()->setActive(inProcessingRange);
 
+                // distant creatures that aren't fighting may reuse the skinned meshes of identical creatures
+                if (mSharedSkinningDistance > 0 && !iter->first.getClass().isNpc())
+                {
+                    bool share = sqrDist > mSharedSkinningDistance*mSharedSkinningDistance
+                            && !iter->first.getClass().getCreatureStats(iter->first).getAiSequence().isInCombat();
+                    iter->second->getCharacterController()->setShareSkinning(share);
+                }
+
+                // the animation of distant actors is updated less often, the interval grows up to the AI processing distance
+                if (mAnimationLodMaxInterval > 0 && mAnimationLodDistance < aiProcessingDistance && iter->first != player)
+                {
+                    float interval = 0.f;
+                    float dist = std::sqrt(sqrDist);
+                    if (dist > mAnimationLodDistance && !iter->first.getClass().getCreatureStats(iter->first).getAiSequence().isInCombat())
+                        interval = mAnimationLodMaxInterval * std::min(1.f, (dist - mAnimationLodDistance) / (aiProcessingDistance - mAnimationLodDistance));
+                    iter->second->getCharacterController()->setAnimationUpdateInterval(interval);
+                }
+
                 if (iter->first == player)
                     iter->second->getCharacterController()->setAttackingOrSpell(MWBase::Environment::get().getWorld()->getPlayer().getAttackingOrSpell());
 
@@ -1188,7 +1214,7 @@ namespace MWMechanics
                             {
                                 if (it->first == iter->first || iter->first == player) // player is not AI-controlled
                                     continue;
-                                engageCombat(iter->first, it->first, cachedAllies, it->first == player);
+                                engageCombat(iter->first, it->first, mCachedAllies, it->first == player);
                             }
                         }
                         if (timerUpdateHeadTrack == 0)
@@ -1212,7 +1238,18 @@ namespace MWMechanics
                         {
                             CreatureStats &stats = iter->first.getClass().getCreatureStats(iter->first);
                             if (isConscious(iter->first))
-                                stats.getAiSequence().execute(iter->first, *iter->second->getCharacterController(), iter->second->getAiState(), duration);
+                            {
+                                // less important actors don't get their AI updated every frame, see AiScheduler
+                                float aiDuration = 0.f;
+                                AiScheduleState& scheduleState = iter->second->getAiScheduleState();
+                                if (mAiScheduler.beginUpdate(iter->first, scheduleState, duration, aiDuration))
+                                {
+                                    stats.getAiSequence().execute(iter->first, *iter->second->getCharacterController(), iter->second->getAiState(), aiDuration);
+                                    mAiScheduler.endUpdate(iter->first, scheduleState);
+                                }
+                                else
+                                    mAiScheduler.skipUpdate(iter->first, scheduleState);
+                            }
 
                             if (stats.getAiSequence().isInCombat() && !stats.isDead()) hostilesCount++;
                         }
@@ -1384,6 +1421,7 @@ namespace MWMechanics
                     // Actor has been resurrected. Notify the CharacterController and re-enable collision.
                     MWBase::Environment::get().getWorld()->enableActorCollision(iter->first, true);
                     iter->second->getCharacterController()->resurrect();
+                    mCachedAllies.clear();
                 }
 
                 if(!stats.isDead())
@@ -1393,6 +1431,9 @@ namespace MWMechanics
             CharacterController::KillResult killResult = iter->second->getCharacterController()->kill();
             if (killResult == CharacterController::Result_DeathAnimStarted)
             {
+                // Dead actors no longer side with anyone
+                mCachedAllies.clear();
+
                 // Play dying words
                 // Note: It's not known whether the soundgen tags scream, roar, and moan are reliable
                 // for NPCs since some of the npc death animation files are missing them.
@@ -1474,37 +1515,55 @@ namespace MWMechanics
         }
     }
 
-    void Actors::rest(bool sleep)
+    void Actors::rest(float hours, bool sleep)
     {
-        float duration = 3600.f / MWBase::Environment::get().getWorld()->getTimeScaleFactor();
         MWWorld::Ptr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
+        const float secondsPerHour = 3600.f / MWBase::Environment::get().getWorld()->getTimeScaleFactor();
 
         for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
         {
-            if (iter->first.getClass().getCreatureStats(iter->first).isDead())
+            CreatureStats& stats = iter->first.getClass().getCreatureStats(iter->first);
+            if (stats.isDead())
                 continue;
 
-            restoreDynamicStats(iter->first, sleep);
+            bool inProcessingRange = iter->first.getRefData().getBaseNode() &&
+                    (player.getRefData().getPosition().asVec3() - iter->first.getRefData().getPosition().asVec3()).length2() <= sqrAiProcessingDistance;
 
-            if ((!iter->first.getRefData().getBaseNode()) ||
-                    (player.getRefData().getPosition().asVec3() - iter->first.getRefData().getPosition().asVec3()).length2() > sqrAiProcessingDistance)
-                continue;
+            // Regeneration is capped at the maximum of each stat, so all hours can be restored at once unless
+            // magic effects change the stats in between. Then both are stepped hour by hour.
+            float step = hours;
+            if (inProcessingRange && hasTickingEffects(stats.getMagicEffects()))
+                step = 1.f;
 
-            adjustMagicEffects (iter->first);
-            if (iter->first.getClass().getCreatureStats(iter->first).needToRecalcDynamicStats())
-                calculateDynamicStats (iter->first);
+            for (float passed = 0.f; passed < hours && !stats.isDead(); passed += step)
+            {
+                const float stepHours = std::min(step, hours - passed);
+                restoreDynamicStats(iter->first, stepHours, sleep);
 
-            calculateCreatureStatModifiers (iter->first, duration);
-            if (iter->first.getClass().isNpc())
-                calculateNpcStatModifiers(iter->first, duration);
+                if (!inProcessingRange)
+                    continue;
 
-            MWRender::Animation* animation = MWBase::Environment::get().getWorld()->getAnimation(iter->first);
-            if (animation)
-                animation->updateEffects(duration);
+                const float duration = stepHours * secondsPerHour;
+
+                adjustMagicEffects (iter->first);
+                if (stats.needToRecalcDynamicStats())
+                    calculateDynamicStats (iter->first);
+
+                calculateCreatureStatModifiers (iter->first, duration);
+                if (iter->first.getClass().isNpc())
+                    calculateNpcStatModifiers(iter->first, duration);
+            }
 
+            if (inProcessingRange)
+            {
+                MWRender::Animation* animation = MWBase::Environment::get().getWorld()->getAnimation(iter->first);
+                if (animation)
+                    animation->updateEffects(hours * secondsPerHour);
+            }
         }
 
-        fastForwardAi();
+        // duration counters of AI packages don't depend on the stats, so they can be advanced at once
+        fastForwardAi(hours);
     }
 
     int Actors::getHoursToRest(const MWWorld::Ptr &ptr) const
@@ -1583,61 +1642,114 @@ namespace MWMechanics
         }
     }
 
-    std::list<MWWorld::Ptr> Actors::getActorsSidingWith(const MWWorld::Ptr& actor)
+    void Actors::invalidateRelationships()
     {
-        std::list<MWWorld::Ptr> list;
+        mRelationshipsValid = false;
+        mCachedAllies.clear();
+    }
+
+    void Actors::updateRelationships()
+    {
+        if (mRelationshipsValid && mRelationshipsRevision == AiSequence::getRevision())
+            return;
+
+        mRelationships = Relationships();
+        mCachedAllies.clear();
+
         for(PtrActorMap::iterator iter(mActors.begin());iter != mActors.end();++iter)
         {
-            const MWWorld::Class &cls = iter->first.getClass();
-            const CreatureStats &stats = cls.getCreatureStats(iter->first);
-            if (stats.isDead())
-                continue;
+            const AiSequence& sequence = iter->first.getClass().getCreatureStats(iter->first).getAiSequence();
 
-            // An actor counts as siding with this actor if Follow or Escort is the current AI package, or there are only Combat packages before the Follow/Escort package
-            for (std::list<MWMechanics::AiPackage*>::const_iterator it = stats.getAiSequence().begin(); it != stats.getAiSequence().end(); ++it)
+            // An actor counts as siding with the target if Follow or Escort is the current AI package, or there are only Combat packages before the Follow/Escort package
+            for (std::list<MWMechanics::AiPackage*>::const_iterator it = sequence.begin(); it != sequence.end(); ++it)
             {
-                if ((*it)->sideWithTarget() && (*it)->getTarget() == actor)
+                if ((*it)->sideWithTarget())
                 {
-                    list.push_back(iter->first);
+                    MWWorld::Ptr target = (*it)->getTarget();
+                    if (!target.isEmpty())
+                        mRelationships.mSidingWith[target].push_back(iter->first);
                     break;
                 }
                 else if ((*it)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
                     break;
             }
-            // Actors that are targeted by this actor's Follow or Escort packages also side with them
-            if (actor != getPlayer())
+
+            // An actor counts as following if AiFollow is the current AiPackage, or there are only Combat packages before the AiFollow package
+            MWWorld::Ptr followTarget;
+            for (std::list<MWMechanics::AiPackage*>::const_iterator it = sequence.begin(); it != sequence.end(); ++it)
             {
-                const CreatureStats &stats2 = actor.getClass().getCreatureStats(actor);
-                for (std::list<MWMechanics::AiPackage*>::const_iterator it2 = stats2.getAiSequence().begin(); it2 != stats2.getAiSequence().end(); ++it2)
+                if ((*it)->followTargetThroughDoors())
                 {
-                    if ((*it2)->sideWithTarget() && !(*it2)->getTarget().isEmpty())
-                    {
-                        list.push_back((*it2)->getTarget());
-                        break;
-                    }
-                    else if ((*it2)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
+                    MWWorld::Ptr target = (*it)->getTarget();
+                    if (target.isEmpty() || (!followTarget.isEmpty() && target != followTarget))
                         break;
+                    followTarget = target;
+                    mRelationships.mFollowing[target].push_back(iter->first);
+                }
+                else if ((*it)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
+                    break;
+            }
+
+            for (std::list<MWMechanics::AiPackage*>::const_iterator it = sequence.begin(); it != sequence.end(); ++it)
+            {
+                if ((*it)->getTypeId() == MWMechanics::AiPackage::TypeIdFollow)
+                {
+                    MWWorld::Ptr target = (*it)->getTarget();
+                    if (target.isEmpty())
+                        continue;
+                    mRelationships.mFollowingIndices[target].push_back(
+                                std::make_pair(iter->first, static_cast<MWMechanics::AiFollow*>(*it)->getFollowIndex()));
+                    break;
                 }
+                else if ((*it)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
+                    break;
+            }
+
+            for (std::list<MWMechanics::AiPackage*>::const_iterator it = sequence.begin(); it != sequence.end(); ++it)
+            {
+                if ((*it)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
+                    continue;
+
+                MWWorld::Ptr target = (*it)->getTarget();
+                if (target.isEmpty())
+                    continue;
+
+                std::list<MWWorld::Ptr>& fighting = mRelationships.mFighting[target];
+                if (fighting.empty() || fighting.back() != iter->first)
+                    fighting.push_back(iter->first);
             }
         }
-        return list;
+
+        mRelationshipsRevision = AiSequence::getRevision();
+        mRelationshipsValid = true;
     }
 
-    std::list<MWWorld::Ptr> Actors::getActorsFollowing(const MWWorld::Ptr& actor)
+    std::list<MWWorld::Ptr> Actors::getActorsSidingWith(const MWWorld::Ptr& actor)
     {
+        updateRelationships();
+
         std::list<MWWorld::Ptr> list;
-        for(PtrActorMap::iterator iter(mActors.begin());iter != mActors.end();++iter)
+        PtrListMap::const_iterator found = mRelationships.mSidingWith.find(actor);
+        if (found != mRelationships.mSidingWith.end())
         {
-            const MWWorld::Class &cls = iter->first.getClass();
-            CreatureStats &stats = cls.getCreatureStats(iter->first);
-            if (stats.isDead())
-                continue;
+            for (std::list<MWWorld::Ptr>::const_iterator it = found->second.begin(); it != found->second.end(); ++it)
+            {
+                if (!it->getClass().getCreatureStats(*it).isDead())
+                    list.push_back(*it);
+            }
+        }
 
-            // An actor counts as following if AiFollow is the current AiPackage, or there are only Combat packages before the AiFollow package
+        // Actors that are targeted by this actor's Follow or Escort packages also side with them
+        if (actor != getPlayer())
+        {
+            const CreatureStats &stats = actor.getClass().getCreatureStats(actor);
             for (std::list<MWMechanics::AiPackage*>::const_iterator it = stats.getAiSequence().begin(); it != stats.getAiSequence().end(); ++it)
             {
-                if ((*it)->followTargetThroughDoors() && (*it)->getTarget() == actor)
-                    list.push_back(iter->first);
+                if ((*it)->sideWithTarget() && !(*it)->getTarget().isEmpty())
+                {
+                    list.push_back((*it)->getTarget());
+                    break;
+                }
                 else if ((*it)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
                     break;
             }
@@ -1645,6 +1757,23 @@ namespace MWMechanics
         return list;
     }
 
+    std::list<MWWorld::Ptr> Actors::getActorsFollowing(const MWWorld::Ptr& actor)
+    {
+        updateRelationships();
+
+        std::list<MWWorld::Ptr> list;
+        PtrListMap::const_iterator found = mRelationships.mFollowing.find(actor);
+        if (found != mRelationships.mFollowing.end())
+        {
+            for (std::list<MWWorld::Ptr>::const_iterator it = found->second.begin(); it != found->second.end(); ++it)
+            {
+                if (!it->getClass().getCreatureStats(*it).isDead())
+                    list.push_back(*it);
+            }
+        }
+        return list;
+    }
+
     void Actors::getActorsFollowing(const MWWorld::Ptr &actor, std::set<MWWorld::Ptr>& out) {
         std::list<MWWorld::Ptr> followers = getActorsFollowing(actor);
         for(std::list<MWWorld::Ptr>::iterator it = followers.begin();it != followers.end();++it)
@@ -1660,6 +1789,9 @@ namespace MWMechanics
     }
 
     void Actors::getActorsSidingWith(const MWWorld::Ptr &actor, std::set<MWWorld::Ptr>& out, std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> >& cachedAllies) {
+        // clears the cache when an AI package changed since it was filled
+        updateRelationships();
+
         // If we have already found actor's allies, use the cache
         std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> >::const_iterator search = cachedAllies.find(actor);
         if (search != cachedAllies.end())
@@ -1684,45 +1816,37 @@ namespace MWMechanics
 
     std::list<int> Actors::getActorsFollowingIndices(const MWWorld::Ptr &actor)
     {
+        updateRelationships();
+
         std::list<int> list;
-        for(PtrActorMap::iterator iter(mActors.begin());iter != mActors.end();++iter)
+        std::map<MWWorld::Ptr, std::list<std::pair<MWWorld::Ptr, int> > >::const_iterator found = mRelationships.mFollowingIndices.find(actor);
+        if (found != mRelationships.mFollowingIndices.end())
         {
-            const MWWorld::Class &cls = iter->first.getClass();
-            CreatureStats &stats = cls.getCreatureStats(iter->first);
-            if (stats.isDead())
-                continue;
-
-            // An actor counts as following if AiFollow is the current AiPackage, or there are only Combat packages before the AiFollow package
-            for (std::list<MWMechanics::AiPackage*>::const_iterator it = stats.getAiSequence().begin(); it != stats.getAiSequence().end(); ++it)
+            for (std::list<std::pair<MWWorld::Ptr, int> >::const_iterator it = found->second.begin(); it != found->second.end(); ++it)
             {
-                if ((*it)->getTypeId() == MWMechanics::AiPackage::TypeIdFollow)
-                {
-                    MWWorld::Ptr followTarget = (*it)->getTarget();
-                    if (followTarget.isEmpty())
-                        continue;
-                    if (followTarget == actor)
-                        list.push_back(static_cast<MWMechanics::AiFollow*>(*it)->getFollowIndex());
-                    break;
-                }
-                else if ((*it)->getTypeId() != MWMechanics::AiPackage::TypeIdCombat)
-                    break;
+                if (!it->first.getClass().getCreatureStats(it->first).isDead())
+                    list.push_back(it->second);
             }
         }
         return list;
     }
 
     std::list<MWWorld::Ptr> Actors::getActorsFighting(const MWWorld::Ptr& actor) {
+        updateRelationships();
+
         std::list<MWWorld::Ptr> list;
-        std::vector<MWWorld::Ptr> neighbors;
+        PtrListMap::const_iterator found = mRelationships.mFighting.find(actor);
+        if (found == mRelationships.mFighting.end())
+            return list;
+
         osg::Vec3f position (actor.getRefData().getPosition().asVec3());
-        getObjectsInRange(position, aiProcessingDistance, neighbors);
-        for(std::vector<MWWorld::Ptr>::const_iterator iter(neighbors.begin());iter != neighbors.end();++iter)
+        for(std::list<MWWorld::Ptr>::const_iterator iter(found->second.begin());iter != found->second.end();++iter)
         {
             const MWWorld::Class &cls = iter->getClass();
             const CreatureStats &stats = cls.getCreatureStats(*iter);
             if (stats.isDead() || *iter == actor)
                 continue;
-            if (stats.getAiSequence().isInCombat(actor))
+            if ((iter->getRefData().getPosition().asVec3() - position).length2() <= sqrAiProcessingDistance)
                 list.push_front(*iter);
         }
         return list;
@@ -1783,6 +1907,7 @@ namespace MWMechanics
             it->second = NULL;
         }
         mActors.clear();
+        invalidateRelationships();
         mDeathCount.clear();
     }
 
@@ -1813,7 +1938,7 @@ namespace MWMechanics
         return ctrl->isAttackingOrSpell();
     }
 
-    void Actors::fastForwardAi()
+    void Actors::fastForwardAi(float hours)
     {
         if (!MWBase::Environment::get().getMechanicsManager()->isAIActive())
             return;
@@ -1828,7 +1953,7 @@ namespace MWMechanics
                     || ptr.getClass().getCreatureStats(ptr).isParalyzed())
                 continue;
             MWMechanics::AiSequence& seq = ptr.getClass().getCreatureStats(ptr).getAiSequence();
-            seq.fastForward(ptr, it->second->getAiState());
+            seq.fastForward(ptr, it->second->getAiState(), hours);
         }
     }
 }
@@ -10,6 +10,7 @@
 #include "../mwbase/world.hpp"
 
 #include "movement.hpp"
+#include "aischeduler.hpp"
 
 namespace MWWorld
 {
@@ -93,15 +94,18 @@ namespace MWMechanics
             void updateHeadTracking(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor,
                                             MWWorld::Ptr& headTrackTarget, float& sqrHeadTrackDistance);
 
-            void rest(bool sleep);
-            ///< Update actors while the player is waiting or sleeping. This should be called every hour.
+            void rest(float hours, bool sleep);
+            ///< Update actors while the player is waiting or sleeping. This should be called before advancing the game time.
+            /// Stats and magic effects are updated once for all hours, or hour by hour for actors with effects that change
+            /// their stats over time. The AI is fast-forwarded once for all hours.
 
-            void restoreDynamicStats(const MWWorld::Ptr& actor, bool sleep);
+            void restoreDynamicStats(const MWWorld::Ptr& actor, float hours, bool sleep);
+            ///< @param hours at most one, since the restored stats are capped while other effects may change them every hour
 
             int getHoursToRest(const MWWorld::Ptr& ptr) const;
             ///< Calculate how many hours the given actor needs to rest in order to be fully healed
 
-            void fastForwardAi();
+            void fastForwardAi(float hours);
             ///< Simulate the passing of time
 
             int countDeaths (const std::string& id) const;
@@ -154,8 +158,37 @@ namespace MWMechanics
             bool isAttackingOrSpell(const MWWorld::Ptr& ptr) const;
 
     private:
+        /// Rebuild mRelationships if actors or AI packages changed since they were last built.
+        void updateRelationships();
+
+        /// Force mRelationships and mCachedAllies to be rebuilt on the next query.
+        void invalidateRelationships();
+
         PtrActorMap mActors;
         float mTimerDisposeSummonsCorpses;
+        AiScheduler mAiScheduler;
+        float mSharedSkinningDistance;
+        float mAnimationLodDistance;
+        float mAnimationLodMaxInterval;
+
+        typedef std::map<MWWorld::Ptr, std::list<MWWorld::Ptr> > PtrListMap;
+
+        /// Relationships between actors that are derived from their AI packages, indexed by the target actor.
+        /// Built in a single pass over all actors and kept until an actor is added or removed, or an AI package
+        /// is added to or removed from any actor. Dead actors are included and have to be skipped by the queries.
+        struct Relationships
+        {
+            PtrListMap mSidingWith; ///< Actors with a current Follow or Escort package targeting the actor
+            PtrListMap mFollowing; ///< Actors with a current package following the actor through doors
+            std::map<MWWorld::Ptr, std::list<std::pair<MWWorld::Ptr, int> > > mFollowingIndices; ///< Actors with a current AiFollow package targeting the actor, and its follow index
+            PtrListMap mFighting; ///< Actors with a combat package targeting the actor
+        };
+        Relationships mRelationships;
+        unsigned int mRelationshipsRevision; ///< AiSequence::getRevision() at the time mRelationships was built
+        bool mRelationshipsValid;
+
+        /// Actors mapped to their recursive allies, filled by engageCombat and reset along with mRelationships
+        std::map<const MWWorld::Ptr, const std::set<MWWorld::Ptr> > mCachedAllies;
 
     };
 }
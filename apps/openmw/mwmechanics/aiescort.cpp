@@ -140,11 +140,11 @@ namespace MWMechanics
         sequence.mPackages.push_back(package);
     }
 
-    void AiEscort::fastForward(const MWWorld::Ptr& actor, AiState &state)
+    void AiEscort::fastForward(const MWWorld::Ptr& actor, AiState &state, float hours)
     {
         // Update duration counter if this package has a duration
         if (mDuration > 0)
-            mRemainingDuration--;
+            mRemainingDuration -= hours;
     }
 }
 
@@ -43,7 +43,7 @@ namespace MWMechanics
 
             void writeState(ESM::AiSequence::AiSequence &sequence) const;
 
-            void fastForward(const MWWorld::Ptr& actor, AiState& state);
+            void fastForward(const MWWorld::Ptr& actor, AiState& state, float hours);
 
         private:
             std::string mActorId;
@@ -269,11 +269,11 @@ int AiFollow::getFollowIndex() const
     return mFollowIndex;
 }
 
-void AiFollow::fastForward(const MWWorld::Ptr& actor, AiState &state)
+void AiFollow::fastForward(const MWWorld::Ptr& actor, AiState &state, float hours)
 {
     // Update duration counter if this package has a duration
     if (mDuration > 0)
-        mRemainingDuration--;
+        mRemainingDuration -= hours;
 }
 
 }
@@ -54,7 +54,7 @@ namespace MWMechanics
 
             int getFollowIndex() const;
 
-            void fastForward(const MWWorld::Ptr& actor, AiState& state);
+            void fastForward(const MWWorld::Ptr& actor, AiState& state, float hours);
 
         private:
             /// This will make the actor always follow.
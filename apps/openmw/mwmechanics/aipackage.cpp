@@ -298,7 +298,14 @@ bool MWMechanics::AiPackage::checkWayIsClearForActor(const ESM::Pathgrid::Point&
 
 bool MWMechanics::AiPackage::doesPathNeedRecalc(const ESM::Pathgrid::Point& newDest, const MWWorld::CellStore* currentCell)
 {
-    return mPathFinder.getPath().empty() || (distance(mPathFinder.getPath().back(), newDest) > 10) || mPathFinder.getPathCell() != currentCell;
+    if (mPathFinder.getPath().empty() || (distance(mPathFinder.getPath().back(), newDest) > 10))
+        return true;
+
+    // a path across the exterior grid does not need to be rebuilt when the actor crosses a cell border
+    if (mPathFinder.getPathCell() != currentCell)
+        return !(mPathFinder.isExteriorPath() && currentCell->isExterior());
+
+    return false;
 }
 
 bool MWMechanics::AiPackage::isTargetMagicallyHidden(const MWWorld::Ptr& target)
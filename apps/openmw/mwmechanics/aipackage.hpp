@@ -73,7 +73,8 @@ namespace MWMechanics
             virtual void writeState (ESM::AiSequence::AiSequence& sequence) const {}
 
             /// Simulates the passing of time
-            virtual void fastForward(const MWWorld::Ptr& actor, AiState& state) {}
+            /// @param hours Game hours passed, may be more than one
+            virtual void fastForward(const MWWorld::Ptr& actor, AiState& state, float hours) {}
 
             /// Get the target actor the AI is targeted at (not applicable to all AI packages, default return empty Ptr)
             virtual MWWorld::Ptr getTarget() const;
@@ -0,0 +1,110 @@
+#include "aischeduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <components/misc/rng.hpp>
+#include <components/settings/settings.hpp>
+
+#include "../mwworld/class.hpp"
+#include "../mwworld/ptr.hpp"
+
+#include "creaturestats.hpp"
+#include "movement.hpp"
+
+namespace MWMechanics
+{
+
+    AiScheduleState::AiScheduleState()
+        : mTimeSinceUpdate(0.f)
+        , mInitialOffset(Misc::Rng::rollProbability())
+    {
+        mMovement[0] = mMovement[1] = 0.f;
+    }
+
+    AiScheduler::AiScheduler(float processingDistance)
+        : mProcessingDistance(processingDistance)
+        , mFullRateDistance(std::max(0.f, Settings::Manager::getFloat("ai full rate distance", "Game")))
+        , mMaxUpdateInterval(std::max(0.f, Settings::Manager::getFloat("ai max update interval", "Game")))
+        , mBudget(std::max(0, Settings::Manager::getInt("ai update budget", "Game")))
+        , mTimeSpent(0)
+        , mUpdateStart(0)
+        , mMeasuring(false)
+    {
+    }
+
+    void AiScheduler::beginFrame(const MWWorld::Ptr& player)
+    {
+        const ESM::Position& pos = player.getRefData().getPosition();
+        mPlayerPos = pos.asVec3();
+        mPlayerDir = osg::Vec3f(std::sin(pos.rot[2]), std::cos(pos.rot[2]), 0.f);
+        mTimeSpent = 0;
+    }
+
+    float AiScheduler::getUpdateInterval(const MWWorld::Ptr& ptr) const
+    {
+        if (mMaxUpdateInterval <= 0.f || mFullRateDistance >= mProcessingDistance)
+            return 0.f;
+
+        if (ptr.getClass().getCreatureStats(ptr).getAiSequence().isInCombat())
+            return 0.f;
+
+        osg::Vec3f dir = ptr.getRefData().getPosition().asVec3() - mPlayerPos;
+        dir.z() = 0;
+        float dist = dir.length();
+        if (dist <= mFullRateDistance)
+            return 0.f;
+
+        float interval = mMaxUpdateInterval * std::min(1.f, (dist - mFullRateDistance) / (mProcessingDistance - mFullRateDistance));
+
+        // actors the player is facing are more likely to be noticed
+        if (dir * mPlayerDir > 0)
+            interval *= 0.5f;
+
+        return interval;
+    }
+
+    bool AiScheduler::beginUpdate(const MWWorld::Ptr& ptr, AiScheduleState& state, float duration, float& aiDuration)
+    {
+        state.mTimeSinceUpdate += duration;
+
+        float interval = getUpdateInterval(ptr);
+        if (interval > 0.f)
+        {
+            if (state.mTimeSinceUpdate < interval * (1.f - state.mInitialOffset))
+                return false;
+
+            bool overdue = state.mTimeSinceUpdate >= 2 * interval;
+            if (!overdue && mBudget > 0 && mTimeSpent >= mBudget)
+                return false;
+        }
+
+        aiDuration = state.mTimeSinceUpdate;
+        state.mTimeSinceUpdate = 0.f;
+        state.mInitialOffset = 0.f;
+
+        mMeasuring = (interval > 0.f && mBudget > 0);
+        if (mMeasuring)
+            mUpdateStart = osg::Timer::instance()->tick();
+        return true;
+    }
+
+    void AiScheduler::endUpdate(const MWWorld::Ptr& ptr, AiScheduleState& state)
+    {
+        if (mMeasuring)
+            mTimeSpent += osg::Timer::instance()->delta_u(mUpdateStart, osg::Timer::instance()->tick());
+        mMeasuring = false;
+
+        const Movement& movement = ptr.getClass().getMovementSettings(ptr);
+        state.mMovement[0] = movement.mPosition[0];
+        state.mMovement[1] = movement.mPosition[1];
+    }
+
+    void AiScheduler::skipUpdate(const MWWorld::Ptr& ptr, const AiScheduleState& state)
+    {
+        Movement& movement = ptr.getClass().getMovementSettings(ptr);
+        movement.mPosition[0] = state.mMovement[0];
+        movement.mPosition[1] = state.mMovement[1];
+    }
+
+}
@@ -0,0 +1,74 @@
+#ifndef GAME_MWMECHANICS_AISCHEDULER_H
+#define GAME_MWMECHANICS_AISCHEDULER_H
+
+#include <osg/Timer>
+#include <osg/Vec3f>
+
+namespace MWWorld
+{
+    class Ptr;
+}
+
+namespace MWMechanics
+{
+    /// @brief Per-actor state of the AiScheduler, held by MWMechanics::Actor.
+    struct AiScheduleState
+    {
+        AiScheduleState();
+
+        /// Time passed since the AI packages were last executed
+        float mTimeSinceUpdate;
+
+        /// Fraction of the update interval to skip for the first update, so that actors
+        /// entering the scene at the same time don't all get updated in the same frame
+        float mInitialOffset;
+
+        /// Movement requested by the AI in its last update, reapplied in frames without an update.
+        /// The rotation is a per-frame delta, so it is not reapplied.
+        float mMovement[2];
+    };
+
+    /// @brief Decides in which frames the AI packages of an actor are executed.
+    ///
+    /// Actors in combat or close to the player are updated every frame. Further away, the update
+    /// interval grows with the distance to the player, and is shorter for actors in front of the player.
+    /// Actors with a reduced update rate are only updated while the time spent on their AI in the current frame
+    /// is within the budget, unless they are already overdue. Full rate updates are not charged to the budget.
+    /// Skipped time is accumulated and passed to AiSequence::execute, so AI timers still advance by the correct amount.
+    class AiScheduler
+    {
+    public:
+        /// @param processingDistance Distance from the player at which AI processing stops
+        AiScheduler(float processingDistance);
+
+        /// Start a new frame.
+        void beginFrame(const MWWorld::Ptr& player);
+
+        /// Accumulate \a duration for the given actor and check whether its AI should be executed in this frame.
+        /// If true is returned, the actor's AI must be executed with \a aiDuration, followed by a call to endUpdate().
+        bool beginUpdate(const MWWorld::Ptr& ptr, AiScheduleState& state, float duration, float& aiDuration);
+
+        void endUpdate(const MWWorld::Ptr& ptr, AiScheduleState& state);
+
+        /// Reapply the last AI movement of an actor whose AI was not executed in this frame.
+        void skipUpdate(const MWWorld::Ptr& ptr, const AiScheduleState& state);
+
+    private:
+        float getUpdateInterval(const MWWorld::Ptr& ptr) const;
+
+        float mProcessingDistance;
+        float mFullRateDistance;
+        float mMaxUpdateInterval;
+        double mBudget; // in microseconds, 0 means unlimited
+
+        osg::Vec3f mPlayerPos;
+        osg::Vec3f mPlayerDir;
+
+        double mTimeSpent; // in microseconds
+        osg::Timer_t mUpdateStart;
+        // whether the current update is charged to the budget
+        bool mMeasuring;
+    };
+}
+
+#endif
@@ -23,8 +23,11 @@
 namespace MWMechanics
 {
 
+unsigned int AiSequence::sRevision = 0;
+
 void AiSequence::copy (const AiSequence& sequence)
 {
+    ++sRevision;
     for (std::list<AiPackage *>::const_iterator iter (sequence.mPackages.begin());
         iter!=sequence.mPackages.end(); ++iter)
         mPackages.push_back ((*iter)->clone());
@@ -106,6 +109,7 @@ void AiSequence::erase(std::list<AiPackage*>::const_iterator package)
         {
             delete *it;
             mPackages.erase(it);
+            ++sRevision;
             return;
         }
     }
@@ -153,6 +157,7 @@ void AiSequence::stopCombat()
         {
             delete *it;
             it = mPackages.erase(it);
+            ++sRevision;
         }
         else
             ++it;
@@ -167,6 +172,7 @@ void AiSequence::stopPursuit()
         {
             delete *it;
             it = mPackages.erase(it);
+            ++sRevision;
         }
         else
             ++it;
@@ -223,6 +229,7 @@ void AiSequence::execute (const MWWorld::Ptr& actor, CharacterController& charac
                 {
                     delete *it;
                     it = mPackages.erase(it);
+                    ++sRevision;
                 }
                 else
                 {
@@ -275,6 +282,7 @@ void AiSequence::execute (const MWWorld::Ptr& actor, CharacterController& charac
                         std::find(mPackages.begin(), mPackages.end(), package);
                 mPackages.erase(toRemove);
                 delete package;
+                ++sRevision;
                 if (isActualAiPackage(packageTypeId))
                     mDone = true;
             }
@@ -295,6 +303,8 @@ void AiSequence::clear()
     for (std::list<AiPackage *>::const_iterator iter (mPackages.begin()); iter!=mPackages.end(); ++iter)
         delete *iter;
 
+    if (!mPackages.empty())
+        ++sRevision;
     mPackages.clear();
 }
 
@@ -316,6 +326,7 @@ void AiSequence::stack (const AiPackage& package, const MWWorld::Ptr& actor)
             {
                 delete *it;
                 it = mPackages.erase(it);
+                ++sRevision;
             }
             else
                 ++it;
@@ -323,6 +334,8 @@ void AiSequence::stack (const AiPackage& package, const MWWorld::Ptr& actor)
         mRepeat=false;
     }
 
+    ++sRevision;
+
     // insert new package in correct place depending on priority
     for(std::list<AiPackage *>::iterator it = mPackages.begin(); it != mPackages.end(); ++it)
     {
@@ -383,6 +396,7 @@ void AiSequence::fill(const ESM::AIPackageList &list)
             package = new MWMechanics::AiFollow(data.mId.toString(), data.mDuration, data.mX, data.mY, data.mZ);
         }
         mPackages.push_back(package);
+        ++sRevision;
     }
 }
 
@@ -461,15 +475,16 @@ void AiSequence::readState(const ESM::AiSequence::AiSequence &sequence)
             continue;
 
         mPackages.push_back(package.release());
+        ++sRevision;
     }
 }
 
-void AiSequence::fastForward(const MWWorld::Ptr& actor, AiState& state)
+void AiSequence::fastForward(const MWWorld::Ptr& actor, AiState& state, float hours)
 {
     if (!mPackages.empty())
     {
         MWMechanics::AiPackage* package = mPackages.front();
-        package->fastForward(actor, state);
+        package->fastForward(actor, state, hours);
     }
 }
 
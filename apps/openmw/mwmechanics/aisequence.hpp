@@ -48,6 +48,9 @@ namespace MWMechanics
             /// The type of AI package that ran last
             int mLastAiPackage;
 
+            /// Incremented whenever packages are added to or removed from any AiSequence
+            static unsigned int sRevision;
+
         public:
             ///Default constructor
             AiSequence();
@@ -66,6 +69,10 @@ namespace MWMechanics
 
             void erase (std::list<AiPackage*>::const_iterator package);
 
+            /// Returns a counter that changes whenever packages are added to or removed from any AiSequence.
+            /** Allows caching relationships between actors that are derived from their AI packages. **/
+            static unsigned int getRevision() { return sRevision; }
+
             /// Returns currently executing AiPackage type
             /** \see enum AiPackage::TypeId **/
             int getTypeId() const;
@@ -107,7 +114,7 @@ namespace MWMechanics
             void execute (const MWWorld::Ptr& actor, CharacterController& characterController, MWMechanics::AiState& state, float duration);
 
             /// Simulate the passing of time using the currently active AI package
-            void fastForward(const MWWorld::Ptr &actor, AiState &state);
+            void fastForward(const MWWorld::Ptr &actor, AiState &state, float hours);
 
             /// Remove all packages.
             void clear();
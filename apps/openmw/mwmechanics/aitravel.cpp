@@ -67,7 +67,7 @@ namespace MWMechanics
         return TypeIdTravel;
     }
 
-    void AiTravel::fastForward(const MWWorld::Ptr& actor, AiState& state)
+    void AiTravel::fastForward(const MWWorld::Ptr& actor, AiState& state, float hours)
     {
         if (!isWithinMaxRange(osg::Vec3f(mX, mY, mZ), actor.getRefData().getPosition().asVec3()))
             return;
@@ -24,7 +24,7 @@ namespace MWMechanics
             AiTravel(const ESM::AiSequence::AiTravel* travel);
 
             /// Simulates the passing of time
-            virtual void fastForward(const MWWorld::Ptr& actor, AiState& state);
+            virtual void fastForward(const MWWorld::Ptr& actor, AiState& state, float hours);
 
             void writeState(ESM::AiSequence::AiSequence &sequence) const;
 
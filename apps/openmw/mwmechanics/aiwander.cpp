@@ -784,10 +784,13 @@ namespace MWMechanics
         return selectedAnimation;
     }
 
-    void AiWander::fastForward(const MWWorld::Ptr& actor, AiState &state)
+    void AiWander::fastForward(const MWWorld::Ptr& actor, AiState &state, float hours)
     {
         // Update duration counter
-        mRemainingDuration--;
+        mRemainingDuration -= hours;
+
+        // The destination is random and doesn't depend on the time passed, so the actor
+        // only needs to be moved once no matter how many hours are skipped
         if (mDistance == 0)
             return;
 
@@ -46,7 +46,7 @@ namespace MWMechanics
 
             virtual void writeState(ESM::AiSequence::AiSequence &sequence) const;
 
-            virtual void fastForward(const MWWorld::Ptr& actor, AiState& state);
+            virtual void fastForward(const MWWorld::Ptr& actor, AiState& state, float hours);
             
             bool getRepeat() const;
             
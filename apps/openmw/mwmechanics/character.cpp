@@ -2309,6 +2309,16 @@ void CharacterController::setActive(bool active)
     mAnimation->setActive(active);
 }
 
+void CharacterController::setShareSkinning(bool share)
+{
+    mAnimation->setShareSkinning(share);
+}
+
+void CharacterController::setAnimationUpdateInterval(float interval)
+{
+    mAnimation->setUpdateInterval(interval);
+}
+
 void CharacterController::setHeadTrackTarget(const MWWorld::ConstPtr &target)
 {
     mHeadTrackTarget = target;
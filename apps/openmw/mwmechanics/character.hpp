@@ -282,6 +282,12 @@ public:
     /// @see Animation::setActive
     void setActive(bool active);
 
+    /// @see Animation::setShareSkinning
+    void setShareSkinning(bool share);
+
+    /// @see Animation::setUpdateInterval
+    void setAnimationUpdateInterval(float interval);
+
     /// Make this character turn its head towards \a target. To turn off head tracking, pass an empty Ptr.
     void setHeadTrackTarget(const MWWorld::ConstPtr& target);
 
@@ -1,6 +1,7 @@
 #include "creaturestats.hpp"
 
 #include <algorithm>
+#include <limits>
 
 #include <components/esm/creaturestats.hpp>
 #include <components/esm/esmreader.hpp>
@@ -26,6 +27,8 @@ namespace MWMechanics
     {
         for (int i=0; i<4; ++i)
             mAiSettings[i] = 0;
+        for (int i=0; i<4; ++i)
+            mMagicEffectRevisions[i] = std::numeric_limits<size_t>::max();
     }
 
     const AiSequence& CreatureStats::getAiSequence() const
@@ -216,6 +219,26 @@ namespace MWMechanics
         mMagicEffects.setModifiers(effects);
     }
 
+    void CreatureStats::updateMagicEffects(const MagicEffects& spells, const MagicEffects* equipment, const MagicEffects& activeSpells)
+    {
+        size_t equipmentRevision = equipment ? equipment->getRevision() : 0;
+        if (mMagicEffectRevisions[0] == spells.getRevision() && mMagicEffectRevisions[1] == equipmentRevision
+                && mMagicEffectRevisions[2] == activeSpells.getRevision() && mMagicEffectRevisions[3] == mMagicEffects.getRevision())
+            return;
+
+        MagicEffects now = spells;
+        if (equipment)
+            now += *equipment;
+        now += activeSpells;
+
+        modifyMagicEffects(now);
+
+        mMagicEffectRevisions[0] = spells.getRevision();
+        mMagicEffectRevisions[1] = equipmentRevision;
+        mMagicEffectRevisions[2] = activeSpells.getRevision();
+        mMagicEffectRevisions[3] = mMagicEffects.getRevision();
+    }
+
     void CreatureStats::setAiSetting (AiSetting index, Stat<int> value)
     {
         mAiSettings[index] = value;
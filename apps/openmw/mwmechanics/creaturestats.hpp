@@ -31,6 +31,9 @@ namespace MWMechanics
         Spells mSpells;
         ActiveSpells mActiveSpells;
         MagicEffects mMagicEffects;
+        // Revisions of the effect sources (spells, equipment, active spells) and of mMagicEffects
+        // at the time the modifiers were last calculated, see updateMagicEffects()
+        size_t mMagicEffectRevisions[4];
         Stat<int> mAiSettings[4];
         AiSequence mAiSequence;
         bool mDead;
@@ -138,6 +141,11 @@ namespace MWMechanics
         /// Set Modifier for each magic effect according to \a effects. Does not touch Base values.
         void modifyMagicEffects(const MagicEffects &effects);
 
+        /// Set Modifier for each magic effect to the sum of the given sources. Nothing is done if neither the
+        /// sources nor the magic effects of this actor changed since the last call.
+        /// @param equipment May be NULL for actors without an inventory store.
+        void updateMagicEffects(const MagicEffects& spells, const MagicEffects* equipment, const MagicEffects& activeSpells);
+
         void setAttackingOrSpell(bool attackingOrSpell);
 
         void setLevel(int level);
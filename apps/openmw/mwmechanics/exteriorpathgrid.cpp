@@ -0,0 +1,398 @@
+#include "exteriorpathgrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include <components/esm/loadland.hpp>
+
+#include "../mwbase/world.hpp"
+#include "../mwbase/environment.hpp"
+
+#include "../mwworld/cellstore.hpp"
+#include "../mwworld/esmstore.hpp"
+
+#include "pathfinding.hpp"
+#include "coordinateconverter.hpp"
+
+namespace
+{
+    // Pathgrid points of neighbouring cells closer than this are joined. Most pathgrids place
+    // points a few hundred units apart, and often leave a gap at the cell border.
+    const float sMaxLinkDistance = 1536.f;
+
+    // Distance (ignoring z) from a point to the bounds of the exterior cell at cellX, cellY
+    float distanceToCell(const ESM::Pathgrid::Point& point, int cellX, int cellY)
+    {
+        const float cellSize = static_cast<float>(ESM::Land::REAL_SIZE);
+        float minX = cellX * cellSize;
+        float minY = cellY * cellSize;
+        float dx = std::max(0.f, std::max(minX - point.mX, point.mX - (minX + cellSize)));
+        float dy = std::max(0.f, std::max(minY - point.mY, point.mY - (minY + cellSize)));
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    int findRoot(std::vector<int>& parents, int node)
+    {
+        while (parents[node] != node)
+        {
+            parents[node] = parents[parents[node]];
+            node = parents[node];
+        }
+        return node;
+    }
+
+    template <typename Link>
+    bool compareLinkSource(const Link& left, const Link& right)
+    {
+        return left.mFrom < right.mFrom;
+    }
+}
+
+namespace MWMechanics
+{
+    ExteriorPathgridGraph::ExteriorPathgridGraph()
+        : mNumNodes(0)
+    {
+    }
+
+    void ExteriorPathgridGraph::addCell(const MWWorld::CellStore* cell)
+    {
+        if (!cell || !cell->getCell()->isExterior())
+            return;
+
+        CellIndex index(cell->getCell()->getGridX(), cell->getCell()->getGridY());
+        if (mCells.find(index) != mCells.end())
+            return;
+
+        CellGraph& graph = mCells[index];
+        graph.mFirstNode = 0;
+
+        const ESM::Pathgrid* pathgrid = MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*cell->getCell());
+        if (pathgrid)
+        {
+            CoordinateConverter converter(cell->getCell());
+            graph.mPoints = pathgrid->mPoints;
+            for (std::vector<ESM::Pathgrid::Point>::iterator it = graph.mPoints.begin(); it != graph.mPoints.end(); ++it)
+                converter.toWorld(*it);
+
+            const int numPoints = static_cast<int>(graph.mPoints.size());
+            graph.mEdges.resize(numPoints);
+            std::vector<int> parents(numPoints);
+            for (int i = 0; i < numPoints; ++i)
+                parents[i] = i;
+
+            for (ESM::Pathgrid::EdgeList::const_iterator it = pathgrid->mEdges.begin(); it != pathgrid->mEdges.end(); ++it)
+            {
+                if (it->mV0 < 0 || it->mV0 >= numPoints || it->mV1 < 0 || it->mV1 >= numPoints)
+                    continue;
+
+                Edge edge;
+                edge.mTo = it->mV1;
+                edge.mCost = distance(graph.mPoints[it->mV0], graph.mPoints[it->mV1]);
+                graph.mEdges[it->mV0].push_back(edge);
+
+                // Pathgrid edges are stored in both directions and border links are always added in pairs,
+                // so weakly connected components are sufficient to reject unreachable goals early.
+                parents[findRoot(parents, it->mV0)] = findRoot(parents, it->mV1);
+            }
+
+            // number the components of the cell consecutively
+            std::map<int, int> componentIds;
+            graph.mComponents.resize(numPoints);
+            for (int i = 0; i < numPoints; ++i)
+            {
+                std::map<int, int>::const_iterator found = componentIds.insert(std::make_pair(findRoot(parents, i), static_cast<int>(componentIds.size()))).first;
+                graph.mComponents[i] = found->second;
+            }
+            graph.mGlobalComponents.resize(componentIds.size());
+        }
+
+        // only the borders shared with this cell need to be stitched, the remaining links are unchanged
+        for (int x = index.first - 1; x <= index.first + 1; ++x)
+        {
+            for (int y = index.second - 1; y <= index.second + 1; ++y)
+            {
+                CellIndex neighbourIndex(x, y);
+                if (neighbourIndex == index)
+                    continue;
+
+                CellMap::iterator neighbour = mCells.find(neighbourIndex);
+                if (neighbour == mCells.end())
+                    continue;
+
+                stitch(index, graph, neighbourIndex, neighbour->second);
+                stitch(neighbourIndex, neighbour->second, index, graph);
+
+                std::stable_sort(neighbour->second.mLinks.begin(), neighbour->second.mLinks.end(), compareLinkSource<BorderLink>);
+            }
+        }
+        std::stable_sort(graph.mLinks.begin(), graph.mLinks.end(), compareLinkSource<BorderLink>);
+
+        updateComponents();
+    }
+
+    void ExteriorPathgridGraph::removeCell(const MWWorld::CellStore* cell)
+    {
+        if (!cell || !cell->getCell()->isExterior())
+            return;
+
+        CellIndex index(cell->getCell()->getGridX(), cell->getCell()->getGridY());
+        CellMap::iterator found = mCells.find(index);
+        if (found == mCells.end())
+            return;
+
+        mCells.erase(found);
+
+        for (int x = index.first - 1; x <= index.first + 1; ++x)
+        {
+            for (int y = index.second - 1; y <= index.second + 1; ++y)
+            {
+                CellMap::iterator neighbour = mCells.find(CellIndex(x, y));
+                if (neighbour == mCells.end())
+                    continue;
+
+                std::vector<BorderLink>& links = neighbour->second.mLinks;
+                for (std::vector<BorderLink>::iterator it = links.begin(); it != links.end();)
+                {
+                    if (it->mCell == index)
+                        it = links.erase(it);
+                    else
+                        ++it;
+                }
+            }
+        }
+
+        updateComponents();
+    }
+
+    void ExteriorPathgridGraph::clear()
+    {
+        mCells.clear();
+        mNumNodes = 0;
+    }
+
+    /*
+     * Link each point of cell that is close to neighbour's bounds to the closest
+     * point of neighbour. Links are added in both directions, so stitching
+     * neighbour to cell afterwards only adds links for points that were not
+     * picked as the closest point in the first pass.
+     */
+    void ExteriorPathgridGraph::stitch(const CellIndex& index, CellGraph& cell, const CellIndex& neighbourIndex, CellGraph& neighbour)
+    {
+        if (cell.mPoints.empty() || neighbour.mPoints.empty())
+            return;
+
+        for (int from = 0; from < static_cast<int>(cell.mPoints.size()); ++from)
+        {
+            const ESM::Pathgrid::Point& point = cell.mPoints[from];
+            if (distanceToCell(point, neighbourIndex.first, neighbourIndex.second) > sMaxLinkDistance)
+                continue;
+
+            int closest = -1;
+            float closestDistance = sMaxLinkDistance;
+            for (int to = 0; to < static_cast<int>(neighbour.mPoints.size()); ++to)
+            {
+                float dist = distance(point, neighbour.mPoints[to]);
+                if (dist < closestDistance)
+                {
+                    closestDistance = dist;
+                    closest = to;
+                }
+            }
+
+            if (closest == -1)
+                continue;
+
+            bool linked = false;
+            for (std::vector<BorderLink>::const_iterator it = cell.mLinks.begin(); it != cell.mLinks.end(); ++it)
+            {
+                if (it->mFrom == from && it->mCell == neighbourIndex && it->mTo == closest)
+                {
+                    linked = true;
+                    break;
+                }
+            }
+            if (linked)
+                continue;
+
+            BorderLink link;
+            link.mFrom = from;
+            link.mCell = neighbourIndex;
+            link.mTo = closest;
+            link.mCost = closestDistance;
+            cell.mLinks.push_back(link);
+
+            link.mFrom = closest;
+            link.mCell = index;
+            link.mTo = from;
+            neighbour.mLinks.push_back(link);
+        }
+    }
+
+    void ExteriorPathgridGraph::updateComponents()
+    {
+        mNumNodes = 0;
+        int numComponents = 0;
+        for (CellMap::iterator it = mCells.begin(); it != mCells.end(); ++it)
+        {
+            CellGraph& cell = it->second;
+            cell.mFirstNode = mNumNodes;
+            mNumNodes += static_cast<int>(cell.mPoints.size());
+            for (unsigned int i = 0; i < cell.mGlobalComponents.size(); ++i)
+                cell.mGlobalComponents[i] = numComponents++;
+        }
+
+        std::vector<int> parents(numComponents);
+        for (int i = 0; i < numComponents; ++i)
+            parents[i] = i;
+
+        for (CellMap::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+        {
+            const CellGraph& cell = it->second;
+            for (std::vector<BorderLink>::const_iterator link = cell.mLinks.begin(); link != cell.mLinks.end(); ++link)
+            {
+                const CellGraph& other = mCells.find(link->mCell)->second;
+                int component = cell.mGlobalComponents[cell.mComponents[link->mFrom]];
+                int otherComponent = other.mGlobalComponents[other.mComponents[link->mTo]];
+                parents[findRoot(parents, component)] = findRoot(parents, otherComponent);
+            }
+        }
+
+        for (CellMap::iterator it = mCells.begin(); it != mCells.end(); ++it)
+        {
+            std::vector<int>& components = it->second.mGlobalComponents;
+            for (unsigned int i = 0; i < components.size(); ++i)
+                components[i] = findRoot(parents, components[i]);
+        }
+    }
+
+    int ExteriorPathgridGraph::getComponent(const CellGraph& cell, int point) const
+    {
+        return cell.mGlobalComponents[cell.mComponents[point]];
+    }
+
+    int ExteriorPathgridGraph::getClosestPoint(const CellGraph& cell, const osg::Vec3f& pos, int component) const
+    {
+        int closestPoint = -1;
+        float closestDistance = std::numeric_limits<float>::max();
+        for (int i = 0; i < static_cast<int>(cell.mPoints.size()); ++i)
+        {
+            if (component != -1 && getComponent(cell, i) != component)
+                continue;
+
+            float dist = PathFinder::DistanceSquared(cell.mPoints[i], pos);
+            if (dist < closestDistance)
+            {
+                closestDistance = dist;
+                closestPoint = i;
+            }
+        }
+        return closestPoint;
+    }
+
+    bool ExteriorPathgridGraph::buildPath(const osg::Vec3f& start, const osg::Vec3f& end, std::list<ESM::Pathgrid::Point>& path) const
+    {
+        const float cellSize = static_cast<float>(ESM::Land::REAL_SIZE);
+        CellMap::const_iterator startCell = mCells.find(CellIndex(static_cast<int>(std::floor(start.x() / cellSize)),
+                                                                  static_cast<int>(std::floor(start.y() / cellSize))));
+        CellMap::const_iterator endCell = mCells.find(CellIndex(static_cast<int>(std::floor(end.x() / cellSize)),
+                                                                static_cast<int>(std::floor(end.y() / cellSize))));
+        if (startCell == mCells.end() || endCell == mCells.end())
+            return false;
+
+        int startPoint = getClosestPoint(startCell->second, start, -1);
+        if (startPoint == -1)
+            return false;
+
+        int goalPoint = getClosestPoint(endCell->second, end, getComponent(startCell->second, startPoint));
+        if (goalPoint == -1)
+            return false;
+
+        // a node of the search is a point within a cell, numbered by the cell's mFirstNode
+        typedef std::pair<const CellGraph*, int> Node;
+        const Node startNode (&startCell->second, startPoint);
+        const Node goalNode (&endCell->second, goalPoint);
+        const ESM::Pathgrid::Point& goal = goalNode.first->mPoints[goalNode.second];
+
+        // A* search; the euclidean distance is an admissible heuristic
+        // since all edge costs are euclidean distances as well.
+        std::vector<float> gScore(mNumNodes, std::numeric_limits<float>::max());
+        std::vector<Node> graphParent(mNumNodes, Node(static_cast<const CellGraph*>(NULL), -1));
+        std::vector<bool> closed(mNumNodes, false);
+
+        typedef std::pair<float, Node> OpenNode; // fScore, node
+        struct CompareScore
+        {
+            bool operator()(const OpenNode& left, const OpenNode& right) const
+            {
+                return left.first > right.first;
+            }
+        };
+        std::priority_queue<OpenNode, std::vector<OpenNode>, CompareScore> openset;
+
+        gScore[startNode.first->mFirstNode + startNode.second] = 0;
+        openset.push(OpenNode(distance(startNode.first->mPoints[startNode.second], goal), startNode));
+
+        while (!openset.empty())
+        {
+            Node current = openset.top().second;
+            openset.pop();
+
+            if (current == goalNode)
+                break;
+
+            const CellGraph& cell = *current.first;
+            const int currentIndex = cell.mFirstNode + current.second;
+            if (closed[currentIndex])
+                continue; // stale entry, node was reached with a lower cost
+            closed[currentIndex] = true;
+
+            const std::vector<Edge>& edges = cell.mEdges[current.second];
+            for (std::vector<Edge>::const_iterator edge = edges.begin(); edge != edges.end(); ++edge)
+            {
+                const int index = cell.mFirstNode + edge->mTo;
+                if (closed[index])
+                    continue;
+
+                float tentativeG = gScore[currentIndex] + edge->mCost;
+                if (tentativeG < gScore[index])
+                {
+                    gScore[index] = tentativeG;
+                    graphParent[index] = current;
+                    openset.push(OpenNode(tentativeG + distance(cell.mPoints[edge->mTo], goal), Node(&cell, edge->mTo)));
+                }
+            }
+
+            BorderLink key;
+            key.mFrom = current.second;
+            std::pair<std::vector<BorderLink>::const_iterator, std::vector<BorderLink>::const_iterator> links
+                    = std::equal_range(cell.mLinks.begin(), cell.mLinks.end(), key, compareLinkSource<BorderLink>);
+            for (std::vector<BorderLink>::const_iterator link = links.first; link != links.second; ++link)
+            {
+                const CellGraph& other = mCells.find(link->mCell)->second;
+                const int index = other.mFirstNode + link->mTo;
+                if (closed[index])
+                    continue;
+
+                float tentativeG = gScore[currentIndex] + link->mCost;
+                if (tentativeG < gScore[index])
+                {
+                    gScore[index] = tentativeG;
+                    graphParent[index] = current;
+                    openset.push(OpenNode(tentativeG + distance(other.mPoints[link->mTo], goal), Node(&other, link->mTo)));
+                }
+            }
+        }
+
+        if (goalNode != startNode && graphParent[goalNode.first->mFirstNode + goalNode.second].first == NULL)
+            return false;
+
+        path.clear();
+        for (Node current = goalNode; current.first != NULL; current = graphParent[current.first->mFirstNode + current.second])
+            path.push_front(current.first->mPoints[current.second]);
+
+        return true;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef GAME_MWMECHANICS_EXTERIORPATHGRID_H
+#define GAME_MWMECHANICS_EXTERIORPATHGRID_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <components/esm/loadpgrd.hpp>
+
+namespace osg
+{
+    class Vec3f;
+}
+
+namespace MWWorld
+{
+    class CellStore;
+}
+
+namespace MWMechanics
+{
+    /// \brief Navigation graph spanning the pathgrids of all active exterior cells.
+    ///
+    /// Pathgrids of neighbouring cells are joined at their borders, so a path between two
+    /// points in different cells of the active grid can be found with a single search,
+    /// instead of walking in a straight line towards the next cell and replanning there.
+    ///
+    /// The graph is updated incrementally: adding or removing a cell only converts that
+    /// cell's pathgrid and re-stitches the borders it shares with its neighbours.
+    class ExteriorPathgridGraph
+    {
+        public:
+            ExteriorPathgridGraph();
+
+            /// Add the pathgrid of an exterior cell and join it to already added neighbours.
+            /// Cells without a pathgrid are added as empty, so that lookups still know about them.
+            void addCell(const MWWorld::CellStore* cell);
+
+            void removeCell(const MWWorld::CellStore* cell);
+
+            void clear();
+
+            /// Find a path between two points in world coordinates, which may lie in different cells.
+            /// @param path Receives the pathgrid points (in world coordinates) from the point closest to
+            /// \a start to the reachable point closest to \a end. Neither \a start nor \a end are added.
+            /// @return false if one of the points is outside of the graph or there is no path.
+            bool buildPath(const osg::Vec3f& start, const osg::Vec3f& end, std::list<ESM::Pathgrid::Point>& path) const;
+
+        private:
+            typedef std::pair<int, int> CellIndex;
+
+            struct Edge
+            {
+                int mTo; // point index in the same cell
+                float mCost;
+            };
+
+            struct BorderLink
+            {
+                int mFrom; // point index in this cell
+                CellIndex mCell; // neighbouring cell
+                int mTo; // point index in the neighbouring cell
+                float mCost;
+            };
+
+            struct CellGraph
+            {
+                std::vector<ESM::Pathgrid::Point> mPoints; // world coordinates
+                std::vector<std::vector<Edge> > mEdges; // edges within the cell, per point
+                std::vector<BorderLink> mLinks; // sorted by mFrom
+                std::vector<int> mComponents; // connected component of each point within the cell
+                std::vector<int> mGlobalComponents; // component of each of the cell's components within the whole graph
+                int mFirstNode; // offset of the cell's points in the search buffers of buildPath
+            };
+
+            typedef std::map<CellIndex, CellGraph> CellMap;
+            CellMap mCells;
+
+            int mNumNodes;
+
+            void stitch(const CellIndex& index, CellGraph& cell, const CellIndex& neighbourIndex, CellGraph& neighbour);
+
+            /// Join the components of neighbouring cells and number the nodes of all cells.
+            /// Only visits the components and border links of each cell, not its points.
+            void updateComponents();
+
+            int getComponent(const CellGraph& cell, int point) const;
+
+            int getClosestPoint(const CellGraph& cell, const osg::Vec3f& pos, int component) const;
+    };
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "magiceffects.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <stdexcept>
@@ -7,6 +8,20 @@
 #include <components/esm/effectlist.hpp>
 #include <components/esm/magiceffects.hpp>
 
+namespace
+{
+    // 0 is the revision of default constructed MagicEffects
+    size_t sLastRevision = 0;
+
+    struct KeyLess
+    {
+        bool operator() (const std::pair<MWMechanics::EffectKey, MWMechanics::EffectParam>& left, const MWMechanics::EffectKey& right) const
+        {
+            return left.first < right;
+        }
+    };
+}
+
 namespace MWMechanics
 {
     EffectKey::EffectKey() : mId (0), mArg (-1) {}
@@ -29,6 +44,11 @@ namespace MWMechanics
         }
     }
 
+    bool operator== (const EffectKey& left, const EffectKey& right)
+    {
+        return left.mId == right.mId && left.mArg == right.mArg;
+    }
+
     bool operator< (const EffectKey& left, const EffectKey& right)
     {
         if (left.mId<right.mId)
@@ -86,28 +106,60 @@ namespace MWMechanics
         return *this;
     }
 
-    void MagicEffects::remove(const EffectKey &key)
+    MagicEffects::MagicEffects()
+        : mRevision(0)
     {
-        mCollection.erase(key);
     }
 
-    void MagicEffects::add (const EffectKey& key, const EffectParam& param)
+    MagicEffects::Collection::iterator MagicEffects::find (const EffectKey& key)
     {
-        Collection::iterator iter = mCollection.find (key);
+        Collection::iterator iter = std::lower_bound(mCollection.begin(), mCollection.end(), key, KeyLess());
+        if (iter != mCollection.end() && iter->first == key)
+            return iter;
+        return mCollection.end();
+    }
 
-        if (iter==mCollection.end())
-        {
-            mCollection.insert (std::make_pair (key, param));
-        }
-        else
+    MagicEffects::Collection::const_iterator MagicEffects::find (const EffectKey& key) const
+    {
+        Collection::const_iterator iter = std::lower_bound(mCollection.begin(), mCollection.end(), key, KeyLess());
+        if (iter != mCollection.end() && iter->first == key)
+            return iter;
+        return mCollection.end();
+    }
+
+    EffectParam& MagicEffects::getOrInsert (const EffectKey& key)
+    {
+        Collection::iterator iter = std::lower_bound(mCollection.begin(), mCollection.end(), key, KeyLess());
+        if (iter == mCollection.end() || !(iter->first == key))
+            iter = mCollection.insert(iter, std::make_pair(key, EffectParam()));
+        return iter->second;
+    }
+
+    void MagicEffects::changed()
+    {
+        mRevision = ++sLastRevision;
+    }
+
+    void MagicEffects::remove(const EffectKey &key)
+    {
+        Collection::iterator iter = find(key);
+        if (iter != mCollection.end())
         {
-            iter->second += param;
+            mCollection.erase(iter);
+            changed();
         }
     }
 
+    void MagicEffects::add (const EffectKey& key, const EffectParam& param)
+    {
+        getOrInsert(key) += param;
+        changed();
+    }
+
     void MagicEffects::modifyBase(const EffectKey &key, int diff)
     {
-        mCollection[key].modifyBase(diff);
+        getOrInsert(key).modifyBase(diff);
+        changed();
     }
 
     void MagicEffects::setModifiers(const MagicEffects &effects)
@@ -119,8 +171,10 @@ namespace MWMechanics
 
         for (Collection::const_iterator it = effects.begin(); it != effects.end(); ++it)
         {
-            mCollection[it->first].setModifier(it->second.getModifier());
+            getOrInsert(it->first).setModifier(it->second.getModifier());
         }
+
+        changed();
     }
 
     MagicEffects& MagicEffects::operator+= (const MagicEffects& effects)
@@ -132,22 +186,26 @@ namespace MWMechanics
             return *this;
         }
 
-        for (Collection::const_iterator iter (effects.begin()); iter!=effects.end(); ++iter)
-        {
-            Collection::iterator result = mCollection.find (iter->first);
+        if (effects.mCollection.empty())
+            return *this;
 
-            if (result!=mCollection.end())
-                result->second += iter->second;
-            else
-                mCollection.insert (*iter);
+        if (mCollection.empty())
+        {
+            mCollection = effects.mCollection;
+            mRevision = effects.mRevision;
+            return *this;
         }
 
+        for (Collection::const_iterator iter (effects.begin()); iter!=effects.end(); ++iter)
+            getOrInsert(iter->first) += iter->second;
+
+        changed();
         return *this;
     }
 
     EffectParam MagicEffects::get (const EffectKey& key) const
     {
-        Collection::const_iterator iter = mCollection.find (key);
+        Collection::const_iterator iter = find (key);
 
         if (iter==mCollection.end())
         {
@@ -166,7 +224,7 @@ namespace MWMechanics
         // adding/changing
         for (Collection::const_iterator iter (now.begin()); iter!=now.end(); ++iter)
         {
-            Collection::const_iterator other = prev.mCollection.find (iter->first);
+            Collection::const_iterator other = prev.find (iter->first);
 
             if (other==prev.end())
             {
@@ -183,7 +241,7 @@ namespace MWMechanics
         // removing
         for (Collection::const_iterator iter (prev.begin()); iter!=prev.end(); ++iter)
         {
-            Collection::const_iterator other = now.mCollection.find (iter->first);
+            Collection::const_iterator other = now.find (iter->first);
             if (other==now.end())
             {
                 result.add (iter->first, EffectParam() - iter->second);
@@ -210,7 +268,8 @@ namespace MWMechanics
     {
         for (std::map<int, int>::const_iterator it = state.mEffects.begin(); it != state.mEffects.end(); ++it)
         {
-            mCollection[EffectKey(it->first)].setBase(it->second);
+            getOrInsert(EffectKey(it->first)).setBase(it->second);
         }
+        changed();
     }
 }
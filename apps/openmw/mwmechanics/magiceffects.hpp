@@ -1,8 +1,8 @@
 #ifndef GAME_MWMECHANICS_MAGICEFFECTS_H
 #define GAME_MWMECHANICS_MAGICEFFECTS_H
 
-#include <map>
 #include <string>
+#include <vector>
 
 namespace ESM
 {
@@ -27,6 +27,7 @@ namespace MWMechanics
     };
 
     bool operator< (const EffectKey& left, const EffectKey& right);
+    bool operator== (const EffectKey& left, const EffectKey& right);
 
     struct EffectParam
     {
@@ -80,18 +81,33 @@ namespace MWMechanics
     };
 
     /// \brief Effects currently affecting a NPC or creature
+    ///
+    /// Effects are stored in a contiguous array sorted by key, so that copying and combining
+    /// effect lists does not allocate per effect.
     class MagicEffects
     {
         public:
 
-            typedef std::map<EffectKey, EffectParam> Collection;
+            typedef std::vector<std::pair<EffectKey, EffectParam> > Collection;
 
         private:
 
             Collection mCollection;
 
+            size_t mRevision;
+
+            Collection::iterator find (const EffectKey& key);
+            Collection::const_iterator find (const EffectKey& key) const;
+
+            /// Return the param for \a key, inserting it if not present.
+            EffectParam& getOrInsert (const EffectKey& key);
+
+            void changed();
+
         public:
 
+            MagicEffects();
+
             Collection::const_iterator begin() const { return mCollection.begin(); }
 
             Collection::const_iterator end() const { return mCollection.end(); }
@@ -114,6 +130,10 @@ namespace MWMechanics
 
             static MagicEffects diff (const MagicEffects& prev, const MagicEffects& now);
             ///< Return changes from \a prev to \a now.
+
+            size_t getRevision() const { return mRevision; }
+            ///< Number that changes whenever the effects are modified, unique across all
+            /// MagicEffects instances. Copies share the revision of their source.
     };
 }
 
@@ -438,9 +438,9 @@ namespace MWMechanics
         return mActors.isSneaking(ptr);
     }
 
-    void MechanicsManager::rest(bool sleep)
+    void MechanicsManager::rest(float hours, bool sleep)
     {
-        mActors.rest(sleep);
+        mActors.rest(hours, sleep);
     }
 
     int MechanicsManager::getHoursToRest() const
@@ -91,7 +91,7 @@ namespace MWMechanics
             virtual void setPlayerClass (const ESM::Class& class_);
             ///< Set player class to custom class.
 
-            virtual void rest(bool sleep);
+            virtual void rest(float hours, bool sleep);
             ///< If the player is sleeping or waiting, this should be called every hour.
             /// @param sleep is the player sleeping or waiting?
 
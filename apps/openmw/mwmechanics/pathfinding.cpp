@@ -9,6 +9,7 @@
 #include "../mwworld/cellstore.hpp"
 
 #include "coordinateconverter.hpp"
+#include "exteriorpathgrid.hpp"
 
 namespace
 {
@@ -120,7 +121,8 @@ namespace MWMechanics
     }
 
     PathFinder::PathFinder()
-        : mPathgrid(NULL),
+        : mIsExteriorPath(false),
+          mPathgrid(NULL),
           mCell(NULL)
     {
     }
@@ -129,6 +131,7 @@ namespace MWMechanics
     {
         if(!mPath.empty())
             mPath.clear();
+        mIsExteriorPath = false;
     }
 
     /*
@@ -141,6 +144,10 @@ namespace MWMechanics
      *
      * NOTE: startPoint & endPoint are in world coordinates
      *
+     * NOTE: If the actor is in an exterior cell and endPoint lies in another
+     *       active exterior cell, the path is searched on the graph joining the
+     *       pathgrids of all active exterior cells (see buildExteriorPath()).
+     *
      * Updates mPath using aStarSearch() or ray test (if shortcut allowed).
      * mPath consists of pathgrid points, except the last element which is
      * endPoint.  This may be useful where the endPoint is not on a pathgrid
@@ -172,6 +179,7 @@ namespace MWMechanics
                                const MWWorld::CellStore* cell)
     {
         mPath.clear();
+        mIsExteriorPath = false;
 
         if(mCell != cell || !mPathgrid)
         {
@@ -179,6 +187,15 @@ namespace MWMechanics
             mPathgrid = MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*mCell->getCell());
         }
 
+        if (mCell->isExterior())
+        {
+            int endCellX, endCellY;
+            MWBase::Environment::get().getWorld()->positionToIndex(static_cast<float>(endPoint.mX), static_cast<float>(endPoint.mY), endCellX, endCellY);
+            if ((endCellX != mCell->getCell()->getGridX() || endCellY != mCell->getCell()->getGridY())
+                    && buildExteriorPath(startPoint, endPoint))
+                return;
+        }
+
         // Refer to AiWander reseach topic on openmw forums for some background.
         // Maybe there is no pathgrid for this cell.  Just go to destination and let
         // physics take care of any blockages.
@@ -253,6 +270,32 @@ namespace MWMechanics
             mPath.push_back(endPoint);
     }
 
+    bool PathFinder::buildExteriorPath(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint)
+    {
+        const ExteriorPathgridGraph& graph = MWBase::Environment::get().getWorld()->getExteriorPathgridGraph();
+
+        osg::Vec3f start = MakeOsgVec3(startPoint);
+        osg::Vec3f end = MakeOsgVec3(endPoint);
+
+        std::list<ESM::Pathgrid::Point> path;
+        if (!graph.buildPath(start, end, path))
+            return false;
+
+        mIsExteriorPath = true;
+
+        // same as for a single cell: go straight to the destination if it is closer than the pathgrid
+        float startToEndLength2 = (end - start).length2();
+        if (startToEndLength2 < DistanceSquared(path.front(), start) || startToEndLength2 < DistanceSquared(path.back(), end))
+        {
+            mPath.push_back(endPoint);
+            return true;
+        }
+
+        mPath.swap(path);
+        mPath.push_back(endPoint);
+        return true;
+    }
+
     float PathFinder::getZAngleToNext(float x, float y) const
     {
         // This should never happen (programmers should have an if statement checking
@@ -81,6 +81,13 @@ namespace MWMechanics
 
             const MWWorld::CellStore* getPathCell() const;
 
+            /// Was the current path built on the graph spanning all active exterior cells?
+            /// Such a path stays valid when the actor crosses into another exterior cell.
+            bool isExteriorPath() const
+            {
+                return mIsExteriorPath;
+            }
+
             /** Synchronize new path with old one to avoid visiting 1 waypoint 2 times
             @note
                 BuildPath() takes closest PathGrid point to NPC as first point of path.
@@ -151,7 +158,10 @@ namespace MWMechanics
             }
 
         private:
+            bool buildExteriorPath(const ESM::Pathgrid::Point &startPoint, const ESM::Pathgrid::Point &endPoint);
+
             std::list<ESM::Pathgrid::Point> mPath;
+            bool mIsExteriorPath;
 
             const ESM::Pathgrid *mPathgrid;
             const MWWorld::CellStore* mCell;
@@ -1095,6 +1095,41 @@ namespace MWMechanics
         creatureStats.setDynamic(index, stat);
     }
 
+    bool hasTickingEffects(const MagicEffects& effects)
+    {
+        for (MagicEffects::Collection::const_iterator it = effects.begin(); it != effects.end(); ++it)
+        {
+            if (it->second.getMagnitude() == 0.f)
+                continue;
+
+            switch (it->first.mId)
+            {
+            case ESM::MagicEffect::DamageAttribute:
+            case ESM::MagicEffect::RestoreAttribute:
+            case ESM::MagicEffect::RestoreHealth:
+            case ESM::MagicEffect::RestoreMagicka:
+            case ESM::MagicEffect::RestoreFatigue:
+            case ESM::MagicEffect::DamageHealth:
+            case ESM::MagicEffect::DamageMagicka:
+            case ESM::MagicEffect::DamageFatigue:
+            case ESM::MagicEffect::AbsorbHealth:
+            case ESM::MagicEffect::AbsorbMagicka:
+            case ESM::MagicEffect::AbsorbFatigue:
+            case ESM::MagicEffect::SunDamage:
+            case ESM::MagicEffect::FireDamage:
+            case ESM::MagicEffect::ShockDamage:
+            case ESM::MagicEffect::FrostDamage:
+            case ESM::MagicEffect::Poison:
+            case ESM::MagicEffect::DamageSkill:
+            case ESM::MagicEffect::RestoreSkill:
+                return true;
+            default:
+                break;
+            }
+        }
+        return false;
+    }
+
     bool effectTick(CreatureStats& creatureStats, const MWWorld::Ptr& actor, const EffectKey &effectKey, float magnitude)
     {
         if (magnitude == 0.f)
@@ -71,6 +71,9 @@ namespace MWMechanics
     /// @return Was the effect a tickable effect with a magnitude?
     bool effectTick(CreatureStats& creatureStats, const MWWorld::Ptr& actor, const MWMechanics::EffectKey& effectKey, float magnitude);
 
+    /// @return Do any of the effects change the attributes, skills or dynamic stats of their target over time?
+    bool hasTickingEffects(const MagicEffects& effects);
+
     std::string getSummonedCreature(int effectId);
 
     class CastSpell
@@ -135,14 +135,15 @@ namespace MWMechanics
             if (mPermanentSpellEffects.find(spell) != mPermanentSpellEffects.end())
             {
                 MagicEffects & effects = mPermanentSpellEffects[spell];
-                for (MagicEffects::Collection::const_iterator effectIt = effects.begin(); effectIt != effects.end();)
+                std::vector<EffectKey> harmfulEffects;
+                for (MagicEffects::Collection::const_iterator effectIt = effects.begin(); effectIt != effects.end(); ++effectIt)
                 {
                     const ESM::MagicEffect * magicEffect = MWBase::Environment::get().getWorld()->getStore().get<ESM::MagicEffect>().find(effectIt->first.mId);
                     if (magicEffect->mData.mFlags & ESM::MagicEffect::Harmful)
-                        effects.remove((effectIt++)->first);
-                    else
-                        ++effectIt;
+                        harmfulEffects.push_back(effectIt->first);
                 }
+                for (std::vector<EffectKey>::const_iterator it = harmfulEffects.begin(); it != harmfulEffects.end(); ++it)
+                    effects.remove(*it);
             }
             mCorprusSpells.erase(corprusIt);
         }
@@ -157,7 +158,7 @@ namespace MWMechanics
             mSelectedSpell.clear();
     }
 
-    MagicEffects Spells::getMagicEffects() const
+    const MagicEffects& Spells::getMagicEffects() const
     {
         if (mSpellsChanged) {
             rebuildEffects();
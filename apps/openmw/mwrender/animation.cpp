@@ -2,6 +2,7 @@
 
 #include <iomanip>
 #include <limits>
+#include <cmath>
 
 #include <osg/TexGen>
 #include <osg/TexEnvCombine>
@@ -29,8 +30,13 @@
 #include <components/sceneutil/lightmanager.hpp>
 #include <components/sceneutil/lightutil.hpp>
 #include <components/sceneutil/skeleton.hpp>
+#include <components/sceneutil/riggeometry.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
 
+#include <components/misc/rng.hpp>
+
+#include <components/settings/settings.hpp>
+
 #include <components/fallback/fallback.hpp>
 
 #include "../mwbase/environment.hpp"
@@ -278,6 +284,25 @@ namespace
         }
     };
 
+    class ShareSkinningVisitor : public osg::NodeVisitor
+    {
+    public:
+        ShareSkinningVisitor(bool share)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mShare(share)
+        {
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            if (SceneUtil::RigGeometry* rig = dynamic_cast<SceneUtil::RigGeometry*>(&drawable))
+                rig->setShareSkinning(mShare);
+        }
+
+    private:
+        bool mShare;
+    };
+
 }
 
 namespace MWRender
@@ -461,6 +486,10 @@ namespace MWRender
         , mHeadYawRadians(0.f)
         , mHeadPitchRadians(0.f)
         , mAlpha(1.f)
+        , mShareSkinning(false)
+        , mSharedSkinningTimeStep(std::max(0.f, Settings::Manager::getFloat("shared skinning time step", "General")))
+        , mUpdateInterval(0.f)
+        , mTimeSinceUpdate(0.f)
     {
         for(size_t i = 0;i < sNumBlendMasks;i++)
             mAnimationTimePtr[i].reset(new AnimationTime);
@@ -492,6 +521,43 @@ namespace MWRender
             mSkeleton->setActive(active);
     }
 
+    void Animation::setUpdateInterval(float interval)
+    {
+        if (interval > 0.f && mUpdateInterval <= 0.f)
+        {
+            // spread the updates of actors that reach the interval at the same time over several frames
+            mTimeSinceUpdate = Misc::Rng::rollProbability() * interval;
+        }
+        else if (interval <= 0.f && mUpdateInterval > 0.f)
+            setFrozen(false);
+
+        mUpdateInterval = interval;
+    }
+
+    void Animation::setFrozen(bool frozen)
+    {
+        for (size_t i=0; i<sNumBlendMasks; ++i)
+            mAnimationTimePtr[i]->setFrozen(frozen);
+        if (mSkeleton)
+            mSkeleton->setFreezeSkinning(frozen);
+    }
+
+    void Animation::setShareSkinning(bool share)
+    {
+        if (share == mShareSkinning)
+            return;
+        mShareSkinning = share;
+
+        for (size_t i=0; i<sNumBlendMasks; ++i)
+            mAnimationTimePtr[i]->setTimeStep(share ? mSharedSkinningTimeStep : 0.f);
+
+        if (mObjectRoot)
+        {
+            ShareSkinningVisitor visitor(share);
+            mObjectRoot->accept(visitor);
+        }
+    }
+
     void Animation::updatePtr(const MWWorld::Ptr &ptr)
     {
         mPtr = ptr;
@@ -1050,6 +1116,20 @@ namespace MWRender
 
     osg::Vec3f Animation::runAnimation(float duration)
     {
+        const float epsilon = 0.001f;
+        bool headTracking = (std::abs(mHeadPitchRadians) > epsilon || std::abs(mHeadYawRadians) > epsilon);
+
+        // while frozen, the bones and RigGeometries keep the last pose, but the animation time still advances
+        if (mUpdateInterval > 0.f && duration > 0.f)
+        {
+            mTimeSinceUpdate += duration;
+            // the head controller rotates the head relative to its animated pose, so that pose has to be updated
+            bool update = mTimeSinceUpdate >= mUpdateInterval || (mHeadController && headTracking);
+            if (update)
+                mTimeSinceUpdate = 0.f;
+            setFrozen(!update);
+        }
+
         osg::Vec3f movement(0.f, 0.f, 0.f);
         AnimStateMap::iterator stateiter = mStates.begin();
         while(stateiter != mStates.end())
@@ -1121,10 +1201,8 @@ namespace MWRender
 
         if (mHeadController)
         {
-            const float epsilon = 0.001f;
-            bool enable = (std::abs(mHeadPitchRadians) > epsilon || std::abs(mHeadYawRadians) > epsilon);
-            mHeadController->setEnabled(enable);
-            if (enable)
+            mHeadController->setEnabled(headTracking);
+            if (headTracking)
                 mHeadController->setRotate(osg::Quat(mHeadPitchRadians, osg::Vec3f(1,0,0)) * osg::Quat(mHeadYawRadians, osg::Vec3f(0,0,1)));
         }
 
@@ -1223,6 +1301,12 @@ namespace MWRender
             removeTriBipVisitor.remove();
         }
 
+        if (mShareSkinning)
+        {
+            ShareSkinningVisitor visitor(true);
+            mObjectRoot->accept(visitor);
+        }
+
         if (!mLightListCallback)
             mLightListCallback = new SceneUtil::LightListCallback;
         mObjectRoot->addCullCallback(mLightListCallback);
@@ -1636,9 +1720,15 @@ namespace MWRender
 
     float Animation::AnimationTime::getValue(osg::NodeVisitor*)
     {
-        if (mTimePtr)
-            return *mTimePtr;
-        return 0.f;
+        if (mFrozen)
+            return mFrozenValue;
+        if (!mTimePtr)
+            mFrozenValue = 0.f;
+        else if (mTimeStep > 0.f)
+            mFrozenValue = std::floor(*mTimePtr / mTimeStep) * mTimeStep;
+        else
+            mFrozenValue = *mTimePtr;
+        return mFrozenValue;
     }
 
     float EffectAnimationTime::getValue(osg::NodeVisitor*)
@@ -147,8 +147,22 @@ protected:
     {
     private:
         std::shared_ptr<float> mTimePtr;
+        float mTimeStep;
+        bool mFrozen;
+        float mFrozenValue;
 
     public:
+        AnimationTime() : mTimeStep(0.f), mFrozen(false), mFrozenValue(0.f) {}
+
+        /// Round the time passed to controllers down to a multiple of \a step, 0 disables rounding.
+        void setTimeStep(float step)
+        { mTimeStep = step; }
+
+        /// While frozen, the value of the last update is passed to controllers, and keyframe controllers are skipped.
+        void setFrozen(bool frozen)
+        { mFrozen = frozen; }
+        virtual bool isFrozen() const
+        { return mFrozen; }
 
         void setTimePtr(std::shared_ptr<float> time)
         { mTimePtr = time; }
@@ -271,6 +285,13 @@ protected:
 
     float mAlpha;
 
+    bool mShareSkinning;
+    /// Resolution of the animation time while sharing skinning, from the 'shared skinning time step' setting
+    float mSharedSkinningTimeStep;
+
+    float mUpdateInterval;
+    float mTimeSinceUpdate;
+
     mutable std::map<std::string, float> mAnimVelocities;
 
     osg::ref_ptr<SceneUtil::LightListCallback> mLightListCallback;
@@ -287,6 +308,9 @@ protected:
      * returns the wanted movement vector from the previous time. */
     void updatePosition(float oldtime, float newtime, osg::Vec3f& position);
 
+    /// Keep the bones and skinned meshes in their current pose, or resume updating them.
+    void setFrozen(bool frozen);
+
     /* Resets the animation to the time of the specified start marker, without
      * moving anything, and set the end time to the specified stop marker. If
      * the marker is not found, or if the markers are the same, it returns
@@ -348,6 +372,16 @@ public:
     /// @see SceneUtil::Skeleton::setActive
     void setActive(bool active);
 
+    /// Only update the keyframe controllers and skin the meshes every \a interval seconds, 0 updates them every frame.
+    /// Text keys, movement, and everything attached to the bones, such as lights and particles, are still updated every frame.
+    /// @see SceneUtil::Skeleton::setFreezeSkinning
+    void setUpdateInterval(float interval);
+
+    /// Allow the skinned meshes of this object to be shared with identical objects in the same pose, see
+    /// SceneUtil::RigGeometry::setShareSkinning. To make matching poses more likely, animation controllers are
+    /// evaluated at a reduced time resolution while enabled. Text keys and movement are not affected.
+    void setShareSkinning(bool share);
+
     osg::Group* getOrCreateObjectRoot();
 
     osg::Group* getObjectRoot();
@@ -266,6 +266,7 @@ namespace MWRender
         mHeight = mCellSize*(mMaxY-mMinY+1);
 
         mWorkItem = new CreateMapWorkItem(mWidth, mHeight, mMinX, mMinY, mMaxX, mMaxY, mCellSize, esmStore.get<ESM::Land>());
+        mWorkItem->setPriority(SceneUtil::WorkQueue::Priority_Low);
         mWorkQueue->addWorkItem(mWorkItem);
     }
 
@@ -0,0 +1,387 @@
+#include "objectpaging.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include <osg/Geometry>
+#include <osg/Group>
+
+#include <osgUtil/Simplifier>
+
+#include <components/esm/esmreader.hpp>
+#include <components/esm/loadcell.hpp>
+#include <components/esm/loadland.hpp>
+#include <components/esm/loadstat.hpp>
+#include <components/resource/scenemanager.hpp>
+#include <components/sceneutil/workqueue.hpp>
+#include <components/sceneutil/unrefqueue.hpp>
+#include <components/settings/settings.hpp>
+#include <components/to_utf8/to_utf8.hpp>
+
+#include "../mwbase/environment.hpp"
+#include "../mwbase/world.hpp"
+
+#include "../mwworld/esmstore.hpp"
+
+#include "staticbatch.hpp"
+#include "vismask.hpp"
+
+namespace
+{
+
+    struct CompareDistance
+    {
+        CompareDistance(const std::pair<int, int>& center) : mCenter(center) {}
+
+        bool operator()(const std::pair<int, int>& left, const std::pair<int, int>& right) const
+        {
+            return distance(left) < distance(right);
+        }
+
+        int distance(const std::pair<int, int>& cell) const
+        {
+            int dx = cell.first - mCenter.first;
+            int dy = cell.second - mCenter.second;
+            return dx*dx + dy*dy;
+        }
+
+        std::pair<int, int> mCenter;
+    };
+
+}
+
+namespace MWRender
+{
+
+    /// Worker thread item: read the static objects of a cell from the content files, and merge and simplify their meshes.
+    class CellObjectsItem : public SceneUtil::WorkItem
+    {
+    public:
+        /// Constructor to be called from the main thread.
+        CellObjectsItem(const ESM::Cell* cell, Resource::SceneManager* sceneManager, ToUTF8::Utf8Encoder* encoder, float minSize, float simplificationRatio)
+            : mCell(cell)
+            , mStore(MWBase::Environment::get().getWorld()->getStore())
+            , mSceneManager(sceneManager)
+            , mEncoder(encoder ? new ToUTF8::Utf8Encoder(*encoder) : NULL)
+            , mMinSize(minSize)
+            , mSimplificationRatio(simplificationRatio)
+            , mAbort(false)
+        {
+            // the readers hold the resolved indices of each content file's masters, which are needed to identify references.
+            // copies of them get their own file streams in the worker thread.
+            std::vector<ESM::ESMReader>& readers = MWBase::Environment::get().getWorld()->getEsmReader();
+            for (std::vector<ESM::ESM_Context>::const_iterator it = mCell->mContextList.begin(); it != mCell->mContextList.end(); ++it)
+            {
+                if (mReaders.find(it->index) == mReaders.end())
+                {
+                    ESM::ESMReader& reader = mReaders[it->index];
+                    reader = readers[it->index];
+                    reader.setEncoder(mEncoder.get());
+                }
+            }
+        }
+
+        virtual void abort()
+        {
+            mAbort = true;
+        }
+
+        virtual void doWork()
+        {
+            typedef std::map<ESM::RefNum, ESM::CellRef> RefMap;
+            RefMap refs;
+
+            for (std::map<int, ESM::ESMReader>::iterator it = mReaders.begin(); it != mReaders.end(); ++it)
+            {
+                std::string filename = it->second.getName();
+                it->second.openRaw(filename);
+            }
+
+            // same as CellStore::loadRefs
+            for (size_t i = 0; i < mCell->mContextList.size(); ++i)
+            {
+                if (mAbort)
+                    return;
+
+                try
+                {
+                    ESM::ESMReader& reader = mReaders[mCell->mContextList[i].index];
+                    mCell->restore(reader, i);
+
+                    ESM::CellRef ref;
+                    ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
+
+                    bool deleted = false;
+                    while (mCell->getNextRef(reader, ref, deleted))
+                    {
+                        if (std::find(mCell->mMovedRefs.begin(), mCell->mMovedRefs.end(), ref.mRefNum) != mCell->mMovedRefs.end())
+                            continue;
+
+                        if (deleted)
+                            refs.erase(ref.mRefNum);
+                        else
+                            refs[ref.mRefNum] = ref;
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Error: failed to read references of " << mCell->getDescription() << " for object paging: " << e.what() << std::endl;
+                }
+            }
+
+            for (ESM::CellRefTracker::const_iterator it = mCell->mLeasedRefs.begin(); it != mCell->mLeasedRefs.end(); ++it)
+            {
+                if (it->second)
+                    refs.erase(it->first.mRefNum);
+                else
+                    refs[it->first.mRefNum] = it->first;
+            }
+
+            StaticBatch batch (mSceneManager);
+            bool empty = true;
+            for (RefMap::const_iterator it = refs.begin(); it != refs.end(); ++it)
+            {
+                if (mAbort)
+                    return;
+
+                const ESM::CellRef& ref = it->second;
+                const ESM::Static* stat = mStore.get<ESM::Static>().search(ref.mRefID);
+                if (!stat || stat->mModel.empty())
+                    continue;
+
+                const std::string mesh = "meshes\\" + stat->mModel;
+                try
+                {
+                    // small objects can not be made out at a distance
+                    if (mSceneManager->getTemplate(mesh)->getBound().radius() * ref.mScale < mMinSize)
+                        continue;
+
+                    // same transform as the scene node of a static object
+                    const float* rot = ref.mPos.rot;
+                    osg::Quat attitude = osg::Quat(rot[2], osg::Vec3f(0,0,-1)) * osg::Quat(rot[1], osg::Vec3f(0,-1,0)) * osg::Quat(rot[0], osg::Vec3f(-1,0,0));
+                    osg::Matrix matrix = osg::Matrix::scale(ref.mScale, ref.mScale, ref.mScale) * osg::Matrix::rotate(attitude)
+                                       * osg::Matrix::translate(ref.mPos.asVec3());
+
+                    if (batch.addObject(mesh, matrix))
+                        empty = false;
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Error: failed to page " << mesh << ": " << e.what() << std::endl;
+                }
+            }
+
+            if (empty)
+                return;
+
+            osg::ref_ptr<osg::Group> node = batch.build();
+
+            if (mSimplificationRatio < 1.f)
+            {
+                osgUtil::Simplifier simplifier (mSimplificationRatio);
+                simplifier.setDoTriStrip(false);
+                for (unsigned int i=0; i<node->getNumChildren(); ++i)
+                {
+                    osg::Group* chunk = node->getChild(i)->asGroup();
+                    for (unsigned int j=0; j<chunk->getNumChildren(); ++j)
+                    {
+                        if (mAbort)
+                            return;
+                        if (osg::Geometry* geometry = chunk->getChild(j)->asGeometry())
+                            simplifier.simplify(*geometry);
+                    }
+                }
+            }
+
+            mNode = node;
+        }
+
+        /// @return The merged objects, or NULL if the cell has no objects to draw. To be called once the item is done.
+        osg::ref_ptr<osg::Node> getNode() const
+        {
+            return mNode;
+        }
+
+    private:
+        const ESM::Cell* mCell;
+        const MWWorld::ESMStore& mStore;
+        Resource::SceneManager* mSceneManager;
+        /// Copy of the encoder used to load the content files, as its conversion buffer is not thread safe
+        std::unique_ptr<ToUTF8::Utf8Encoder> mEncoder;
+        float mMinSize;
+        float mSimplificationRatio;
+
+        std::map<int, ESM::ESMReader> mReaders;
+
+        volatile bool mAbort;
+
+        osg::ref_ptr<osg::Node> mNode;
+    };
+
+    ObjectPaging::ObjectPaging(osg::Group* parent, Resource::SceneManager* sceneManager, SceneUtil::WorkQueue* workQueue, SceneUtil::UnrefQueue* unrefQueue,
+                               ToUTF8::Utf8Encoder* encoder)
+        : mRootNode(new osg::Group)
+        , mSceneManager(sceneManager)
+        , mEncoder(encoder)
+        , mWorkQueue(workQueue)
+        , mUnrefQueue(unrefQueue)
+        , mViewDistance(0.f)
+        , mMinSize(std::max(0.f, Settings::Manager::getFloat("object paging min size", "Terrain")))
+        , mSimplificationRatio(std::min(1.f, std::max(0.01f, Settings::Manager::getFloat("object paging simplification ratio", "Terrain"))))
+        , mLastCenter(0, 0)
+        , mDirty(true)
+    {
+        mRootNode->setName("Object Paging Root");
+        mRootNode->setNodeMask(0);
+        parent->addChild(mRootNode);
+    }
+
+    ObjectPaging::~ObjectPaging()
+    {
+        clear();
+        for (unsigned int i=0; i<mRootNode->getNumParents(); ++i)
+            mRootNode->getParent(i)->removeChild(mRootNode);
+    }
+
+    void ObjectPaging::setViewDistance(float distance)
+    {
+        mViewDistance = distance;
+        mDirty = true;
+    }
+
+    void ObjectPaging::addActiveCell(int x, int y)
+    {
+        CellIndex index (x, y);
+        mActiveCells.insert(index);
+        mRootNode->setNodeMask(Mask_StaticBatch);
+
+        CellMap::iterator found = mCells.find(index);
+        if (found != mCells.end())
+            updateVisibility(index, found->second);
+    }
+
+    void ObjectPaging::removeActiveCell(int x, int y)
+    {
+        CellIndex index (x, y);
+        mActiveCells.erase(index);
+        if (mActiveCells.empty())
+            mRootNode->setNodeMask(0);
+
+        CellMap::iterator found = mCells.find(index);
+        if (found != mCells.end())
+            updateVisibility(index, found->second);
+        mDirty = true;
+    }
+
+    void ObjectPaging::updateVisibility(const CellIndex& index, Cell& cell)
+    {
+        if (cell.mNode)
+            cell.mNode->setNodeMask(mActiveCells.count(index) ? 0 : ~0u);
+    }
+
+    void ObjectPaging::removeCell(Cell& cell)
+    {
+        if (cell.mWorkItem)
+        {
+            cell.mWorkItem->cancel();
+            mUnrefQueue->push(cell.mWorkItem);
+        }
+        if (cell.mNode)
+        {
+            mRootNode->removeChild(cell.mNode);
+            mUnrefQueue->push(cell.mNode);
+        }
+    }
+
+    void ObjectPaging::clear()
+    {
+        for (CellMap::iterator it = mCells.begin(); it != mCells.end(); ++it)
+        {
+            if (it->second.mWorkItem)
+            {
+                it->second.mWorkItem->cancel();
+                it->second.mWorkItem->waitTillDone();
+            }
+        }
+        mCells.clear();
+        mRootNode->removeChildren(0, mRootNode->getNumChildren());
+        mDirty = true;
+    }
+
+    void ObjectPaging::update(const osg::Vec3f& viewPoint)
+    {
+        for (CellMap::iterator it = mCells.begin(); it != mCells.end(); ++it)
+        {
+            Cell& cell = it->second;
+            if (cell.mWorkItem && cell.mWorkItem->isDone())
+            {
+                cell.mNode = static_cast<CellObjectsItem*>(cell.mWorkItem.get())->getNode();
+                // do the deletion of the item's readers in the background thread
+                mUnrefQueue->push(cell.mWorkItem);
+                cell.mWorkItem = NULL;
+
+                if (cell.mNode)
+                {
+                    updateVisibility(it->first, cell);
+                    mRootNode->addChild(cell.mNode);
+                }
+            }
+        }
+
+        if (mActiveCells.empty())
+            return;
+
+        const float cellSize = ESM::Land::REAL_SIZE;
+        CellIndex center (static_cast<int>(std::floor(viewPoint.x() / cellSize)), static_cast<int>(std::floor(viewPoint.y() / cellSize)));
+        if (center == mLastCenter && !mDirty)
+            return;
+        mLastCenter = center;
+        mDirty = false;
+
+        const int range = static_cast<int>(std::ceil(mViewDistance / cellSize));
+
+        for (CellMap::iterator it = mCells.begin(); it != mCells.end();)
+        {
+            if (std::abs(it->first.first - center.first) > range + 1 || std::abs(it->first.second - center.second) > range + 1)
+            {
+                removeCell(it->second);
+                mCells.erase(it++);
+            }
+            else
+                ++it;
+        }
+
+        std::vector<CellIndex> requests;
+        for (int x = center.first - range; x <= center.first + range; ++x)
+        {
+            for (int y = center.second - range; y <= center.second + range; ++y)
+            {
+                CellIndex index (x, y);
+                if (!mActiveCells.count(index) && !mCells.count(index))
+                    requests.push_back(index);
+            }
+        }
+
+        // build the nearest cells first
+        std::sort(requests.begin(), requests.end(), CompareDistance(center));
+
+        const MWWorld::ESMStore& store = MWBase::Environment::get().getWorld()->getStore();
+        for (std::vector<CellIndex>::const_iterator it = requests.begin(); it != requests.end(); ++it)
+        {
+            Cell& cell = mCells[*it];
+
+            const ESM::Cell* esmCell = store.get<ESM::Cell>().search(it->first, it->second);
+            if (!esmCell || esmCell->mContextList.empty())
+                continue;
+
+            cell.mWorkItem = new CellObjectsItem(esmCell, mSceneManager, mEncoder, mMinSize, mSimplificationRatio);
+            // nearer cells are more likely to be seen, but all of them are less important than the cells that are loaded
+            cell.mWorkItem->setPriority(SceneUtil::WorkQueue::Priority_Low - CompareDistance(center).distance(*it));
+            mWorkQueue->addWorkItem(cell.mWorkItem);
+        }
+    }
+
+}
@@ -0,0 +1,96 @@
+#ifndef OPENMW_MWRENDER_OBJECTPAGING_H
+#define OPENMW_MWRENDER_OBJECTPAGING_H
+
+#include <map>
+#include <set>
+
+#include <osg/ref_ptr>
+#include <osg/Vec3f>
+
+namespace osg
+{
+    class Group;
+    class Node;
+}
+
+namespace Resource
+{
+    class SceneManager;
+}
+
+namespace SceneUtil
+{
+    class WorkQueue;
+    class WorkItem;
+    class UnrefQueue;
+}
+
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
+namespace MWRender
+{
+
+    /// @brief Draws the static objects of the exterior cells beyond the active grid, up to the view distance.
+    /// @par The objects of each cell are merged into a StaticBatch and simplified on a worker thread. Their references
+    /// are read directly from the content files, so the cells don't need to be loaded. As a consequence, changes made
+    /// to these objects during the game are only shown once their cell becomes active.
+    /// @par Cells stay cached while they are within one cell of the paging range, so moving back and forth across a
+    /// cell border does not rebuild them.
+    class ObjectPaging
+    {
+    public:
+        /// @param encoder The encoder used to load the content files, or NULL. Must outlive the ObjectPaging.
+        ObjectPaging(osg::Group* parent, Resource::SceneManager* sceneManager, SceneUtil::WorkQueue* workQueue, SceneUtil::UnrefQueue* unrefQueue,
+                     ToUTF8::Utf8Encoder* encoder);
+        ~ObjectPaging();
+
+        void setViewDistance(float distance);
+
+        /// The objects of active cells are drawn by MWRender::Objects, so they are hidden here.
+        /// Nothing is drawn while there are no active exterior cells.
+        void addActiveCell(int x, int y);
+        void removeActiveCell(int x, int y);
+
+        /// Request the cells in range of the view point, and show the ones that have finished building.
+        void update(const osg::Vec3f& viewPoint);
+
+        /// Drop all cells, waiting for the ones that are currently being built.
+        void clear();
+
+    private:
+        typedef std::pair<int, int> CellIndex;
+
+        struct Cell
+        {
+            osg::ref_ptr<SceneUtil::WorkItem> mWorkItem;
+            osg::ref_ptr<osg::Node> mNode;
+        };
+
+        void removeCell(Cell& cell);
+        void updateVisibility(const CellIndex& index, Cell& cell);
+
+        osg::ref_ptr<osg::Group> mRootNode;
+        Resource::SceneManager* mSceneManager;
+        osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+        osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
+        ToUTF8::Utf8Encoder* mEncoder;
+
+        float mViewDistance;
+        float mMinSize;
+        float mSimplificationRatio;
+
+        typedef std::map<CellIndex, Cell> CellMap;
+        CellMap mCells;
+
+        std::set<CellIndex> mActiveCells;
+
+        CellIndex mLastCenter;
+        bool mDirty;
+    };
+
+}
+
+#endif
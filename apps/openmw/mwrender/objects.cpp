@@ -6,6 +6,7 @@
 #include <osg/UserDataContainer>
 
 #include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/sceneutil/boundinghierarchy.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
 
 #include "../mwworld/ptr.hpp"
@@ -17,6 +18,27 @@
 #include "vismask.hpp"
 
 
+namespace
+{
+
+    /// Maximum number of objects in a leaf of a cell's bounding volume hierarchy
+    const unsigned int sMaxObjectsPerLeaf = 8;
+
+    /// Collect the objects below the groups of a hierarchy. Objects are the only transforms in the hierarchy.
+    void collectObjects(osg::Group* group, std::vector<osg::ref_ptr<osg::Node> >& objects)
+    {
+        for (unsigned int i=0; i<group->getNumChildren(); ++i)
+        {
+            osg::Node* child = group->getChild(i);
+            if (child->asTransform())
+                objects.push_back(child);
+            else if (child->asGroup())
+                collectObjects(child->asGroup(), objects);
+        }
+    }
+
+}
+
 namespace MWRender
 {
 
@@ -115,6 +137,9 @@ bool Objects::removeObject (const MWWorld::Ptr& ptr)
     if(!ptr.getRefData().getBaseNode())
         return true;
 
+    if (ptr.getRefData().getBaseNode()->getNodeMask() == Mask_BatchedObject)
+        removeStaticBatch(ptr.getCell());
+
     PtrAnimationMap::iterator iter = mObjects.find(ptr);
     if(iter != mObjects.end())
     {
@@ -170,6 +195,117 @@ void Objects::removeCell(const MWWorld::CellStore* store)
             mUnrefQueue->push(cell->second);
         mCellSceneNodes.erase(cell);
     }
+    mCellHierarchies.erase(store);
+    mStaticBatches.erase(store);
+}
+
+void Objects::buildCellHierarchy(const MWWorld::CellStore* store)
+{
+    flattenCellHierarchy(store);
+
+    CellMap::iterator cell = mCellSceneNodes.find(store);
+    if (cell == mCellSceneNodes.end())
+        return;
+    osg::Group* cellnode = cell->second;
+
+    std::vector<osg::ref_ptr<osg::Node> > nodes;
+    for (unsigned int i=0; i<cellnode->getNumChildren(); ++i)
+    {
+        osg::Node* child = cellnode->getChild(i);
+        // actors move all the time, which would keep enlarging the bounds of the hierarchy
+        if (child->getNodeMask() == Mask_Actor || child->getNodeMask() == Mask_StaticBatch)
+            continue;
+        nodes.push_back(child);
+    }
+
+    if (nodes.size() <= sMaxObjectsPerLeaf)
+        return;
+
+    for (std::vector<osg::ref_ptr<osg::Node> >::iterator it = nodes.begin(); it != nodes.end(); ++it)
+        cellnode->removeChild(*it);
+
+    osg::ref_ptr<osg::Group> hierarchy (new osg::Group);
+    hierarchy->setName("Cell Hierarchy");
+    SceneUtil::buildBoundingVolumeHierarchy(nodes, hierarchy, sMaxObjectsPerLeaf);
+    cellnode->addChild(hierarchy);
+    mCellHierarchies[store] = hierarchy;
+}
+
+void Objects::flattenCellHierarchy(const MWWorld::CellStore* store)
+{
+    CellMap::iterator hierarchy = mCellHierarchies.find(store);
+    if (hierarchy == mCellHierarchies.end())
+        return;
+
+    std::vector<osg::ref_ptr<osg::Node> > objects;
+    collectObjects(hierarchy->second, objects);
+
+    osg::Group* cellnode = mCellSceneNodes[store];
+    cellnode->removeChild(hierarchy->second);
+    for (std::vector<osg::ref_ptr<osg::Node> >::iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+        (*it)->getParent(0)->removeChild(*it);
+        cellnode->addChild(*it);
+    }
+
+    mCellHierarchies.erase(hierarchy);
+}
+
+void Objects::moveObject(const MWWorld::Ptr& ptr)
+{
+    osg::Node* objectNode = ptr.getRefData().getBaseNode();
+    if (!objectNode || !objectNode->getNumParents())
+        return;
+
+    if (objectNode->getNodeMask() == Mask_BatchedObject)
+        removeStaticBatch(ptr.getCell());
+
+    CellMap::iterator cell = mCellSceneNodes.find(ptr.getCell());
+    if (cell == mCellSceneNodes.end() || objectNode->getParent(0) == cell->second)
+        return;
+
+    osg::ref_ptr<osg::Node> node (objectNode);
+    node->getParent(0)->removeChild(node);
+    cell->second->addChild(node);
+}
+
+void Objects::addStaticBatch(const MWWorld::CellStore* store, osg::Node* batch, const std::vector<MWWorld::Ptr>& objects)
+{
+    removeStaticBatch(store);
+
+    CellMap::iterator cell = mCellSceneNodes.find(store);
+    if (cell == mCellSceneNodes.end())
+        return;
+
+    StaticBatch& staticBatch = mStaticBatches[store];
+    staticBatch.mNode = batch;
+    batch->setNodeMask(Mask_StaticBatch);
+    cell->second->addChild(batch);
+
+    for (std::vector<MWWorld::Ptr>::const_iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+        osg::Node* objectNode = it->getRefData().getBaseNode();
+        objectNode->setNodeMask(Mask_BatchedObject);
+        staticBatch.mObjects.push_back(objectNode);
+    }
+}
+
+void Objects::removeStaticBatch(const MWWorld::CellStore* store)
+{
+    StaticBatchMap::iterator found = mStaticBatches.find(store);
+    if (found == mStaticBatches.end())
+        return;
+
+    for (std::vector<osg::ref_ptr<osg::Node> >::const_iterator it = found->second.mObjects.begin(); it != found->second.mObjects.end(); ++it)
+        (*it)->setNodeMask(~0u);
+
+    osg::ref_ptr<osg::Node> node = found->second.mNode;
+    if (node->getNumParents())
+        node->getParent(0)->removeChild(node);
+    if (mUnrefQueue.get())
+        mUnrefQueue->push(node);
+
+    mStaticBatches.erase(found);
 }
 
 void Objects::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur)
@@ -178,6 +314,9 @@ void Objects::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur)
     if (!objectNode)
         return;
 
+    if (objectNode->getNodeMask() == Mask_BatchedObject)
+        removeStaticBatch(old.getCell());
+
     MWWorld::CellStore *newCell = cur.getCell();
 
     osg::Group* cellnode;
@@ -4,6 +4,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <osg/ref_ptr>
 #include <osg/Object>
@@ -13,6 +14,7 @@
 namespace osg
 {
     class Group;
+    class Node;
 }
 
 namespace Resource
@@ -61,8 +63,19 @@ class Objects{
 
     typedef std::map<const MWWorld::CellStore*, osg::ref_ptr<osg::Group> > CellMap;
     CellMap mCellSceneNodes;
+    /// Root of the bounding volume hierarchy of each cell, a child of the cell's scene node
+    CellMap mCellHierarchies;
     PtrAnimationMap mObjects;
 
+    struct StaticBatch
+    {
+        osg::ref_ptr<osg::Node> mNode;
+        /// Scene nodes of the objects drawn through the batch
+        std::vector<osg::ref_ptr<osg::Node> > mObjects;
+    };
+    typedef std::map<const MWWorld::CellStore*, StaticBatch> StaticBatchMap;
+    StaticBatchMap mStaticBatches;
+
     osg::ref_ptr<osg::Group> mRootNode;
 
     Resource::ResourceSystem* mResourceSystem;
@@ -90,6 +103,26 @@ public:
 
     void removeCell(const MWWorld::CellStore* store);
 
+    /// Arrange the objects of a cell in a bounding volume hierarchy, so that the cull traversal can skip whole regions
+    /// of the cell at once. Actors, and objects inserted later, stay directly below the cell's scene node.
+    /// @note Replaces an existing hierarchy of the cell.
+    void buildCellHierarchy(const MWWorld::CellStore* store);
+
+    /// Move the objects of a cell's bounding volume hierarchy back below the cell's scene node.
+    void flattenCellHierarchy(const MWWorld::CellStore* store);
+
+    /// Take a moved, rotated or scaled object out of its cell's bounding volume hierarchy, so the bounds of the hierarchy
+    /// stay tight, and out of its cell's static batch.
+    void moveObject(const MWWorld::Ptr& ptr);
+
+    /// Draw the given static objects of a cell through the merged geometry in \a batch, rather than individually.
+    /// The objects remain in the scene graph for intersection tests.
+    /// @note Replaces an existing static batch of the cell.
+    void addStaticBatch(const MWWorld::CellStore* store, osg::Node* batch, const std::vector<MWWorld::Ptr>& objects);
+
+    /// Remove the static batch of a cell, so that its objects are drawn individually again.
+    void removeStaticBatch(const MWWorld::CellStore* store);
+
     /// Updates containing cell for object rendering data
     void updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur);
 
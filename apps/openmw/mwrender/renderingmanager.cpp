@@ -3,6 +3,7 @@
 #include <stdexcept>
 #include <limits>
 #include <cstdlib>
+#include <algorithm>
 
 #include <osg/Light>
 #include <osg/LightModel>
@@ -50,6 +51,7 @@
 #include "water.hpp"
 #include "terrainstorage.hpp"
 #include "util.hpp"
+#include "objectpaging.hpp"
 
 namespace MWRender
 {
@@ -167,7 +169,7 @@ namespace MWRender
     };
 
     RenderingManager::RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode, Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
-                                       const Fallback::Map* fallback, const std::string& resourcePath)
+                                       const Fallback::Map* fallback, const std::string& resourcePath, ToUTF8::Utf8Encoder* encoder)
         : mViewer(viewer)
         , mRootNode(rootNode)
         , mResourceSystem(resourceSystem)
@@ -204,6 +206,9 @@ namespace MWRender
 
         mObjects.reset(new Objects(mResourceSystem, sceneRoot, mUnrefQueue.get()));
 
+        if (Settings::Manager::getBool("object paging", "Terrain"))
+            mObjectPaging.reset(new ObjectPaging(sceneRoot, mResourceSystem->getSceneManager(), mWorkQueue.get(), mUnrefQueue.get(), encoder));
+
         if (getenv("OPENMW_DONT_PRECOMPILE") == NULL)
             mViewer->setIncrementalCompileOperation(new osgUtil::IncrementalCompileOperation);
 
@@ -273,10 +278,12 @@ namespace MWRender
         mViewer->getCamera()->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
         mViewer->getCamera()->setCullingMode(cullingMode);
 
-        mViewer->getCamera()->setCullMask(~(Mask_UpdateVisitor|Mask_SimpleWater));
+        mViewer->getCamera()->setCullMask(~(Mask_UpdateVisitor|Mask_SimpleWater|Mask_BatchedObject));
 
         mNearClip = Settings::Manager::getFloat("near clip", "Camera");
         mViewDistance = Settings::Manager::getFloat("viewing distance", "Camera");
+        if (mObjectPaging)
+            mObjectPaging->setViewDistance(mViewDistance);
         mFieldOfView = Settings::Manager::getFloat("field of view", "Camera");
         mFirstPersonFieldOfView = Settings::Manager::getFloat("first person field of view", "Camera");
         updateProjectionMatrix();
@@ -413,15 +420,29 @@ namespace MWRender
         mWater->changeCell(store);
 
         if (store->getCell()->isExterior())
+        {
             mTerrain->loadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+            if (mObjectPaging)
+                mObjectPaging->addActiveCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+        }
     }
+
+    void RenderingManager::finishCell(const MWWorld::CellStore *store)
+    {
+        mObjects->buildCellHierarchy(store);
+    }
+
     void RenderingManager::removeCell(const MWWorld::CellStore *store)
     {
         mPathgrid->removeCell(store);
         mObjects->removeCell(store);
 
         if (store->getCell()->isExterior())
+        {
             mTerrain->unloadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+            if (mObjectPaging)
+                mObjectPaging->removeActiveCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+        }
 
         mWater->removeCell(store);
     }
@@ -502,6 +523,9 @@ namespace MWRender
         osg::Vec3f focal, cameraPos;
         mCamera->getPosition(focal, cameraPos);
         mCurrentCameraPos = cameraPos;
+
+        if (mObjectPaging)
+            mObjectPaging->update(cameraPos);
         if (mWater->isUnderwater(cameraPos))
         {
             float viewDistance = mViewDistance;
@@ -549,21 +573,29 @@ namespace MWRender
         }
 
         ptr.getRefData().getBaseNode()->setAttitude(rot);
+        mObjects->moveObject(ptr);
     }
 
     void RenderingManager::moveObject(const MWWorld::Ptr &ptr, const osg::Vec3f &pos)
     {
         ptr.getRefData().getBaseNode()->setPosition(pos);
+        mObjects->moveObject(ptr);
     }
 
     void RenderingManager::scaleObject(const MWWorld::Ptr &ptr, const osg::Vec3f &scale)
     {
         ptr.getRefData().getBaseNode()->setScale(scale);
+        mObjects->moveObject(ptr);
 
         if (ptr == mCamera->getTrackingPtr()) // update height of camera
             mCamera->processViewChange();
     }
 
+    void RenderingManager::addStaticBatch(const MWWorld::CellStore *store, osg::Node *batch, const std::vector<MWWorld::Ptr> &objects)
+    {
+        mObjects->addStaticBatch(store, batch, objects);
+    }
+
     void RenderingManager::removeObject(const MWWorld::Ptr &ptr)
     {
         mObjects->removeObject(ptr);
@@ -740,7 +772,7 @@ namespace MWRender
         mIntersectionVisitor->setIntersector(intersector);
 
         int mask = ~0;
-        mask &= ~(Mask_RenderToTexture|Mask_Sky|Mask_Debug|Mask_Effect|Mask_Water|Mask_SimpleWater);
+        mask &= ~(Mask_RenderToTexture|Mask_Sky|Mask_Debug|Mask_Effect|Mask_Water|Mask_SimpleWater|Mask_StaticBatch);
         if (ignorePlayer)
             mask &= ~(Mask_Player);
         if (ignoreActors)
@@ -930,6 +962,8 @@ namespace MWRender
             stats->setAttribute(frameNumber, "UnrefQueue", mUnrefQueue->getNumItems());
 
             mTerrain->reportStats(frameNumber, stats);
+
+            static_cast<const SceneUtil::LightManager*>(mSceneRoot.get())->reportStats(frameNumber, stats);
         }
     }
 
@@ -945,6 +979,8 @@ namespace MWRender
             else if (it->first == "Camera" && it->second == "viewing distance")
             {
                 mViewDistance = Settings::Manager::getFloat("viewing distance", "Camera");
+                if (mObjectPaging)
+                    mObjectPaging->setViewDistance(mViewDistance);
                 mStateUpdater->setFogEnd(mViewDistance);
                 updateProjectionMatrix();
             }
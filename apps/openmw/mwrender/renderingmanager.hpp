@@ -43,6 +43,11 @@ namespace Terrain
     class World;
 }
 
+namespace ToUTF8
+{
+    class Utf8Encoder;
+}
+
 namespace Fallback
 {
     class Map;
@@ -58,6 +63,7 @@ namespace MWRender
 {
 
     class StateUpdater;
+    class ObjectPaging;
 
     class EffectManager;
     class SkyManager;
@@ -72,7 +78,7 @@ namespace MWRender
     {
     public:
         RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode, Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
-                         const Fallback::Map* fallback, const std::string& resourcePath);
+                         const Fallback::Map* fallback, const std::string& resourcePath, ToUTF8::Utf8Encoder* encoder);
         ~RenderingManager();
 
         MWRender::Objects& getObjects();
@@ -106,6 +112,9 @@ namespace MWRender
         void configureFog(float fogDepth, float underwaterFog, const osg::Vec4f& colour);
 
         void addCell(const MWWorld::CellStore* store);
+        /// Arrange the objects of a cell once all of them are inserted.
+        /// @see Objects::buildCellHierarchy
+        void finishCell(const MWWorld::CellStore* store);
         void removeCell(const MWWorld::CellStore* store);
 
         void enableTerrain(bool enable);
@@ -118,6 +127,10 @@ namespace MWRender
 
         void removeObject(const MWWorld::Ptr& ptr);
 
+        /// Draw the given static objects of an active cell through merged geometry.
+        /// @see Objects::addStaticBatch
+        void addStaticBatch(const MWWorld::CellStore* store, osg::Node* batch, const std::vector<MWWorld::Ptr>& objects);
+
         void setWaterEnabled(bool enabled);
         void setWaterHeight(float level);
 
@@ -226,6 +239,7 @@ namespace MWRender
 
         std::unique_ptr<Pathgrid> mPathgrid;
         std::unique_ptr<Objects> mObjects;
+        std::unique_ptr<ObjectPaging> mObjectPaging;
         std::unique_ptr<Water> mWater;
         std::unique_ptr<Terrain::World> mTerrain;
         TerrainStorage* mTerrainStorage;
@@ -0,0 +1,434 @@
+#include "staticbatch.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/TriangleIndexFunctor>
+#include <osg/Switch>
+#include <osg/LOD>
+#include <osg/Sequence>
+#include <osg/Billboard>
+
+#include <components/resource/scenemanager.hpp>
+#include <components/sceneutil/lightmanager.hpp>
+
+#include "vismask.hpp"
+
+namespace
+{
+
+    /// Size of the square regions of the world that objects are grouped into
+    const float sChunkSize = 2048.f;
+
+    /// Maximum number of vertices of a merged geometry, so that 16 bit indices can be used
+    const unsigned int sMaxVertices = 65536;
+
+    /// Texture unit that Shader::ShaderVisitor stores generated tangents in
+    const unsigned int sTangentUnit = 7;
+    const unsigned int sNumTextureUnits = 8;
+
+    enum Layout
+    {
+        Layout_Normals = 1<<0,
+        Layout_Colors = 1<<1,
+        Layout_FirstTexCoord = 1<<2 // followed by one bit per texture unit
+    };
+
+    /// Describe which vertex arrays a geometry has, so that only geometries with the same arrays are merged.
+    /// @return false if the geometry has arrays that can not be merged.
+    bool getLayout(const osg::Geometry& geometry, unsigned int& layout)
+    {
+        const osg::Array* vertices = geometry.getVertexArray();
+        if (!dynamic_cast<const osg::Vec3Array*>(vertices) || vertices->getNumElements() > sMaxVertices)
+            return false;
+        const unsigned int numVertices = vertices->getNumElements();
+
+        if (!geometry.getVertexAttribArrayList().empty() || geometry.getFogCoordArray() || geometry.getSecondaryColorArray())
+            return false;
+
+        layout = 0;
+
+        const osg::Array* normals = geometry.getNormalArray();
+        if (normals)
+        {
+            if (!dynamic_cast<const osg::Vec3Array*>(normals) || normals->getBinding() != osg::Array::BIND_PER_VERTEX
+                    || normals->getNumElements() != numVertices)
+                return false;
+            layout |= Layout_Normals;
+        }
+
+        const osg::Array* colors = geometry.getColorArray();
+        if (colors)
+        {
+            if (!dynamic_cast<const osg::Vec4Array*>(colors) || colors->getBinding() != osg::Array::BIND_PER_VERTEX
+                    || colors->getNumElements() != numVertices)
+                return false;
+            layout |= Layout_Colors;
+        }
+
+        for (unsigned int unit=0; unit<geometry.getNumTexCoordArrays(); ++unit)
+        {
+            const osg::Array* texCoords = geometry.getTexCoordArray(unit);
+            if (!texCoords)
+                continue;
+            if (unit >= sNumTextureUnits || texCoords->getNumElements() != numVertices)
+                return false;
+            if (unit == sTangentUnit ? !dynamic_cast<const osg::Vec4Array*>(texCoords) : !dynamic_cast<const osg::Vec2Array*>(texCoords))
+                return false;
+            layout |= (Layout_FirstTexCoord << unit);
+        }
+
+        for (unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+        {
+            // points and lines would be lost when collecting triangles
+            GLenum mode = geometry.getPrimitiveSet(i)->getMode();
+            if (mode < GL_TRIANGLES || mode > GL_POLYGON)
+                return false;
+        }
+
+        return true;
+    }
+
+    struct DrawableEntry
+    {
+        const osg::Geometry* mGeometry;
+        osg::Matrix mMatrix;
+        osg::ref_ptr<osg::StateSet> mStateSet;
+        unsigned int mLayout;
+    };
+
+    /// Collect the geometries of a mesh along with their transform and accumulated render state.
+    class CollectGeometryVisitor : public osg::NodeVisitor
+    {
+    public:
+        CollectGeometryVisitor(std::vector<DrawableEntry>& out)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mOut(out)
+            , mBatchable(true)
+        {
+            mStateSets.push_back(new osg::StateSet);
+            mMatrices.push_back(osg::Matrix());
+        }
+
+        bool isBatchable() const
+        {
+            return mBatchable;
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (!checkNode(node))
+                return;
+
+            bool pushedStateSet = pushStateSet(node.getStateSet());
+            traverse(node);
+            if (pushedStateSet)
+                mStateSets.pop_back();
+        }
+
+        virtual void apply(osg::Transform& transform)
+        {
+            if (!checkNode(transform))
+                return;
+
+            osg::Matrix matrix = mMatrices.back();
+            transform.computeLocalToWorldMatrix(matrix, this);
+            mMatrices.push_back(matrix);
+
+            bool pushedStateSet = pushStateSet(transform.getStateSet());
+            traverse(transform);
+            if (pushedStateSet)
+                mStateSets.pop_back();
+
+            mMatrices.pop_back();
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            if (!checkNode(drawable))
+                return;
+
+            // only plain geometry can be merged, not derived classes such as particle systems or skinned meshes
+            if (std::strcmp(drawable.libraryName(), "osg") != 0 || std::strcmp(drawable.className(), "Geometry") != 0
+                    || drawable.getDrawCallback())
+            {
+                mBatchable = false;
+                return;
+            }
+
+            DrawableEntry entry;
+            entry.mGeometry = drawable.asGeometry();
+            entry.mMatrix = mMatrices.back();
+            if (!getLayout(*entry.mGeometry, entry.mLayout))
+            {
+                mBatchable = false;
+                return;
+            }
+
+            bool pushedStateSet = pushStateSet(drawable.getStateSet());
+            entry.mStateSet = mStateSets.back();
+            if (pushedStateSet)
+                mStateSets.pop_back();
+
+            // merged geometry can not be depth sorted per object
+            if (entry.mStateSet->getRenderingHint() == osg::StateSet::TRANSPARENT_BIN
+                    || entry.mStateSet->getRenderBinMode() != osg::StateSet::INHERIT_RENDERBIN_DETAILS)
+            {
+                mBatchable = false;
+                return;
+            }
+
+            mOut.push_back(entry);
+        }
+
+    private:
+        bool checkNode(osg::Node& node)
+        {
+            if (!mBatchable)
+                return false;
+
+            // hidden nodes are not drawn, so they can be left out of the batch
+            if (!(node.getNodeMask() & ~MWRender::Mask_UpdateVisitor))
+                return false;
+
+            if (node.getUpdateCallback() || node.getCullCallback() || node.getEventCallback()
+                    || dynamic_cast<osg::Switch*>(&node) || dynamic_cast<osg::LOD*>(&node) || dynamic_cast<osg::Sequence*>(&node)
+                    || dynamic_cast<osg::Billboard*>(&node) || node.asCamera())
+            {
+                mBatchable = false;
+                return false;
+            }
+            return true;
+        }
+
+        bool pushStateSet(const osg::StateSet* stateset)
+        {
+            if (!stateset)
+                return false;
+
+            if (stateset->getUpdateCallback() || stateset->getEventCallback())
+                mBatchable = false;
+
+            osg::ref_ptr<osg::StateSet> merged (new osg::StateSet(*mStateSets.back(), osg::CopyOp::SHALLOW_COPY));
+            merged->merge(*stateset);
+            mStateSets.push_back(merged);
+            return true;
+        }
+
+        std::vector<DrawableEntry>& mOut;
+        bool mBatchable;
+
+        std::vector<osg::ref_ptr<osg::StateSet> > mStateSets;
+        std::vector<osg::Matrix> mMatrices;
+    };
+
+    struct CollectTriangles
+    {
+        CollectTriangles()
+            : mIndices(NULL)
+            , mFlip(false)
+        {
+        }
+
+        void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+        {
+            if (p1 == p2 || p2 == p3 || p1 == p3)
+                return;
+            mIndices->push_back(p1);
+            mIndices->push_back(mFlip ? p3 : p2);
+            mIndices->push_back(mFlip ? p2 : p3);
+        }
+
+        std::vector<unsigned int>* mIndices;
+        bool mFlip;
+    };
+
+    osg::ref_ptr<osg::Geometry> createGeometry(osg::StateSet* stateset, unsigned int layout)
+    {
+        osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+        geometry->setUseDisplayList(false);
+        geometry->setUseVertexBufferObjects(true);
+        geometry->setStateSet(stateset);
+
+        geometry->setVertexArray(new osg::Vec3Array);
+        if (layout & Layout_Normals)
+            geometry->setNormalArray(new osg::Vec3Array, osg::Array::BIND_PER_VERTEX);
+        if (layout & Layout_Colors)
+            geometry->setColorArray(new osg::Vec4Array, osg::Array::BIND_PER_VERTEX);
+        for (unsigned int unit=0; unit<sNumTextureUnits; ++unit)
+        {
+            if (!(layout & (Layout_FirstTexCoord << unit)))
+                continue;
+            if (unit == sTangentUnit)
+                geometry->setTexCoordArray(unit, new osg::Vec4Array, osg::Array::BIND_PER_VERTEX);
+            else
+                geometry->setTexCoordArray(unit, new osg::Vec2Array, osg::Array::BIND_PER_VERTEX);
+        }
+        geometry->addPrimitiveSet(new osg::DrawElementsUShort(GL_TRIANGLES));
+        return geometry;
+    }
+
+    /// Append the vertices and triangles of \a source, transformed by \a matrix, to \a target.
+    /// @note Both geometries must have the same layout.
+    void appendGeometry(osg::Geometry& target, const osg::Geometry& source, const osg::Matrix& matrix)
+    {
+        osg::Vec3Array* vertices = static_cast<osg::Vec3Array*>(target.getVertexArray());
+        const osg::Vec3Array* sourceVertices = static_cast<const osg::Vec3Array*>(source.getVertexArray());
+        const unsigned int offset = vertices->size();
+
+        for (osg::Vec3Array::const_iterator it = sourceVertices->begin(); it != sourceVertices->end(); ++it)
+            vertices->push_back(*it * matrix);
+
+        // a mirroring transform flips the winding of the triangles
+        const bool mirrored = matrix(0,0) * (matrix(1,1) * matrix(2,2) - matrix(1,2) * matrix(2,1))
+                            - matrix(0,1) * (matrix(1,0) * matrix(2,2) - matrix(1,2) * matrix(2,0))
+                            + matrix(0,2) * (matrix(1,0) * matrix(2,1) - matrix(1,1) * matrix(2,0)) < 0;
+
+        if (target.getNormalArray())
+        {
+            osg::Vec3Array* normals = static_cast<osg::Vec3Array*>(target.getNormalArray());
+            const osg::Vec3Array* sourceNormals = static_cast<const osg::Vec3Array*>(source.getNormalArray());
+            // normals are transformed by the inverse transpose
+            const osg::Matrix inverse = osg::Matrix::inverse(matrix);
+            for (osg::Vec3Array::const_iterator it = sourceNormals->begin(); it != sourceNormals->end(); ++it)
+            {
+                osg::Vec3f normal = osg::Matrix::transform3x3(inverse, *it);
+                normal.normalize();
+                normals->push_back(normal);
+            }
+        }
+
+        if (target.getColorArray())
+        {
+            osg::Vec4Array* colors = static_cast<osg::Vec4Array*>(target.getColorArray());
+            const osg::Vec4Array* sourceColors = static_cast<const osg::Vec4Array*>(source.getColorArray());
+            colors->insert(colors->end(), sourceColors->begin(), sourceColors->end());
+        }
+
+        for (unsigned int unit=0; unit<target.getNumTexCoordArrays(); ++unit)
+        {
+            if (!target.getTexCoordArray(unit))
+                continue;
+
+            if (unit == sTangentUnit)
+            {
+                osg::Vec4Array* tangents = static_cast<osg::Vec4Array*>(target.getTexCoordArray(unit));
+                const osg::Vec4Array* sourceTangents = static_cast<const osg::Vec4Array*>(source.getTexCoordArray(unit));
+                for (osg::Vec4Array::const_iterator it = sourceTangents->begin(); it != sourceTangents->end(); ++it)
+                {
+                    osg::Vec3f tangent = osg::Matrix::transform3x3(osg::Vec3f(it->x(), it->y(), it->z()), matrix);
+                    tangent.normalize();
+                    // the w component gives the handedness of the tangent space, which a mirroring transform flips
+                    tangents->push_back(osg::Vec4f(tangent, mirrored ? -it->w() : it->w()));
+                }
+            }
+            else
+            {
+                osg::Vec2Array* texCoords = static_cast<osg::Vec2Array*>(target.getTexCoordArray(unit));
+                const osg::Vec2Array* sourceTexCoords = static_cast<const osg::Vec2Array*>(source.getTexCoordArray(unit));
+                texCoords->insert(texCoords->end(), sourceTexCoords->begin(), sourceTexCoords->end());
+            }
+        }
+
+        std::vector<unsigned int> indices;
+        osg::TriangleIndexFunctor<CollectTriangles> functor;
+        functor.mIndices = &indices;
+        functor.mFlip = mirrored;
+        source.accept(functor);
+
+        osg::DrawElementsUShort* primitives = static_cast<osg::DrawElementsUShort*>(target.getPrimitiveSet(0));
+        for (std::vector<unsigned int>::const_iterator it = indices.begin(); it != indices.end(); ++it)
+            primitives->push_back(static_cast<unsigned short>(offset + *it));
+    }
+
+}
+
+namespace MWRender
+{
+
+    bool StaticBatch::StateSetLess::operator()(const osg::ref_ptr<osg::StateSet>& left, const osg::ref_ptr<osg::StateSet>& right) const
+    {
+        return left->compare(*right, true) < 0;
+    }
+
+    StaticBatch::StaticBatch(Resource::SceneManager* sceneManager)
+        : mSceneManager(sceneManager)
+    {
+    }
+
+    StaticBatch::~StaticBatch()
+    {
+    }
+
+    osg::StateSet* StaticBatch::getSharedStateSet(osg::StateSet* stateset)
+    {
+        return mStateSets.insert(stateset).first->get();
+    }
+
+    osg::Geometry* StaticBatch::getTargetGeometry(Chunk& chunk, osg::StateSet* stateset, unsigned int layout, unsigned int numVertices)
+    {
+        GeometryKey key (stateset, layout);
+        std::map<GeometryKey, osg::Geometry*>::iterator found = chunk.mOpenGeometries.find(key);
+        if (found != chunk.mOpenGeometries.end() && found->second->getVertexArray()->getNumElements() + numVertices <= sMaxVertices)
+            return found->second;
+
+        osg::ref_ptr<osg::Geometry> geometry = createGeometry(stateset, layout);
+        chunk.mGeometries.push_back(geometry);
+        chunk.mOpenGeometries[key] = geometry.get();
+        return geometry.get();
+    }
+
+    bool StaticBatch::addObject(const std::string &mesh, const osg::Matrix &worldMatrix)
+    {
+        osg::ref_ptr<const osg::Node> node = mSceneManager->getTemplate(mesh);
+
+        std::vector<DrawableEntry> drawables;
+        CollectGeometryVisitor visitor (drawables);
+        const_cast<osg::Node*>(node.get())->accept(visitor); // const-trickery required because there is no const version of NodeVisitor
+        if (!visitor.isBatchable())
+            return false;
+
+        const osg::Vec3f position = worldMatrix.getTrans();
+        std::pair<int, int> chunkIndex (static_cast<int>(std::floor(position.x() / sChunkSize)),
+                                        static_cast<int>(std::floor(position.y() / sChunkSize)));
+        Chunk& chunk = mChunks[chunkIndex];
+        chunk.mOrigin = osg::Vec3f(chunkIndex.first * sChunkSize, chunkIndex.second * sChunkSize, 0.f);
+
+        // vertices are stored relative to the chunk's origin to keep the precision of the world space coordinates
+        osg::Matrix chunkMatrix (worldMatrix);
+        chunkMatrix.postMultTranslate(-chunk.mOrigin);
+
+        for (std::vector<DrawableEntry>::const_iterator it = drawables.begin(); it != drawables.end(); ++it)
+        {
+            osg::Geometry* target = getTargetGeometry(chunk, getSharedStateSet(it->mStateSet), it->mLayout,
+                                                      it->mGeometry->getVertexArray()->getNumElements());
+            appendGeometry(*target, *it->mGeometry, it->mMatrix * chunkMatrix);
+        }
+        return true;
+    }
+
+    osg::ref_ptr<osg::Group> StaticBatch::build()
+    {
+        osg::ref_ptr<osg::Group> root (new osg::Group);
+        root->setName("Static Batch");
+
+        for (ChunkMap::const_iterator it = mChunks.begin(); it != mChunks.end(); ++it)
+        {
+            if (it->second.mGeometries.empty())
+                continue;
+
+            osg::ref_ptr<osg::MatrixTransform> chunkNode (new osg::MatrixTransform(osg::Matrix::translate(it->second.mOrigin)));
+            chunkNode->addCullCallback(new SceneUtil::LightListCallback);
+            for (std::vector<osg::ref_ptr<osg::Geometry> >::const_iterator geometry = it->second.mGeometries.begin();
+                 geometry != it->second.mGeometries.end(); ++geometry)
+                chunkNode->addChild(*geometry);
+            root->addChild(chunkNode);
+        }
+
+        mChunks.clear();
+        return root;
+    }
+
+}
@@ -0,0 +1,78 @@
+#ifndef OPENMW_MWRENDER_STATICBATCH_H
+#define OPENMW_MWRENDER_STATICBATCH_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <osg/ref_ptr>
+#include <osg/Matrix>
+#include <osg/Vec3f>
+#include <osg/StateSet>
+
+namespace osg
+{
+    class Group;
+    class Geometry;
+}
+
+namespace Resource
+{
+    class SceneManager;
+}
+
+namespace MWRender
+{
+
+    /// @brief Merges the meshes of static objects into a few large drawables in world space.
+    /// @par Objects are grouped into square regions of the world, so that the merged geometry can still be culled and
+    /// lit per region. Within a region, all geometry with the same vertex layout and equivalent render state is
+    /// merged into one drawable.
+    /// @par Meshes that need to be updated or sorted per frame, such as animated or transparent meshes, can not be batched.
+    /// @note Does not modify the scene manager's templates, so it is safe to use from a worker thread.
+    class StaticBatch
+    {
+    public:
+        StaticBatch(Resource::SceneManager* sceneManager);
+        ~StaticBatch();
+
+        /// Add the mesh of an object with the given world transform.
+        /// @return false if the mesh can not be batched, in which case nothing was added.
+        bool addObject(const std::string& mesh, const osg::Matrix& worldMatrix);
+
+        /// Create the scene graph of the merged geometry of all added objects.
+        osg::ref_ptr<osg::Group> build();
+
+    private:
+        struct StateSetLess
+        {
+            bool operator()(const osg::ref_ptr<osg::StateSet>& left, const osg::ref_ptr<osg::StateSet>& right) const;
+        };
+
+        /// Return the StateSet that equivalent StateSets of all added geometries are replaced with.
+        osg::StateSet* getSharedStateSet(osg::StateSet* stateset);
+
+        typedef std::pair<osg::StateSet*, unsigned int> GeometryKey;
+
+        struct Chunk
+        {
+            osg::Vec3f mOrigin;
+            std::vector<osg::ref_ptr<osg::Geometry> > mGeometries;
+            // the geometry that further drawables with the same state and vertex layout are merged into
+            std::map<GeometryKey, osg::Geometry*> mOpenGeometries;
+        };
+
+        osg::Geometry* getTargetGeometry(Chunk& chunk, osg::StateSet* stateset, unsigned int layout, unsigned int numVertices);
+
+        Resource::SceneManager* mSceneManager;
+
+        typedef std::map<std::pair<int, int>, Chunk> ChunkMap;
+        ChunkMap mChunks;
+
+        std::set<osg::ref_ptr<osg::StateSet>, StateSetLess> mStateSets;
+    };
+
+}
+
+#endif
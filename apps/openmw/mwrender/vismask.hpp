@@ -51,7 +51,13 @@ namespace MWRender
         Mask_PreCompile = (1<<16),
 
         // Set on a camera's cull mask to enable the LightManager
-        Mask_Lighting = (1<<17)
+        Mask_Lighting = (1<<17),
+
+        // Set on static objects that are drawn through a static batch, so they are only used for intersection tests
+        Mask_BatchedObject = (1<<18),
+
+        // Set on the merged geometry of static objects, child of Scene. Not selectable by intersection tests.
+        Mask_StaticBatch = (1<<19)
     };
 
 }
@@ -12,12 +12,15 @@
 #include <components/terrain/world.hpp>
 #include <components/esmterrain/storage.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
+#include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/esm/loadcell.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
 
 #include "../mwrender/landmanager.hpp"
+#include "../mwrender/renderingmanager.hpp"
+#include "../mwrender/staticbatch.hpp"
 
 #include "cellstore.hpp"
 #include "manualref.hpp"
@@ -141,8 +144,7 @@ namespace MWWorld
                 }
                 catch (std::exception& e)
                 {
-                    // ignore error for now, would spam the log too much
-                    // error will be shown when visiting the cell
+                    std::cerr << "Error: failed to preload " << *it << ": " << e.what() << std::endl;
                 }
             }
         }
@@ -168,6 +170,110 @@ namespace MWWorld
         std::vector<osg::ref_ptr<const osg::Object> > mPreloadedObjects;
     };
 
+    /// Worker thread item: merge the meshes of the static objects in an active cell.
+    class StaticBatchItem : public SceneUtil::WorkItem
+    {
+    public:
+        /// Constructor to be called from the main thread.
+        StaticBatchItem(MWWorld::CellStore* cell, Resource::SceneManager* sceneManager)
+            : mSceneManager(sceneManager)
+            , mAbort(false)
+            , mHasBatchedObjects(false)
+        {
+            cell->forEachType<ESM::Static>(*this);
+        }
+
+        bool operator()(const MWWorld::Ptr& ptr)
+        {
+            SceneUtil::PositionAttitudeTransform* node = ptr.getRefData().getBaseNode();
+            if (!node || !ptr.getRefData().isEnabled() || ptr.getRefData().isDeleted())
+                return true;
+
+            Object object;
+            object.mPtr = ptr;
+            object.mMesh = ptr.getClass().getModel(ptr);
+            object.mNode = node;
+            node->computeLocalToWorldMatrix(object.mMatrix, NULL);
+            object.mBatched = false;
+            if (!object.mMesh.empty())
+                mObjects.push_back(object);
+            return true;
+        }
+
+        virtual void abort()
+        {
+            mAbort = true;
+        }
+
+        virtual void doWork()
+        {
+            MWRender::StaticBatch batch (mSceneManager);
+            for (std::vector<Object>::iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+            {
+                if (mAbort)
+                    return;
+
+                try
+                {
+                    it->mBatched = batch.addObject(it->mMesh, it->mMatrix);
+                    if (it->mBatched)
+                        mHasBatchedObjects = true;
+                }
+                catch (std::exception& e)
+                {
+                    // the object stays unbatched
+                    std::cerr << "Error: failed to batch " << it->mMesh << ": " << e.what() << std::endl;
+                }
+            }
+
+            if (mHasBatchedObjects)
+                mBatch = batch.build();
+        }
+
+        /// Return the merged geometry and the objects it contains, or NULL if any of these objects were moved or removed
+        /// since the item was created. To be called from the main thread once the item is done.
+        osg::ref_ptr<osg::Node> getBatch(std::vector<MWWorld::Ptr>& objects) const
+        {
+            if (!mBatch)
+                return NULL;
+
+            for (std::vector<Object>::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+            {
+                if (!it->mBatched)
+                    continue;
+
+                SceneUtil::PositionAttitudeTransform* node = it->mPtr.getRefData().getBaseNode();
+                if (node != it->mNode)
+                    return NULL;
+                osg::Matrix matrix;
+                node->computeLocalToWorldMatrix(matrix, NULL);
+                if (matrix != it->mMatrix)
+                    return NULL;
+
+                objects.push_back(it->mPtr);
+            }
+            return mBatch;
+        }
+
+    private:
+        struct Object
+        {
+            MWWorld::Ptr mPtr;
+            std::string mMesh;
+            osg::ref_ptr<osg::Node> mNode;
+            osg::Matrix mMatrix;
+            bool mBatched;
+        };
+
+        std::vector<Object> mObjects;
+        Resource::SceneManager* mSceneManager;
+
+        volatile bool mAbort;
+
+        bool mHasBatchedObjects;
+        osg::ref_ptr<osg::Node> mBatch;
+    };
+
     /// Worker thread item: update the resource system's cache, effectively deleting unused entries.
     class UpdateCacheItem : public SceneUtil::WorkItem
     {
@@ -197,6 +303,7 @@ namespace MWWorld
         , mMinCacheSize(0)
         , mMaxCacheSize(0)
         , mPreloadInstances(true)
+        , mBatchStatics(false)
         , mLastResourceCacheUpdate(0.0)
     {
     }
@@ -205,7 +312,7 @@ namespace MWWorld
     {
         if (mTerrainPreloadItem)
         {
-            mTerrainPreloadItem->abort();
+            mTerrainPreloadItem->cancel();
             mTerrainPreloadItem->waitTillDone();
             mTerrainPreloadItem = NULL;
         }
@@ -217,12 +324,20 @@ namespace MWWorld
         }
 
         for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end();++it)
-            it->second.mWorkItem->abort();
+            it->second.mWorkItem->cancel();
 
         for (PreloadMap::iterator it = mPreloadCells.begin(); it != mPreloadCells.end();++it)
             it->second.mWorkItem->waitTillDone();
 
         mPreloadCells.clear();
+
+        for (StaticBatchMap::iterator it = mStaticBatches.begin(); it != mStaticBatches.end(); ++it)
+            it->second->cancel();
+
+        for (StaticBatchMap::iterator it = mStaticBatches.begin(); it != mStaticBatches.end(); ++it)
+            it->second->waitTillDone();
+
+        mStaticBatches.clear();
     }
 
     void CellPreloader::preload(CellStore *cell, double timestamp)
@@ -263,7 +378,7 @@ namespace MWWorld
 
             if (oldestTimestamp + threshold < timestamp)
             {
-                oldestCell->second.mWorkItem->abort();
+                oldestCell->second.mWorkItem->cancel();
                 mPreloadCells.erase(oldestCell);
             }
             else
@@ -271,6 +386,8 @@ namespace MWWorld
         }
 
         osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mResourceSystem->getKeyframeManager(), mTerrain, mLandManager, mPreloadInstances));
+        // the player may enter the cell soon, so don't let it wait behind speculative work
+        item->setPriority(SceneUtil::WorkQueue::Priority_High);
         mWorkQueue->addWorkItem(item);
 
         mPreloadCells[cell] = PreloadEntry(timestamp, item);
@@ -284,7 +401,7 @@ namespace MWWorld
             // do the deletion in the background thread
             if (found->second.mWorkItem)
             {
-                found->second.mWorkItem->abort();
+                found->second.mWorkItem->cancel();
                 mUnrefQueue->push(mPreloadCells[cell].mWorkItem);
             }
 
@@ -298,12 +415,19 @@ namespace MWWorld
         {
             if (it->second.mWorkItem)
             {
-                it->second.mWorkItem->abort();
+                it->second.mWorkItem->cancel();
                 mUnrefQueue->push(it->second.mWorkItem);
             }
 
             mPreloadCells.erase(it++);
         }
+
+        for (StaticBatchMap::iterator it = mStaticBatches.begin(); it != mStaticBatches.end(); ++it)
+        {
+            it->second->cancel();
+            mUnrefQueue->push(it->second);
+        }
+        mStaticBatches.clear();
     }
 
     void CellPreloader::updateCache(double timestamp)
@@ -314,7 +438,7 @@ namespace MWWorld
             {
                 if (it->second.mWorkItem)
                 {
-                    it->second.mWorkItem->abort();
+                    it->second.mWorkItem->cancel();
                     mUnrefQueue->push(it->second.mWorkItem);
                 }
                 mPreloadCells.erase(it++);
@@ -352,6 +476,56 @@ namespace MWWorld
         mPreloadInstances = preload;
     }
 
+    void CellPreloader::setBatchStatics(bool batch)
+    {
+        mBatchStatics = batch;
+    }
+
+    void CellPreloader::batchStatics(CellStore *cell)
+    {
+        if (!mBatchStatics || !mWorkQueue)
+            return;
+
+        cancelStaticBatch(cell);
+
+        osg::ref_ptr<StaticBatchItem> item (new StaticBatchItem(cell, mResourceSystem->getSceneManager()));
+        mWorkQueue->addWorkItem(item);
+
+        mStaticBatches[cell] = item;
+    }
+
+    void CellPreloader::cancelStaticBatch(CellStore *cell)
+    {
+        StaticBatchMap::iterator found = mStaticBatches.find(cell);
+        if (found != mStaticBatches.end())
+        {
+            found->second->cancel();
+            mUnrefQueue->push(found->second);
+            mStaticBatches.erase(found);
+        }
+    }
+
+    void CellPreloader::updateStaticBatches(MWRender::RenderingManager& rendering)
+    {
+        for (StaticBatchMap::iterator it = mStaticBatches.begin(); it != mStaticBatches.end();)
+        {
+            if (!it->second->isDone())
+            {
+                ++it;
+                continue;
+            }
+
+            std::vector<MWWorld::Ptr> objects;
+            osg::ref_ptr<osg::Node> batch = static_cast<StaticBatchItem*>(it->second.get())->getBatch(objects);
+            if (batch)
+                rendering.addStaticBatch(it->first, batch, objects);
+
+            // do the deletion of the item's objects in the background thread
+            mUnrefQueue->push(it->second);
+            mStaticBatches.erase(it++);
+        }
+    }
+
     unsigned int CellPreloader::getMaxCacheSize() const
     {
         return mMaxCacheSize;
@@ -26,6 +26,7 @@ namespace SceneUtil
 namespace MWRender
 {
     class LandManager;
+    class RenderingManager;
 }
 
 namespace MWWorld
@@ -61,6 +62,20 @@ namespace MWWorld
         /// Enables the creation of instances in the preloading thread.
         void setPreloadInstances(bool preload);
 
+        /// Enables the merging of static objects in active cells, see batchStatics().
+        void setBatchStatics(bool batch);
+
+        /// Ask a background thread to merge the meshes of the static objects in this cell, to reduce the number of draw calls.
+        /// @note The cell must be active, i.e. its objects must have been inserted into the scene.
+        void batchStatics(MWWorld::CellStore* cell);
+
+        /// Cancel the merging of static objects in a cell that is being unloaded.
+        void cancelStaticBatch(MWWorld::CellStore* cell);
+
+        /// Hand the static batches that have finished building to the renderer.
+        /// @note Batches are dropped if any of their objects were changed in the meantime.
+        void updateStaticBatches(MWRender::RenderingManager& rendering);
+
         unsigned int getMaxCacheSize() const;
 
         void setWorkQueue(osg::ref_ptr<SceneUtil::WorkQueue> workQueue);
@@ -80,6 +95,7 @@ namespace MWWorld
         unsigned int mMinCacheSize;
         unsigned int mMaxCacheSize;
         bool mPreloadInstances;
+        bool mBatchStatics;
 
         double mLastResourceCacheUpdate;
 
@@ -103,6 +119,10 @@ namespace MWWorld
         // Cells that are currently being preloaded, or have already finished preloading
         PreloadMap mPreloadCells;
 
+        // Active cells whose static objects are currently being merged
+        typedef std::map<const MWWorld::CellStore*, osg::ref_ptr<SceneUtil::WorkItem> > StaticBatchMap;
+        StaticBatchMap mStaticBatches;
+
         std::vector<osg::ref_ptr<Terrain::View> > mTerrainViews;
         std::vector<osg::Vec3f> mTerrainPreloadPositions;
         osg::ref_ptr<SceneUtil::WorkItem> mTerrainPreloadItem;
@@ -2,9 +2,17 @@
 
 #include <limits>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <map>
 
+#include <osg/Quat>
+#include <osg/Timer>
+
+#include <components/esm/esmreader.hpp>
 #include <components/loadinglistener/loadinglistener.hpp>
 #include <components/misc/resourcehelpers.hpp>
+#include <components/misc/stringops.hpp>
 #include <components/settings/settings.hpp>
 #include <components/resource/resourcesystem.hpp>
 #include <components/resource/scenemanager.hpp>
@@ -14,10 +22,15 @@
 #include "../mwbase/soundmanager.hpp"
 #include "../mwbase/mechanicsmanager.hpp"
 #include "../mwbase/windowmanager.hpp"
+#include "../mwbase/dialoguemanager.hpp"
 
 #include "../mwrender/renderingmanager.hpp"
 #include "../mwrender/landmanager.hpp"
 
+#include "../mwmechanics/exteriorpathgrid.hpp"
+#include "../mwmechanics/creaturestats.hpp"
+#include "../mwmechanics/spells.hpp"
+
 #include "../mwphysics/physicssystem.hpp"
 
 #include "player.hpp"
@@ -135,36 +148,52 @@ namespace
         return true;
     }
 
-    void InsertVisitor::insert()
+    void rescaleObject(const MWWorld::Ptr& ptr)
     {
-        for (std::vector<MWWorld::Ptr>::iterator it = mToInsert.begin(); it != mToInsert.end(); ++it)
+        if (ptr.getCellRef().getScale()<0.5)
+            ptr.getCellRef().setScale(0.5);
+        else if (ptr.getCellRef().getScale()>2)
+            ptr.getCellRef().setScale(2);
+    }
+
+    void insertObject(const MWWorld::Ptr& ptr, bool rescale, MWPhysics::PhysicsSystem& physics,
+                      MWRender::RenderingManager& rendering)
+    {
+        if (rescale)
+            rescaleObject(ptr);
+
+        if (!ptr.getRefData().isDeleted() && ptr.getRefData().isEnabled())
         {
-            MWWorld::Ptr ptr = *it;
-            if (mRescale)
+            try
             {
-                if (ptr.getCellRef().getScale()<0.5)
-                    ptr.getCellRef().setScale(0.5);
-                else if (ptr.getCellRef().getScale()>2)
-                    ptr.getCellRef().setScale(2);
+                addObject(ptr, physics, rendering);
             }
-
-            if (!ptr.getRefData().isDeleted() && ptr.getRefData().isEnabled())
+            catch (const std::exception& e)
             {
-                try
-                {
-                    addObject(ptr, mPhysics, mRendering);
-                }
-                catch (const std::exception& e)
-                {
-                    std::string error ("failed to render '" + ptr.getCellRef().getRefId() + "': ");
-                    std::cerr << error + e.what() << std::endl;
-                }
+                std::string error ("failed to render '" + ptr.getCellRef().getRefId() + "': ");
+                std::cerr << error + e.what() << std::endl;
             }
+        }
+    }
+
+    void InsertVisitor::insert()
+    {
+        for (std::vector<MWWorld::Ptr>::iterator it = mToInsert.begin(); it != mToInsert.end(); ++it)
+        {
+            insertObject(*it, mRescale, mPhysics, mRendering);
 
             mLoadingListener.increaseProgress (1);
         }
     }
 
+    struct IsNotActor
+    {
+        bool operator() (const MWWorld::Ptr& ptr) const
+        {
+            return !ptr.getClass().isActor();
+        }
+    };
+
     struct AdjustPositionVisitor
     {
         bool operator() (const MWWorld::Ptr& ptr)
@@ -222,9 +251,12 @@ namespace MWWorld
             mPreloadTimer = 0.f;
         }
 
+        activatePendingCells();
+
         mRendering.update (duration, paused);
 
         mPreloader->updateCache(mRendering.getReferenceTime());
+        mPreloader->updateStaticBatches(mRendering);
     }
 
     void Scene::unloadCell (CellStoreCollection::iterator iter)
@@ -232,6 +264,18 @@ namespace MWWorld
         std::cout << "Unloading cell\n";
         ListAndResetObjectsVisitor visitor;
 
+        if (*iter == mInterventionTargetsCell)
+            mInterventionTargetsCell = NULL;
+
+        for (std::vector<PendingCell>::iterator it = mPendingCells.begin(); it != mPendingCells.end(); ++it)
+        {
+            if (it->mCell == *iter)
+            {
+                mPendingCells.erase(it);
+                break;
+            }
+        }
+
         (*iter)->forEach<ListAndResetObjectsVisitor>(visitor);
         for (std::vector<MWWorld::Ptr>::const_iterator iter2 (visitor.mObjects.begin());
             iter2!=visitor.mObjects.end(); ++iter2)
@@ -248,10 +292,13 @@ namespace MWWorld
                 );
             if (land && land->mDataTypes&ESM::Land::DATA_VHGT)
                 mPhysics->removeHeightField ((*iter)->getCell()->getGridX(), (*iter)->getCell()->getGridY());
+
+            mExteriorPathgridGraph->removeCell(*iter);
         }
 
         MWBase::Environment::get().getMechanicsManager()->drop (*iter);
 
+        mPreloader->cancelStaticBatch(*iter);
         mRendering.removeCell(*iter);
         MWBase::Environment::get().getWindowManager()->removeCell(*iter);
 
@@ -261,7 +308,7 @@ namespace MWWorld
         mActiveCells.erase(*iter);
     }
 
-    void Scene::loadCell (CellStore *cell, Loading::Listener* loadingListener, bool respawn)
+    void Scene::loadCell (CellStore *cell, Loading::Listener* loadingListener, bool respawn, bool incremental)
     {
         std::pair<CellStoreCollection::iterator, bool> result = mActiveCells.insert(cell);
 
@@ -300,9 +347,20 @@ namespace MWWorld
 
             // ... then references. This is important for adjustPosition to work correctly.
             /// \todo rescale depending on the state of a new GMST
-            insertCell (*cell, true, loadingListener);
+            if (incremental && mActivationBudget > 0)
+                deferInsertCell (*cell, true);
+            else
+            {
+                insertCell (*cell, true, loadingListener);
+                finishCellActivation(cell);
+            }
 
+            if (cell->getCell()->isExterior())
+                mExteriorPathgridGraph->addCell(cell);
+
+            // terrain, water and paged objects are shown right away, even when the cell's own objects are still pending
             mRendering.addCell(cell);
+
             bool waterEnabled = cell->getCell()->hasWater() || cell->isExterior();
             float waterLevel = cell->getWaterLevel();
             mRendering.setWaterEnabled(waterEnabled);
@@ -321,6 +379,79 @@ namespace MWWorld
         mPreloader->notifyLoaded(cell);
     }
 
+    void Scene::deferInsertCell (CellStore &cell, bool rescale)
+    {
+        InsertVisitor insertVisitor (cell, rescale, *MWBase::Environment::get().getWindowManager()->getLoadingScreen(), *mPhysics, mRendering);
+        cell.forEach (insertVisitor);
+
+        // rescale right away, scripts may query the scale of objects that are not inserted yet
+        if (rescale)
+        {
+            for (std::vector<Ptr>::const_iterator it = insertVisitor.mToInsert.begin(); it != insertVisitor.mToInsert.end(); ++it)
+                rescaleObject(*it);
+        }
+
+        PendingCell pending;
+        pending.mCell = &cell;
+        pending.mObjects.swap(insertVisitor.mToInsert);
+        std::stable_partition(pending.mObjects.begin(), pending.mObjects.end(), IsNotActor());
+        pending.mNextObject = 0;
+        mPendingCells.push_back(pending);
+    }
+
+    void Scene::activatePendingCells()
+    {
+        if (mPendingCells.empty())
+            return;
+
+        const osg::Timer_t start = osg::Timer::instance()->tick();
+        const MWWorld::Ptr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
+        const osg::Vec3f playerPos = player.getRefData().getPosition().asVec3();
+
+        while (!mPendingCells.empty())
+        {
+            // the nearest cell first, its objects are the first ones the player could run into
+            std::vector<PendingCell>::iterator nearest = mPendingCells.end();
+            float nearestDist = 0.f;
+            for (std::vector<PendingCell>::iterator it = mPendingCells.begin(); it != mPendingCells.end(); ++it)
+            {
+                float centerX, centerY;
+                MWBase::Environment::get().getWorld()->indexToPosition(it->mCell->getCell()->getGridX(), it->mCell->getCell()->getGridY(), centerX, centerY, true);
+                float dist = std::max(std::abs(centerX - playerPos.x()), std::abs(centerY - playerPos.y()));
+                if (nearest == mPendingCells.end() || dist < nearestDist)
+                {
+                    nearest = it;
+                    nearestDist = dist;
+                }
+            }
+
+            bool playerCell = (nearest->mCell == player.getCell());
+
+            while (nearest->mNextObject < nearest->mObjects.size())
+            {
+                if (!playerCell && osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) > mActivationBudget)
+                    return;
+
+                insertObject(nearest->mObjects[nearest->mNextObject++], false, *mPhysics, mRendering);
+            }
+
+            CellStore* cell = nearest->mCell;
+            mPendingCells.erase(nearest);
+
+            // do adjustPosition after the cell's objects are inserted, same as insertCell
+            AdjustPositionVisitor adjustPosVisitor;
+            cell->forEach (adjustPosVisitor);
+
+            finishCellActivation(cell);
+        }
+    }
+
+    void Scene::finishCellActivation (CellStore *cell)
+    {
+        mRendering.finishCell(cell);
+        mPreloader->batchStatics(cell);
+    }
+
     void Scene::clear()
     {
         CellStoreCollection::iterator active = mActiveCells.begin();
@@ -330,6 +461,7 @@ namespace MWWorld
         mCurrentCell = NULL;
 
         mPreloader->clear();
+        mExteriorPathgridGraph->clear();
     }
 
     void Scene::playerMoved(const osg::Vec3f &pos)
@@ -348,11 +480,11 @@ namespace MWWorld
         {
             int newX, newY;
             MWBase::Environment::get().getWorld()->positionToIndex(pos.x(), pos.y(), newX, newY);
-            changeCellGrid(newX, newY);
+            changeCellGrid(newX, newY, true, true);
         }
     }
 
-    void Scene::changeCellGrid (int X, int Y, bool changeEvent)
+    void Scene::changeCellGrid (int X, int Y, bool changeEvent, bool incremental)
     {
         Loading::Listener* loadingListener = MWBase::Environment::get().getWindowManager()->getLoadingScreen();
         Loading::ScopedLoad load(loadingListener);
@@ -395,7 +527,8 @@ namespace MWWorld
                     ++iter;
                 }
 
-                if (iter==mActiveCells.end())
+                bool deferred = incremental && (x != X || y != Y);
+                if (iter==mActiveCells.end() && !deferred)
                     refsToLoad += MWBase::Environment::get().getWorld()->getExterior(x, y)->count();
             }
         }
@@ -424,7 +557,8 @@ namespace MWWorld
                 {
                     CellStore *cell = MWBase::Environment::get().getWorld()->getExterior(x, y);
 
-                    loadCell (cell, loadingListener, changeEvent);
+                    // the player enters the center cell right away, the others can be filled in over the next frames
+                    loadCell (cell, loadingListener, changeEvent, incremental && (x != X || y != Y));
                 }
             }
         }
@@ -484,24 +618,35 @@ namespace MWWorld
     , mPreloadExteriorGrid(Settings::Manager::getBool("preload exterior grid", "Cells"))
     , mPreloadDoors(Settings::Manager::getBool("preload doors", "Cells"))
     , mPreloadFastTravel(Settings::Manager::getBool("preload fast travel", "Cells"))
+    , mPreloadTeleportSpells(Settings::Manager::getBool("preload teleport spells", "Cells"))
     , mPredictionTime(Settings::Manager::getFloat("prediction time", "Cells"))
+    , mInterventionTargetsCell(NULL)
+    , mActivationBudget(Settings::Manager::getFloat("cell activation budget", "Cells"))
     {
         mPreloader.reset(new CellPreloader(rendering.getResourceSystem(), physics->getShapeManager(), rendering.getTerrain(), rendering.getLandManager()));
+        mExteriorPathgridGraph.reset(new MWMechanics::ExteriorPathgridGraph);
         mPreloader->setWorkQueue(mRendering.getWorkQueue());
 
         mPreloader->setUnrefQueue(rendering.getUnrefQueue());
         mPhysics->setUnrefQueue(rendering.getUnrefQueue());
 
         rendering.getResourceSystem()->setExpiryDelay(Settings::Manager::getFloat("cache expiry delay", "Cells"));
+        rendering.getResourceSystem()->setMemoryBudget(static_cast<size_t>(std::max(0, Settings::Manager::getInt("cache memory budget", "Cells"))) * 1024 * 1024);
 
         mPreloader->setExpiryDelay(Settings::Manager::getFloat("preload cell expiry delay", "Cells"));
         mPreloader->setMinCacheSize(Settings::Manager::getInt("preload cell cache min", "Cells"));
         mPreloader->setMaxCacheSize(Settings::Manager::getInt("preload cell cache max", "Cells"));
         mPreloader->setPreloadInstances(Settings::Manager::getBool("preload instances", "Cells"));
+        mPreloader->setBatchStatics(Settings::Manager::getBool("batch static objects", "Cells"));
     }
 
     Scene::~Scene()
     {
+        if (mFindMarkers)
+        {
+            mFindMarkers->cancel();
+            mFindMarkers->waitTillDone();
+        }
     }
 
     bool Scene::hasCellChanged() const
@@ -514,6 +659,11 @@ namespace MWWorld
         return mActiveCells;
     }
 
+    const MWMechanics::ExteriorPathgridGraph& Scene::getExteriorPathgridGraph() const
+    {
+        return *mExteriorPathgridGraph;
+    }
+
     void Scene::changeToInteriorCell (const std::string& cellName, const ESM::Position& position, bool adjustPlayerPos, bool changeEvent)
     {
         CellStore *cell = MWBase::Environment::get().getWorld()->getInterior(cellName);
@@ -701,12 +851,18 @@ namespace MWWorld
 
         if (mPreloadEnabled)
         {
+            mPreloadCandidates.clear();
+
             if (mPreloadDoors)
                 preloadTeleportDoorDestinations(playerPos, predictedPos, exteriorPositions);
             if (mPreloadExteriorGrid)
                 preloadExteriorGrid(playerPos, predictedPos);
             if (mPreloadFastTravel)
                 preloadFastTravelDestinations(playerPos, predictedPos, exteriorPositions);
+            if (mPreloadTeleportSpells)
+                preloadTeleportSpellDestinations(exteriorPositions);
+
+            preloadCandidates();
         }
 
         mPreloader->setTerrainPreloadPositions(exteriorPositions);
@@ -730,31 +886,28 @@ namespace MWWorld
             }
         }
 
+        const MWWorld::ConstPtr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
+        osg::Vec3f facing = osg::Quat(player.getRefData().getPosition().rot[2], osg::Vec3f(0,0,-1)) * osg::Vec3f(0,1,0);
+
         for (std::vector<MWWorld::ConstPtr>::iterator it = teleportDoors.begin(); it != teleportDoors.end(); ++it)
         {
             const MWWorld::ConstPtr& door = *it;
-            float sqrDistToPlayer = (playerPos - door.getRefData().getPosition().asVec3()).length2();
-            sqrDistToPlayer = std::min(sqrDistToPlayer, (predictedPos - door.getRefData().getPosition().asVec3()).length2());
+            osg::Vec3f doorPos = door.getRefData().getPosition().asVec3();
+            float sqrDistToPlayer = (playerPos - doorPos).length2();
+            sqrDistToPlayer = std::min(sqrDistToPlayer, (predictedPos - doorPos).length2());
 
             if (sqrDistToPlayer < mPreloadDistance*mPreloadDistance)
             {
-                try
-                {
-                    if (!door.getCellRef().getDestCell().empty())
-                        preloadCell(MWBase::Environment::get().getWorld()->getInterior(door.getCellRef().getDestCell()));
-                    else
-                    {
-                        osg::Vec3f pos = door.getCellRef().getDoorDest().asVec3();
-                        int x,y;
-                        MWBase::Environment::get().getWorld()->positionToIndex (pos.x(), pos.y(), x, y);
-                        preloadCell(MWBase::Environment::get().getWorld()->getExterior(x,y), true);
-                        exteriorPositions.push_back(pos);
-                    }
-                }
-                catch (std::exception& e)
-                {
-                    // ignore error for now, would spam the log too much
-                }
+                float score = std::sqrt(sqrDistToPlayer);
+
+                // the player is more likely to use a door they are heading towards
+                osg::Vec3f toDoor = doorPos - playerPos;
+                toDoor.z() = 0;
+                toDoor.normalize();
+                if (toDoor * facing > 0.7f)
+                    score *= 0.5f;
+
+                addPreloadCandidate(door.getCellRef().getDestCell(), door.getCellRef().getDoorDest().asVec3(), score, exteriorPositions);
             }
         }
     }
@@ -785,10 +938,13 @@ namespace MWWorld
 
                 float dist = std::max(std::abs(thisCellCenterX - playerPos.x()), std::abs(thisCellCenterY - playerPos.y()));
                 dist = std::min(dist,std::max(std::abs(thisCellCenterX - predictedPos.x()), std::abs(thisCellCenterY - predictedPos.y())));
-                float loadDist = 8192/2 + 8192 - mCellLoadingThreshold + mPreloadDistance;
+                float cellLoadDist = 8192/2 + 8192 - mCellLoadingThreshold;
+                float loadDist = cellLoadDist + mPreloadDistance;
 
+                // the score is the distance the player has yet to move before the cell is loaded,
+                // so the cells along the movement direction come first
                 if (dist < loadDist)
-                    preloadCell(MWBase::Environment::get().getWorld()->getExterior(cellX+dx, cellY+dy));
+                    addPreloadCandidate(MWBase::Environment::get().getWorld()->getExterior(cellX+dx, cellY+dy), dist - cellLoadDist);
             }
         }
     }
@@ -823,38 +979,47 @@ namespace MWWorld
 
     struct ListFastTravelDestinationsVisitor
     {
-        ListFastTravelDestinationsVisitor(float preloadDist, const osg::Vec3f& playerPos)
+        ListFastTravelDestinationsVisitor(float preloadDist, const osg::Vec3f& playerPos, const MWWorld::Ptr& dialogueActor)
             : mPreloadDist(preloadDist)
             , mPlayerPos(playerPos)
+            , mDialogueActor(dialogueActor)
         {
         }
 
         bool operator()(const MWWorld::Ptr& ptr)
         {
-            if ((ptr.getRefData().getPosition().asVec3() - mPlayerPos).length2() > mPreloadDist * mPreloadDist)
+            float dist = (ptr.getRefData().getPosition().asVec3() - mPlayerPos).length();
+            if (dist > mPreloadDist)
                 return true;
 
+            // opening the dialogue takes extra time, unless the player is already talking to the actor
+            float score = (ptr == mDialogueActor) ? 0.f : dist + mPreloadDist;
+
+            const std::vector<ESM::Transport::Dest>* transport;
             if (ptr.getClass().isNpc())
-            {
-                const std::vector<ESM::Transport::Dest>& transport = ptr.get<ESM::NPC>()->mBase->mTransport.mList;
-                mList.insert(mList.begin(), transport.begin(), transport.end());
-            }
+                transport = &ptr.get<ESM::NPC>()->mBase->mTransport.mList;
             else
-            {
-                const std::vector<ESM::Transport::Dest>& transport = ptr.get<ESM::Creature>()->mBase->mTransport.mList;
-                mList.insert(mList.begin(), transport.begin(), transport.end());
-            }
+                transport = &ptr.get<ESM::Creature>()->mBase->mTransport.mList;
+
+            for (std::vector<ESM::Transport::Dest>::const_iterator it = transport->begin(); it != transport->end(); ++it)
+                mList.push_back(std::make_pair(*it, score));
             return true;
         }
         float mPreloadDist;
         osg::Vec3f mPlayerPos;
-        std::vector<ESM::Transport::Dest> mList;
+        MWWorld::Ptr mDialogueActor;
+        std::vector<std::pair<ESM::Transport::Dest, float> > mList;
     };
 
     void Scene::preloadFastTravelDestinations(const osg::Vec3f& playerPos, const osg::Vec3f& /*predictedPos*/, std::vector<osg::Vec3f>& exteriorPositions) // ignore predictedPos here since opening dialogue with travel service takes extra time
     {
         const MWWorld::ConstPtr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
-        ListFastTravelDestinationsVisitor listVisitor(mPreloadDistance, player.getRefData().getPosition().asVec3());
+
+        MWWorld::Ptr dialogueActor;
+        if (MWBase::Environment::get().getWindowManager()->containsMode(MWGui::GM_Dialogue))
+            dialogueActor = MWBase::Environment::get().getDialogueManager()->getActor();
+
+        ListFastTravelDestinationsVisitor listVisitor(mPreloadDistance, player.getRefData().getPosition().asVec3(), dialogueActor);
 
         for (CellStoreCollection::const_iterator iter (mActiveCells.begin()); iter!=mActiveCells.end(); ++iter)
         {
@@ -863,18 +1028,272 @@ namespace MWWorld
             cellStore->forEachType<ESM::Creature>(listVisitor);
         }
 
-        for (std::vector<ESM::Transport::Dest>::const_iterator it = listVisitor.mList.begin(); it != listVisitor.mList.end(); ++it)
+        for (std::vector<std::pair<ESM::Transport::Dest, float> >::const_iterator it = listVisitor.mList.begin(); it != listVisitor.mList.end(); ++it)
+            addPreloadCandidate(it->first.mCellName, it->first.mPos.asVec3(), it->second, exteriorPositions);
+    }
+
+    /// Worker thread item: find the positions of the given markers in the exterior cells. The references are read
+    /// directly from the content files, like MWRender::ObjectPaging does, so that no cell needs to be loaded.
+    class FindMarkersItem : public SceneUtil::WorkItem
+    {
+    public:
+        /// Constructor to be called from the main thread.
+        FindMarkersItem(const std::vector<std::string>& ids)
+            : mIds(ids)
+            , mAbort(false)
+        {
+            const MWWorld::Store<ESM::Cell>& cells = MWBase::Environment::get().getWorld()->getStore().get<ESM::Cell>();
+            for (MWWorld::Store<ESM::Cell>::iterator it = cells.extBegin(); it != cells.extEnd(); ++it)
+                mCells.push_back(&*it);
+
+            // copies of the readers get their own file streams in the worker thread.
+            // the marker IDs are plain ASCII, which reads the same in every code page, so no encoder is needed.
+            mReaders = MWBase::Environment::get().getWorld()->getEsmReader();
+            for (std::vector<ESM::ESMReader>::iterator it = mReaders.begin(); it != mReaders.end(); ++it)
+                it->setEncoder(NULL);
+        }
+
+        virtual void abort()
+        {
+            mAbort = true;
+        }
+
+        virtual void doWork()
+        {
+            for (std::vector<ESM::ESMReader>::iterator it = mReaders.begin(); it != mReaders.end(); ++it)
+            {
+                std::string filename = it->getName();
+                try
+                {
+                    if (!filename.empty())
+                        it->openRaw(filename);
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Error: failed to open " << filename << ": " << e.what() << std::endl;
+                    return;
+                }
+            }
+
+            for (std::vector<const ESM::Cell*>::const_iterator it = mCells.begin(); it != mCells.end(); ++it)
+            {
+                if (mAbort)
+                    return;
+
+                const ESM::Cell* cell = *it;
+                std::map<ESM::RefNum, ESM::CellRef> refs;
+                try
+                {
+                    // same as CellStore::loadRefs, but only keeps the markers
+                    for (size_t i = 0; i < cell->mContextList.size(); ++i)
+                    {
+                        ESM::ESMReader& reader = mReaders[cell->mContextList[i].index];
+                        cell->restore(reader, i);
+
+                        ESM::CellRef ref;
+                        ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
+
+                        bool deleted = false;
+                        while (cell->getNextRef(reader, ref, deleted))
+                        {
+                            // a later content file may delete a marker or replace it with another object
+                            if (!deleted && isMarker(ref.mRefID))
+                                refs[ref.mRefNum] = ref;
+                            else
+                                refs.erase(ref.mRefNum);
+                        }
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << "Error: failed to read references of " << cell->getDescription() << ": " << e.what() << std::endl;
+                }
+
+                for (std::map<ESM::RefNum, ESM::CellRef>::const_iterator refIt = refs.begin(); refIt != refs.end(); ++refIt)
+                    mMarkers.insert(std::make_pair(Misc::StringUtils::lowerCase(refIt->second.mRefID), refIt->second.mPos.asVec3()));
+            }
+        }
+
+        /// Find the marker with the given ID closest to \a pos, like World::getClosestMarkerFromExteriorPosition.
+        /// @note Only call once the item is done.
+        bool findClosest(const std::string& id, const osg::Vec3f& pos, osg::Vec3f& markerPos) const
+        {
+            float closestDistance = std::numeric_limits<float>::max();
+            std::pair<MarkerMap::const_iterator, MarkerMap::const_iterator> range = mMarkers.equal_range(id);
+            for (MarkerMap::const_iterator it = range.first; it != range.second; ++it)
+            {
+                float distance = (it->second - pos).length2();
+                if (distance < closestDistance)
+                {
+                    closestDistance = distance;
+                    markerPos = it->second;
+                }
+            }
+            return range.first != range.second;
+        }
+
+    private:
+        bool isMarker(const std::string& refId) const
+        {
+            for (std::vector<std::string>::const_iterator it = mIds.begin(); it != mIds.end(); ++it)
+            {
+                if (Misc::StringUtils::ciEqual(*it, refId))
+                    return true;
+            }
+            return false;
+        }
+
+        std::vector<std::string> mIds;
+        std::vector<const ESM::Cell*> mCells;
+        std::vector<ESM::ESMReader> mReaders;
+
+        /// Lower case marker ID and position
+        typedef std::multimap<std::string, osg::Vec3f> MarkerMap;
+        MarkerMap mMarkers;
+
+        volatile bool mAbort;
+    };
+
+    void Scene::preloadTeleportSpellDestinations(std::vector<osg::Vec3f>& exteriorPositions)
+    {
+        MWWorld::Ptr player = MWBase::Environment::get().getWorld()->getPlayerPtr();
+
+        bool recall = false;
+        bool divineIntervention = false;
+        bool almsiviIntervention = false;
+        const MWMechanics::Spells& spells = player.getClass().getCreatureStats(player).getSpells();
+        for (MWMechanics::Spells::TIterator it = spells.begin(); it != spells.end(); ++it)
+        {
+            const ESM::Spell* spell = it->first;
+            if (spell->mData.mType != ESM::Spell::ST_Spell && spell->mData.mType != ESM::Spell::ST_Power)
+                continue;
+
+            for (std::vector<ESM::ENAMstruct>::const_iterator effectIt = spell->mEffects.mList.begin(); effectIt != spell->mEffects.mList.end(); ++effectIt)
+            {
+                if (effectIt->mEffectID == ESM::MagicEffect::Recall)
+                    recall = true;
+                else if (effectIt->mEffectID == ESM::MagicEffect::DivineIntervention)
+                    divineIntervention = true;
+                else if (effectIt->mEffectID == ESM::MagicEffect::AlmsiviIntervention)
+                    almsiviIntervention = true;
+            }
+        }
+
+        if (recall)
+        {
+            CellStore* markedCell = NULL;
+            ESM::Position markedPosition;
+            MWBase::Environment::get().getWorld()->getPlayer().getMarkedPosition(markedCell, markedPosition);
+            if (markedCell)
+            {
+                // the player can cast it at any time, but is less likely to than to use a door right in front of them
+                addPreloadCandidate(markedCell, mPreloadDistance, true);
+                if (markedCell->isExterior())
+                    exteriorPositions.push_back(markedPosition.asVec3());
+            }
+        }
+
+        std::vector<std::string> markers;
+        if (divineIntervention)
+            markers.push_back("divinemarker");
+        if (almsiviIntervention)
+            markers.push_back("templemarker");
+        if (markers.empty())
+            return;
+
+        if (!mFindMarkers)
         {
-            if (!it->mCellName.empty())
-                preloadCell(MWBase::Environment::get().getWorld()->getInterior(it->mCellName));
+            std::vector<std::string> ids;
+            ids.push_back("divinemarker");
+            ids.push_back("templemarker");
+            mFindMarkers = new FindMarkersItem(ids);
+            mFindMarkers->setPriority(SceneUtil::WorkQueue::Priority_Low);
+            mRendering.getWorkQueue()->addWorkItem(mFindMarkers);
+        }
+        if (!mFindMarkers->isDone())
+            return;
+
+        if (mInterventionTargetsCell != mCurrentCell)
+        {
+            mInterventionTargetsCell = mCurrentCell;
+            mInterventionTargets.clear();
+
+            // unlike World::getClosestMarker, interiors don't search through their doors for the nearest exterior,
+            // but use the last exterior position of the player
+            osg::Vec3f pos = mCurrentCell->isExterior() ? player.getRefData().getPosition().asVec3()
+                                                        : MWBase::Environment::get().getWorld()->getPlayer().getLastKnownExteriorPosition();
+            for (std::vector<std::string>::const_iterator it = markers.begin(); it != markers.end(); ++it)
+            {
+                osg::Vec3f markerPos;
+                if (mFindMarkers->findClosest(*it, pos, markerPos))
+                    mInterventionTargets.push_back(markerPos);
+            }
+        }
+
+        // only the terrain is preloaded, as preloading the objects would need the cell to be loaded on the main thread
+        exteriorPositions.insert(exteriorPositions.end(), mInterventionTargets.begin(), mInterventionTargets.end());
+    }
+
+    void Scene::addPreloadCandidate(CellStore *cell, float score, bool preloadSurrounding)
+    {
+        mPreloadCandidates.push_back(PreloadCandidate(cell, score, preloadSurrounding));
+    }
+
+    void Scene::addPreloadCandidate(const std::string &cellName, const osg::Vec3f &pos, float score, std::vector<osg::Vec3f>& exteriorPositions)
+    {
+        try
+        {
+            if (!cellName.empty())
+                addPreloadCandidate(MWBase::Environment::get().getWorld()->getInterior(cellName), score);
             else
             {
-                osg::Vec3f pos = it->mPos.asVec3();
                 int x,y;
-                MWBase::Environment::get().getWorld()->positionToIndex( pos.x(), pos.y(), x, y);
-                preloadCell(MWBase::Environment::get().getWorld()->getExterior(x,y), true);
+                MWBase::Environment::get().getWorld()->positionToIndex(pos.x(), pos.y(), x, y);
+                addPreloadCandidate(MWBase::Environment::get().getWorld()->getExterior(x,y), score, true);
                 exteriorPositions.push_back(pos);
             }
         }
+        catch (std::exception& e)
+        {
+            // ignore error for now, would spam the log too much
+        }
+    }
+
+    void Scene::preloadCandidates()
+    {
+        std::stable_sort(mPreloadCandidates.begin(), mPreloadCandidates.end());
+
+        // the preloader's cache holds a limited number of cells, so the most likely destinations have to come first
+        // to be sure to get a place in it
+        std::set<CellStore*> preloaded;
+        const unsigned int budget = mPreloader->getMaxCacheSize();
+        for (std::vector<PreloadCandidate>::const_iterator it = mPreloadCandidates.begin(); it != mPreloadCandidates.end(); ++it)
+        {
+            std::vector<CellStore*> cells;
+            cells.push_back(it->mCell);
+            if (it->mPreloadSurrounding && it->mCell->isExterior())
+            {
+                int x = it->mCell->getCell()->getGridX();
+                int y = it->mCell->getCell()->getGridY();
+                for (int dx = -mHalfGridSize; dx <= mHalfGridSize; ++dx)
+                {
+                    for (int dy = -mHalfGridSize; dy <= mHalfGridSize; ++dy)
+                    {
+                        if (dx != 0 || dy != 0)
+                            cells.push_back(MWBase::Environment::get().getWorld()->getExterior(x+dx, y+dy));
+                    }
+                }
+            }
+
+            for (std::vector<CellStore*>::const_iterator cellIt = cells.begin(); cellIt != cells.end(); ++cellIt)
+            {
+                if (!preloaded.insert(*cellIt).second)
+                    continue;
+
+                mPreloader->preload(*cellIt, mRendering.getReferenceTime());
+                if (preloaded.size() >= budget)
+                    return;
+            }
+        }
     }
 }
@@ -1,11 +1,16 @@
 #ifndef GAME_MWWORLD_SCENE_H
 #define GAME_MWWORLD_SCENE_H
 
+#include <osg/ref_ptr>
+
+#include <components/esm/transport.hpp>
+
 #include "ptr.hpp"
 #include "globals.hpp"
 
 #include <set>
 #include <memory>
+#include <vector>
 
 namespace osg
 {
@@ -38,11 +43,17 @@ namespace MWPhysics
     class PhysicsSystem;
 }
 
+namespace MWMechanics
+{
+    class ExteriorPathgridGraph;
+}
+
 namespace MWWorld
 {
     class Player;
     class CellStore;
     class CellPreloader;
+    class FindMarkersItem;
 
     class Scene
     {
@@ -58,6 +69,7 @@ namespace MWWorld
             MWPhysics::PhysicsSystem *mPhysics;
             MWRender::RenderingManager& mRendering;
             std::unique_ptr<CellPreloader> mPreloader;
+            std::unique_ptr<MWMechanics::ExteriorPathgridGraph> mExteriorPathgridGraph;
             float mPreloadTimer;
             int mHalfGridSize;
             float mCellLoadingThreshold;
@@ -67,14 +79,59 @@ namespace MWWorld
             bool mPreloadExteriorGrid;
             bool mPreloadDoors;
             bool mPreloadFastTravel;
+            bool mPreloadTeleportSpells;
             float mPredictionTime;
 
             osg::Vec3f mLastPlayerPos;
 
+            /// A cell the player may enter soon.
+            struct PreloadCandidate
+            {
+                PreloadCandidate(CellStore* cell, float score, bool preloadSurrounding)
+                    : mCell(cell), mScore(score), mPreloadSurrounding(preloadSurrounding) {}
+
+                bool operator< (const PreloadCandidate& other) const { return mScore < other.mScore; }
+
+                CellStore* mCell;
+                /// Roughly the distance the player has to travel to enter the cell. Lower scores are preloaded first.
+                float mScore;
+                bool mPreloadSurrounding;
+            };
+            std::vector<PreloadCandidate> mPreloadCandidates;
+
+            /// Positions of the intervention markers in the exterior cells, found once in a background thread.
+            osg::ref_ptr<FindMarkersItem> mFindMarkers;
+            /// Destinations of the intervention spells the player knows, as seen from mInterventionTargetsCell.
+            std::vector<osg::Vec3f> mInterventionTargets;
+            CellStore* mInterventionTargetsCell;
+
             void insertCell (CellStore &cell, bool rescale, Loading::Listener* loadingListener);
 
+            /// A cell whose objects are inserted over several frames, see activatePendingCells().
+            struct PendingCell
+            {
+                CellStore* mCell;
+                /// Objects that are not inserted yet. Actors come last, so that they find the ground when their position is adjusted.
+                std::vector<Ptr> mObjects;
+                size_t mNextObject;
+            };
+            std::vector<PendingCell> mPendingCells;
+            /// Time in milliseconds per frame to spend on inserting the objects of pending cells.
+            float mActivationBudget;
+
+            /// Queue the objects of a cell for insertion by activatePendingCells().
+            void deferInsertCell (CellStore& cell, bool rescale);
+
+            /// Insert the objects of pending cells until the time budget for this frame is used up, nearest cells first.
+            /// The cell that the player is in is always activated completely.
+            void activatePendingCells();
+
+            /// Build the object hierarchy and static batch of a cell once its objects are inserted.
+            void finishCellActivation (CellStore* cell);
+
             // Load and unload cells as necessary to create a cell grid with "X" and "Y" in the center
-            void changeCellGrid (int X, int Y, bool changeEvent = true);
+            /// @param incremental Insert the objects of new cells other than the center cell over several frames?
+            void changeCellGrid (int X, int Y, bool changeEvent = true, bool incremental = false);
 
             void getGridCenter(int& cellX, int& cellY);
 
@@ -82,6 +139,15 @@ namespace MWWorld
             void preloadTeleportDoorDestinations(const osg::Vec3f& playerPos, const osg::Vec3f& predictedPos, std::vector<osg::Vec3f>& exteriorPositions);
             void preloadExteriorGrid(const osg::Vec3f& playerPos, const osg::Vec3f& predictedPos);
             void preloadFastTravelDestinations(const osg::Vec3f& playerPos, const osg::Vec3f& predictedPos, std::vector<osg::Vec3f>& exteriorPositions);
+            void preloadTeleportSpellDestinations(std::vector<osg::Vec3f>& exteriorPositions);
+
+            /// Queue a cell for preloading in preloadCandidates().
+            void addPreloadCandidate(CellStore* cell, float score, bool preloadSurrounding=false);
+            /// Queue the cell at the given destination for preloading in preloadCandidates().
+            void addPreloadCandidate(const std::string& cellName, const osg::Vec3f& pos, float score, std::vector<osg::Vec3f>& exteriorPositions);
+
+            /// Preload the queued candidates, most likely first, as long as they fit into the preloader's cache.
+            void preloadCandidates();
 
         public:
 
@@ -94,7 +160,8 @@ namespace MWWorld
 
             void unloadCell (CellStoreCollection::iterator iter);
 
-            void loadCell (CellStore *cell, Loading::Listener* loadingListener, bool respawn);
+            /// @param incremental Insert the objects of the cell over several frames? See activatePendingCells().
+            void loadCell (CellStore *cell, Loading::Listener* loadingListener, bool respawn, bool incremental = false);
 
             void playerMoved (const osg::Vec3f& pos);
 
@@ -104,6 +171,9 @@ namespace MWWorld
 
             const CellStoreCollection& getActiveCells () const;
 
+            const MWMechanics::ExteriorPathgridGraph& getExteriorPathgridGraph() const;
+            ///< Pathgrid graph spanning all active exterior cells, updated when the cell grid changes
+
             bool hasCellChanged() const;
             ///< Has the set of active cells changed, since the last frame?
 
@@ -156,7 +156,7 @@ namespace MWWorld
       mLevitationEnabled(true), mGoToJail(false), mDaysInPrison(0), mSpellPreloadTimer(0.f)
     {
         mPhysics = new MWPhysics::PhysicsSystem(resourceSystem, rootNode);
-        mRendering = new MWRender::RenderingManager(viewer, rootNode, resourceSystem, workQueue, &mFallback, resourcePath);
+        mRendering = new MWRender::RenderingManager(viewer, rootNode, resourceSystem, workQueue, &mFallback, resourcePath, encoder);
         mProjectileManager.reset(new ProjectileManager(mRendering->getLightRoot(), resourceSystem, mRendering, mPhysics));
 
         mRendering->preloadCommonAssets();
@@ -1834,6 +1834,11 @@ namespace MWWorld
         mWeatherManager->modRegion(regionid, chances);
     }
 
+    const MWMechanics::ExteriorPathgridGraph& World::getExteriorPathgridGraph() const
+    {
+        return mWorldScene->getExteriorPathgridGraph();
+    }
+
     osg::Vec2f World::getNorthVector (const CellStore* cell)
     {
         MWWorld::ConstPtr northmarker = cell->searchConst("northmarker");
@@ -175,7 +175,6 @@ namespace MWWorld
             float feetToGameUnits(float feet);
             float getActivationDistancePlusTelekinesis();
 
-            MWWorld::ConstPtr getClosestMarker( const MWWorld::Ptr &ptr, const std::string &id );
             MWWorld::ConstPtr getClosestMarkerFromExteriorPosition( const osg::Vec3f& worldPos, const std::string &id );
 
         public:
@@ -238,6 +237,9 @@ namespace MWWorld
 
             virtual bool isCellQuasiExterior() const;
 
+            virtual const MWMechanics::ExteriorPathgridGraph& getExteriorPathgridGraph() const;
+            ///< Pathgrid graph spanning all active exterior cells
+
             virtual osg::Vec2f getNorthVector (const CellStore* cell);
             ///< get north vector for given interior cell
 
@@ -620,6 +622,8 @@ namespace MWWorld
             virtual void teleportToClosestMarker (const MWWorld::Ptr& ptr,
                                                   const std::string& id);
 
+            virtual MWWorld::ConstPtr getClosestMarker (const MWWorld::Ptr& ptr, const std::string& id);
+
             /// List all references (filtered by \a type) detected by \a ptr. The range
             /// is determined by the current magnitude of the "Detect X" magic effect belonging to \a type.
             /// @note This also works for references in containers.
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "components/nifosg/controller.hpp"
+
+namespace
+{
+    std::shared_ptr<Nif::FloatKeyMap> makeKeys()
+    {
+        std::shared_ptr<Nif::FloatKeyMap> keys (new Nif::FloatKeyMap);
+        for (int i=0; i<5; ++i)
+        {
+            Nif::FloatKey key;
+            key.mValue = i * 10.f;
+            keys->mKeys.push_back(std::make_pair(static_cast<float>(i), key));
+        }
+        return keys;
+    }
+}
+
+TEST(NifOsgValueInterpolatorTest, empty_keys_should_give_default_value)
+{
+    NifOsg::FloatInterpolator interpolator (std::shared_ptr<Nif::FloatKeyMap>(new Nif::FloatKeyMap), 3.f);
+    EXPECT_TRUE(interpolator.empty());
+    EXPECT_EQ(3.f, interpolator.interpKey(1.f));
+}
+
+TEST(NifOsgValueInterpolatorTest, times_outside_of_keys_should_give_first_or_last_value)
+{
+    NifOsg::FloatInterpolator interpolator (makeKeys());
+    EXPECT_EQ(0.f, interpolator.interpKey(-1.f));
+    EXPECT_EQ(40.f, interpolator.interpKey(5.f));
+    EXPECT_EQ(0.f, interpolator.interpKey(0.f));
+    EXPECT_EQ(40.f, interpolator.interpKey(4.f));
+}
+
+TEST(NifOsgValueInterpolatorTest, should_interpolate_when_time_moves_forward)
+{
+    NifOsg::FloatInterpolator interpolator (makeKeys());
+    for (int i=0; i<=40; ++i)
+        EXPECT_FLOAT_EQ(i * 1.f, interpolator.interpKey(i * 0.1f));
+}
+
+TEST(NifOsgValueInterpolatorTest, should_interpolate_when_time_jumps)
+{
+    NifOsg::FloatInterpolator interpolator (makeKeys());
+    EXPECT_FLOAT_EQ(35.f, interpolator.interpKey(3.5f));
+    EXPECT_FLOAT_EQ(5.f, interpolator.interpKey(0.5f));
+    EXPECT_FLOAT_EQ(25.f, interpolator.interpKey(2.5f));
+    EXPECT_FLOAT_EQ(20.f, interpolator.interpKey(2.f));
+    EXPECT_FLOAT_EQ(15.f, interpolator.interpKey(1.5f));
+    EXPECT_FLOAT_EQ(40.f, interpolator.interpKey(10.f));
+    EXPECT_FLOAT_EQ(1.f, interpolator.interpKey(0.1f));
+}
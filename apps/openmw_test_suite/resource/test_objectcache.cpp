@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "components/resource/objectcache.hpp"
+#include "components/sceneutil/workqueue.hpp"
+
+#include <osg/Group>
+
+#include <algorithm>
+
+namespace
+{
+    /// Requests an entry from a worker thread, so that the test can check whether it waits for a reservation.
+    class RequestItem : public SceneUtil::WorkItem
+    {
+    public:
+        RequestItem(Resource::ObjectCache* cache, const std::string& name)
+            : mCache(cache), mName(name), mReserved(false) {}
+
+        virtual void doWork()
+        {
+            mResult = mCache->getRefFromObjectCacheOrReserve(mName, mReserved);
+        }
+
+        osg::ref_ptr<Resource::ObjectCache> mCache;
+        std::string mName;
+        osg::ref_ptr<osg::Object> mResult;
+        bool mReserved;
+    };
+
+    /// Wait until a thread is blocked on a reservation of the cache, or give up after a few seconds.
+    bool waitForWaitingThread(const Resource::ObjectCache* cache)
+    {
+        for (int i=0; i<5000; ++i)
+        {
+            if (cache->getNumWaitingThreads() > 0)
+                return true;
+            OpenThreads::Thread::microSleep(1000);
+        }
+        return false;
+    }
+}
+
+struct ObjectCacheTest : public ::testing::Test
+{
+  protected:
+    osg::ref_ptr<Resource::ObjectCache> mCache;
+    osg::ref_ptr<SceneUtil::WorkQueue> mQueue;
+
+    virtual void SetUp()
+    {
+        mCache = new Resource::ObjectCache;
+        mQueue = new SceneUtil::WorkQueue(1);
+    }
+
+    virtual void TearDown()
+    {
+        mQueue = NULL;
+        mCache = NULL;
+    }
+};
+
+TEST_F(ObjectCacheTest, reserve_missing_entry)
+{
+    bool reserved = false;
+    EXPECT_FALSE(mCache->getRefFromObjectCacheOrReserve("a", reserved).valid());
+    EXPECT_TRUE(reserved);
+
+    osg::ref_ptr<osg::Object> object (new osg::Group);
+    mCache->addEntryToObjectCache("a", object);
+
+    EXPECT_EQ(object, mCache->getRefFromObjectCacheOrReserve("a", reserved));
+    EXPECT_FALSE(reserved);
+}
+
+TEST_F(ObjectCacheTest, waits_for_reserved_entry)
+{
+    bool reserved = false;
+    mCache->getRefFromObjectCacheOrReserve("a", reserved);
+    ASSERT_TRUE(reserved);
+
+    osg::ref_ptr<RequestItem> request (new RequestItem(mCache, "a"));
+    mQueue->addWorkItem(request);
+    ASSERT_TRUE(waitForWaitingThread(mCache));
+    EXPECT_FALSE(request->isDone());
+
+    osg::ref_ptr<osg::Object> object (new osg::Group);
+    mCache->addEntryToObjectCache("a", object);
+
+    request->waitTillDone();
+    EXPECT_FALSE(request->mReserved);
+    EXPECT_EQ(object, request->mResult);
+}
+
+TEST_F(ObjectCacheTest, cancel_passes_reservation_to_waiting_thread)
+{
+    bool reserved = false;
+    mCache->getRefFromObjectCacheOrReserve("a", reserved);
+    ASSERT_TRUE(reserved);
+
+    osg::ref_ptr<RequestItem> request (new RequestItem(mCache, "a"));
+    mQueue->addWorkItem(request);
+    ASSERT_TRUE(waitForWaitingThread(mCache));
+    mCache->cancelReservation("a");
+
+    request->waitTillDone();
+    EXPECT_TRUE(request->mReserved);
+    EXPECT_FALSE(request->mResult.valid());
+}
+
+TEST_F(ObjectCacheTest, expiry_keeps_reservations)
+{
+    bool reserved = false;
+    mCache->getRefFromObjectCacheOrReserve("a", reserved);
+    mCache->removeExpiredObjectsInCache(1.0);
+    mCache->clear();
+
+    osg::ref_ptr<RequestItem> request (new RequestItem(mCache, "a"));
+    mQueue->addWorkItem(request);
+    ASSERT_TRUE(waitForWaitingThread(mCache));
+    EXPECT_FALSE(request->isDone());
+
+    mCache->cancelReservation("a");
+    request->waitTillDone();
+}
+
+TEST_F(ObjectCacheTest, memory_usage_and_eviction)
+{
+    osg::ref_ptr<osg::Object> used (new osg::Group);
+    mCache->addEntryToObjectCache("used", used, 2.0, 100);
+    mCache->addEntryToObjectCache("old", new osg::Group, 1.0, 200);
+    mCache->addEntryToObjectCache("new", new osg::Group, 3.0, 300);
+    EXPECT_EQ(600u, mCache->getMemoryUsage());
+
+    // replacing an entry replaces its size
+    mCache->addEntryToObjectCache("new", new osg::Group, 3.0, 400);
+    EXPECT_EQ(700u, mCache->getMemoryUsage());
+
+    std::vector<Resource::ObjectCache::EvictionCandidate> candidates;
+    mCache->getEvictionCandidates(candidates);
+    ASSERT_EQ(2u, candidates.size());
+    std::sort(candidates.begin(), candidates.end());
+    EXPECT_EQ("old", candidates[0]._fileName);
+    EXPECT_EQ("new", candidates[1]._fileName);
+
+    EXPECT_EQ(200u, mCache->evict("old"));
+    EXPECT_EQ(0u, mCache->evict("used"));
+    EXPECT_EQ(500u, mCache->getMemoryUsage());
+    EXPECT_EQ(2u, mCache->getCacheSize());
+}
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include "components/resource/templatecache.hpp"
+#include "components/nif/niffile.hpp"
+#include "components/nifosg/nifloader.hpp"
+#include "components/nifosg/userdata.hpp"
+
+#include <osg/Drawable>
+#include <osg/Node>
+#include <osg/UserDataContainer>
+
+#include <boost/filesystem.hpp>
+
+#include <sstream>
+
+namespace
+{
+    /// Writes the records of a NIF file in the Morrowind format.
+    class NifWriter
+    {
+    public:
+        void writeInt(int value) { mStream.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+        void writeUShort(unsigned short value) { mStream.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+        void writeFloat(float value) { mStream.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+        void writeVector3(const osg::Vec3f& value)
+        {
+            for (int i=0; i<3; ++i)
+                writeFloat(value[i]);
+        }
+
+        void writeString(const std::string& value)
+        {
+            writeInt(value.size());
+            mStream.write(value.data(), value.size());
+        }
+
+        /// The fields that all node records start with.
+        void writeNode(const std::string& name, const osg::Vec3f& position, float scale)
+        {
+            writeString(name);
+            writeInt(-1); // extra data
+            writeInt(-1); // controller
+            writeUShort(0); // flags
+            writeVector3(position);
+            for (int i=0; i<3; ++i)
+                for (int j=0; j<3; ++j)
+                    writeFloat(i == j ? 1.f : 0.f);
+            writeFloat(scale);
+            writeVector3(osg::Vec3f()); // velocity
+            writeInt(0); // properties
+            writeInt(0); // no bounding volume
+        }
+
+        std::ostringstream mStream;
+    };
+
+    /// A NIF file with a static triangle below its root node.
+    std::string makeTriangleNif()
+    {
+        NifWriter writer;
+        writer.mStream << "NetImmerse File Format, Version 4.0.0.2\n";
+        writer.writeInt(Nif::NIFFile::VER_MW);
+        writer.writeInt(3); // records
+
+        writer.writeString("NiNode");
+        writer.writeNode("root", osg::Vec3f(), 1.f);
+        writer.writeInt(1); // children
+        writer.writeInt(1);
+        writer.writeInt(0); // effects
+
+        writer.writeString("NiTriShape");
+        writer.writeNode("triangle", osg::Vec3f(10.f, 0.f, 0.f), 2.f);
+        writer.writeInt(2); // data
+        writer.writeInt(-1); // skin
+
+        writer.writeString("NiTriShapeData");
+        writer.writeUShort(3); // vertices
+        writer.writeInt(1);
+        writer.writeVector3(osg::Vec3f(0.f, 0.f, 0.f));
+        writer.writeVector3(osg::Vec3f(1.f, 0.f, 0.f));
+        writer.writeVector3(osg::Vec3f(0.f, 1.f, 0.f));
+        writer.writeInt(0); // normals
+        writer.writeVector3(osg::Vec3f(0.5f, 0.5f, 0.f)); // center
+        writer.writeFloat(1.f); // radius
+        writer.writeInt(0); // vertex colors
+        writer.writeUShort(0); // UV sets
+        writer.writeInt(0);
+        writer.writeUShort(1); // triangles
+        writer.writeInt(3);
+        writer.writeUShort(0);
+        writer.writeUShort(1);
+        writer.writeUShort(2);
+        writer.writeUShort(0); // match groups
+
+        writer.writeInt(1); // roots
+        writer.writeInt(0);
+        return writer.mStream.str();
+    }
+
+    /// Collects the user data that the NIF loader attached to the nodes, and counts the drawables.
+    class CollectUserDataVisitor : public osg::NodeVisitor
+    {
+    public:
+        CollectUserDataVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mNumDrawables(0)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (const osg::UserDataContainer* container = node.getUserDataContainer())
+            {
+                for (unsigned int i=0; i<container->getNumUserObjects(); ++i)
+                {
+                    if (const NifOsg::NodeUserData* userData = dynamic_cast<const NifOsg::NodeUserData*>(container->getUserObject(i)))
+                        mUserData.push_back(userData);
+                }
+            }
+            traverse(node);
+        }
+
+        virtual void apply(osg::Drawable&)
+        {
+            ++mNumDrawables;
+        }
+
+        std::vector<osg::ref_ptr<const NifOsg::NodeUserData> > mUserData;
+        unsigned int mNumDrawables;
+    };
+}
+
+struct TemplateCacheTest : public ::testing::Test
+{
+  protected:
+    std::string mPath;
+    std::string mNif;
+
+    virtual void SetUp()
+    {
+        mPath = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("openmw-templatecache-%%%%-%%%%-%%%%")).string();
+        mNif = makeTriangleNif();
+    }
+
+    virtual void TearDown()
+    {
+        boost::filesystem::remove_all(mPath);
+    }
+
+    osg::ref_ptr<osg::Node> loadNif()
+    {
+        Nif::NIFFilePtr file (new Nif::NIFFile(Files::IStreamPtr(new std::istringstream(mNif)), "meshes/triangle.nif"));
+        return NifOsg::Loader::load(file, NULL);
+    }
+};
+
+TEST_F(TemplateCacheTest, stores_nif_template)
+{
+    Resource::TemplateCache cache (mPath);
+    osg::ref_ptr<osg::Node> node = loadNif();
+
+    std::istringstream writeSource (mNif);
+    cache.write("meshes/triangle.nif", "settings", writeSource, node);
+
+    std::istringstream readSource (mNif);
+    osg::ref_ptr<osg::Node> stored = cache.read("meshes/triangle.nif", "settings", readSource, NULL);
+    ASSERT_TRUE(stored.valid());
+
+    CollectUserDataVisitor original;
+    node->accept(original);
+    CollectUserDataVisitor reloaded;
+    stored->accept(reloaded);
+
+    EXPECT_EQ(1u, original.mNumDrawables);
+    EXPECT_EQ(original.mNumDrawables, reloaded.mNumDrawables);
+
+    ASSERT_EQ(2u, original.mUserData.size());
+    ASSERT_EQ(original.mUserData.size(), reloaded.mUserData.size());
+    for (unsigned int i=0; i<original.mUserData.size(); ++i)
+    {
+        EXPECT_EQ(original.mUserData[i]->mIndex, reloaded.mUserData[i]->mIndex);
+        EXPECT_EQ(original.mUserData[i]->mScale, reloaded.mUserData[i]->mScale);
+        for (int j=0; j<3; ++j)
+            for (int k=0; k<3; ++k)
+                EXPECT_EQ(original.mUserData[i]->mRotationScale.mValues[j][k], reloaded.mUserData[i]->mRotationScale.mValues[j][k]);
+    }
+}
+
+TEST_F(TemplateCacheTest, ignores_outdated_template)
+{
+    Resource::TemplateCache cache (mPath);
+
+    std::istringstream writeSource (mNif);
+    cache.write("meshes/triangle.nif", "settings", writeSource, loadNif());
+
+    std::istringstream readSource (mNif);
+    ASSERT_TRUE(cache.read("meshes/triangle.nif", "settings", readSource, NULL).valid());
+
+    std::istringstream changedSource (mNif + "changed");
+    EXPECT_FALSE(cache.read("meshes/triangle.nif", "settings", changedSource, NULL).valid());
+
+    std::istringstream otherSettingsSource (mNif);
+    EXPECT_FALSE(cache.read("meshes/triangle.nif", "other settings", otherSettingsSource, NULL).valid());
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include "components/sceneutil/boundinghierarchy.hpp"
+
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+
+#include <osgUtil/CullVisitor>
+
+#include <iostream>
+
+namespace
+{
+    const unsigned int sMaxNodesPerLeaf = 8;
+
+    /// Count the transforms below a group, and check that the leaf groups of the hierarchy are not too large.
+    unsigned int countObjects(const osg::Group* group)
+    {
+        unsigned int count = 0;
+        unsigned int numTransforms = 0;
+        for (unsigned int i=0; i<group->getNumChildren(); ++i)
+        {
+            const osg::Node* child = group->getChild(i);
+            if (child->asTransform())
+                ++numTransforms;
+            else if (child->asGroup())
+                count += countObjects(child->asGroup());
+        }
+        EXPECT_LE(numTransforms, sMaxNodesPerLeaf);
+        return count + numTransforms;
+    }
+
+    unsigned int countLeaves(const osgUtil::StateGraph* stateGraph)
+    {
+        unsigned int count = stateGraph->_leaves.size();
+        for (osgUtil::StateGraph::ChildList::const_iterator it = stateGraph->_children.begin(); it != stateGraph->_children.end(); ++it)
+            count += countLeaves(it->second.get());
+        return count;
+    }
+}
+
+struct BoundingHierarchyTest : public ::testing::Test
+{
+    /// A grid of objects, similar to the statics of a few cells
+    BoundingHierarchyTest()
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices (new osg::Vec3Array);
+        vertices->push_back(osg::Vec3f(-32.f, -32.f, 0.f));
+        vertices->push_back(osg::Vec3f(32.f, 32.f, 64.f));
+        mGeometry = new osg::Geometry;
+        mGeometry->setVertexArray(vertices);
+
+        for (int x=0; x<64; ++x)
+        {
+            for (int y=0; y<64; ++y)
+            {
+                osg::ref_ptr<osg::MatrixTransform> object (new osg::MatrixTransform(osg::Matrix::translate(x * 128.f, y * 128.f, 0.f)));
+                object->addChild(mGeometry);
+                mObjects.push_back(object);
+            }
+        }
+    }
+
+    /// Cull \a root from a camera standing in a corner of the grid.
+    /// @return The average duration of a cull traversal in milliseconds.
+    double cull(osg::Node* root, unsigned int iterations, unsigned int& numLeaves)
+    {
+        osg::ref_ptr<osg::Viewport> viewport (new osg::Viewport(0, 0, 800, 600));
+        osg::ref_ptr<osg::RefMatrix> projection (new osg::RefMatrix(osg::Matrix::perspective(60.0, 800.0/600.0, 1.0, 4096.0)));
+        osg::ref_ptr<osg::RefMatrix> view (new osg::RefMatrix(osg::Matrix::lookAt(osg::Vec3(0.f, 0.f, 128.f), osg::Vec3(1.f, 1.f, 128.f), osg::Vec3(0.f, 0.f, 1.f))));
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        for (unsigned int i=0; i<iterations; ++i)
+        {
+            osg::ref_ptr<osgUtil::CullVisitor> cv (new osgUtil::CullVisitor);
+            osg::ref_ptr<osgUtil::StateGraph> stateGraph (new osgUtil::StateGraph);
+            osg::ref_ptr<osgUtil::RenderStage> renderStage (new osgUtil::RenderStage);
+            renderStage->setViewport(viewport);
+
+            cv->setStateGraph(stateGraph);
+            cv->setRenderStage(renderStage);
+            cv->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+            cv->setCullingMode(cv->getCullingMode() & ~osg::CullSettings::SMALL_FEATURE_CULLING);
+
+            cv->pushViewport(viewport);
+            cv->pushProjectionMatrix(projection);
+            cv->pushModelViewMatrix(view, osg::Transform::ABSOLUTE_RF);
+
+            root->accept(*cv);
+
+            cv->popModelViewMatrix();
+            cv->popProjectionMatrix();
+            cv->popViewport();
+
+            numLeaves = countLeaves(stateGraph);
+        }
+        return osg::Timer::instance()->delta_m(start, osg::Timer::instance()->tick()) / iterations;
+    }
+
+    osg::ref_ptr<osg::Geometry> mGeometry;
+    std::vector<osg::ref_ptr<osg::Node> > mObjects;
+};
+
+TEST_F(BoundingHierarchyTest, contains_every_node_once)
+{
+    osg::ref_ptr<osg::Group> root (new osg::Group);
+    SceneUtil::buildBoundingVolumeHierarchy(mObjects, root, sMaxNodesPerLeaf);
+
+    EXPECT_EQ(countObjects(root), mObjects.size());
+    for (std::vector<osg::ref_ptr<osg::Node> >::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+        EXPECT_EQ((*it)->getNumParents(), 1u);
+}
+
+TEST_F(BoundingHierarchyTest, cull_traversal_benchmark)
+{
+    osg::ref_ptr<osg::Group> flat (new osg::Group);
+    for (std::vector<osg::ref_ptr<osg::Node> >::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+        flat->addChild(*it);
+
+    osg::ref_ptr<osg::Group> hierarchy (new osg::Group);
+    SceneUtil::buildBoundingVolumeHierarchy(mObjects, hierarchy, sMaxNodesPerLeaf);
+
+    const unsigned int iterations = 20;
+    unsigned int flatLeaves = 0;
+    unsigned int hierarchyLeaves = 0;
+    double flatTime = cull(flat, iterations, flatLeaves);
+    double hierarchyTime = cull(hierarchy, iterations, hierarchyLeaves);
+
+    // the hierarchy only skips work, the objects that end up drawn are the same
+    EXPECT_GT(flatLeaves, 0u);
+    EXPECT_LT(flatLeaves, mObjects.size());
+    EXPECT_EQ(flatLeaves, hierarchyLeaves);
+
+    std::cout << "Cull traversal of " << mObjects.size() << " objects, average of " << iterations << " runs:" << std::endl
+              << "  flat: " << flatTime << " ms" << std::endl
+              << "  hierarchy: " << hierarchyTime << " ms" << std::endl;
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "components/sceneutil/workqueue.hpp"
+
+#include <vector>
+
+namespace
+{
+    /// Records the order in which items were started.
+    struct Log
+    {
+        OpenThreads::Mutex mMutex;
+        std::vector<int> mOrder;
+    };
+
+    class LogItem : public SceneUtil::WorkItem
+    {
+    public:
+        LogItem(Log& log, int id) : mLog(log), mId(id) {}
+
+        virtual void doWork()
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mLog.mMutex);
+            mLog.mOrder.push_back(mId);
+        }
+
+    private:
+        Log& mLog;
+        int mId;
+    };
+
+    /// Keeps the work thread busy until released, so that the following items are all queued before any is started.
+    class GateItem : public SceneUtil::WorkItem
+    {
+    public:
+        GateItem() : mOpen(false) {}
+
+        virtual void doWork()
+        {
+            while (!mOpen)
+                OpenThreads::Thread::YieldCurrentThread();
+        }
+
+        volatile bool mOpen;
+    };
+}
+
+struct WorkQueueTest : public ::testing::Test
+{
+  protected:
+    osg::ref_ptr<SceneUtil::WorkQueue> mQueue;
+    osg::ref_ptr<GateItem> mGate;
+    Log mLog;
+
+    virtual void SetUp()
+    {
+        mQueue = new SceneUtil::WorkQueue(1);
+        mGate = new GateItem;
+        mQueue->addWorkItem(mGate);
+    }
+
+    virtual void TearDown()
+    {
+        mGate->mOpen = true;
+        mQueue = NULL;
+    }
+
+    osg::ref_ptr<LogItem> add(int id, int priority, bool front=false)
+    {
+        osg::ref_ptr<LogItem> item (new LogItem(mLog, id));
+        item->setPriority(priority);
+        mQueue->addWorkItem(item, front);
+        return item;
+    }
+};
+
+TEST_F(WorkQueueTest, higher_priority_items_are_started_first)
+{
+    add(1, SceneUtil::WorkQueue::Priority_Low);
+    add(2, SceneUtil::WorkQueue::Priority_Normal);
+    add(3, SceneUtil::WorkQueue::Priority_High);
+    osg::ref_ptr<LogItem> last = add(4, SceneUtil::WorkQueue::Priority_Normal, true);
+
+    mGate->mOpen = true;
+    add(5, SceneUtil::WorkQueue::Priority_Low)->waitTillDone();
+
+    int expected[] = { 3, 4, 2, 1, 5 };
+    EXPECT_EQ(std::vector<int>(expected, expected+5), mLog.mOrder);
+}
+
+TEST_F(WorkQueueTest, canceled_item_is_completed_without_work)
+{
+    osg::ref_ptr<LogItem> item = add(1, SceneUtil::WorkQueue::Priority_Normal);
+    item->cancel();
+
+    mGate->mOpen = true;
+    item->waitTillDone();
+
+    EXPECT_TRUE(item->isDone());
+    EXPECT_TRUE(mLog.mOrder.empty());
+}
+
+TEST_F(WorkQueueTest, item_is_started_after_its_dependencies)
+{
+    osg::ref_ptr<LogItem> dependent (new LogItem(mLog, 1));
+    dependent->setPriority(SceneUtil::WorkQueue::Priority_High);
+    osg::ref_ptr<LogItem> dependency (new LogItem(mLog, 2));
+    dependent->addDependency(dependency);
+
+    mQueue->addWorkItem(dependent);
+    mQueue->addWorkItem(dependency);
+
+    mGate->mOpen = true;
+    dependent->waitTillDone();
+
+    int expected[] = { 2, 1 };
+    EXPECT_EQ(std::vector<int>(expected, expected+2), mLog.mOrder);
+}
@@ -14,6 +14,31 @@ namespace Files
             char* nonconstBuffer = (const_cast<char*>(buffer));
             this->setg(nonconstBuffer, nonconstBuffer, nonconstBuffer + size);
         }
+
+    protected:
+        virtual pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode which)
+        {
+            if ((which & std::ios_base::in) == 0)
+                return pos_type(off_type(-1));
+
+            char* base = eback();
+            if (dir == std::ios_base::cur)
+                base = gptr();
+            else if (dir == std::ios_base::end)
+                base = egptr();
+
+            char* pos = base + offset;
+            if (pos < eback() || pos > egptr())
+                return pos_type(off_type(-1));
+
+            this->setg(eback(), pos, egptr());
+            return pos_type(pos - eback());
+        }
+
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which)
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
     };
 
     /// @brief A variant of std::istream that reads from a constant in-memory buffer.
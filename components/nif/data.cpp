@@ -1,6 +1,57 @@
 #include "data.hpp"
 #include "node.hpp"
 
+namespace
+{
+
+    /// Skip over the data read by ShapeData::read().
+    /// @return The number of vertices stored
+    size_t skipShapeData(Nif::NIFStream *nif)
+    {
+        int verts = nif->getUShort();
+        size_t numVertices = 0;
+
+        if(nif->getInt())
+        {
+            nif->skip(verts * 3 * sizeof(float));
+            numVertices = verts;
+        }
+
+        if(nif->getInt())
+            nif->skip(verts * 3 * sizeof(float));
+
+        // center and radius
+        nif->skip(4 * sizeof(float));
+
+        if(nif->getInt())
+            nif->skip(verts * 4 * sizeof(float));
+
+        int uvs = nif->getUShort();
+        uvs &= 0x3f;
+
+        if(nif->getInt())
+            nif->skip(uvs * verts * 2 * sizeof(float));
+
+        return numVertices;
+    }
+
+    /// Skip over the data read by NiAutoNormalParticlesData::read().
+    /// @return The number of vertices stored
+    size_t skipParticlesData(Nif::NIFStream *nif)
+    {
+        size_t numVertices = skipShapeData(nif);
+
+        // numParticles, particleRadius, activeCount
+        nif->skip(sizeof(short) + sizeof(float) + sizeof(short));
+
+        if(nif->getInt())
+            nif->skip(numVertices * sizeof(float));
+
+        return numVertices;
+    }
+
+}
+
 namespace Nif
 {
 void NiSkinInstance::read(NIFStream *nif)
@@ -90,6 +141,24 @@ void NiTriShapeData::read(NIFStream *nif)
     }
 }
 
+bool NiTriShapeData::skip(NIFStream *nif)
+{
+    skipShapeData(nif);
+
+    nif->getUShort();
+
+    int cnt = nif->getInt();
+    nif->skip(cnt * sizeof(short));
+
+    int verts = nif->getUShort();
+    for(int i=0;i < verts;i++)
+    {
+        int num = nif->getUShort();
+        nif->skip(num * sizeof(short));
+    }
+    return true;
+}
+
 void NiAutoNormalParticlesData::read(NIFStream *nif)
 {
     ShapeData::read(nif);
@@ -107,6 +176,12 @@ void NiAutoNormalParticlesData::read(NIFStream *nif)
     }
 }
 
+bool NiAutoNormalParticlesData::skip(NIFStream *nif)
+{
+    skipParticlesData(nif);
+    return true;
+}
+
 void NiRotatingParticlesData::read(NIFStream *nif)
 {
     NiAutoNormalParticlesData::read(nif);
@@ -118,12 +193,27 @@ void NiRotatingParticlesData::read(NIFStream *nif)
     }
 }
 
+bool NiRotatingParticlesData::skip(NIFStream *nif)
+{
+    size_t numVertices = skipParticlesData(nif);
+
+    if(nif->getInt())
+        nif->skip(numVertices * 4 * sizeof(float));
+    return true;
+}
+
 void NiPosData::read(NIFStream *nif)
 {
     mKeyList.reset(new Vector3KeyMap);
     mKeyList->read(nif);
 }
 
+bool NiPosData::skip(NIFStream *nif)
+{
+    Vector3KeyMap::skip(nif);
+    return true;
+}
+
 void NiUVData::read(NIFStream *nif)
 {
     for(int i = 0;i < 4;i++)
@@ -133,12 +223,25 @@ void NiUVData::read(NIFStream *nif)
     }
 }
 
+bool NiUVData::skip(NIFStream *nif)
+{
+    for(int i = 0;i < 4;i++)
+        FloatKeyMap::skip(nif);
+    return true;
+}
+
 void NiFloatData::read(NIFStream *nif)
 {
     mKeyList.reset(new FloatKeyMap);
     mKeyList->read(nif);
 }
 
+bool NiFloatData::skip(NIFStream *nif)
+{
+    FloatKeyMap::skip(nif);
+    return true;
+}
+
 void NiPixelData::read(NIFStream *nif)
 {
     fmt = (Format)nif->getUInt();
@@ -175,12 +278,32 @@ void NiPixelData::read(NIFStream *nif)
         data.push_back((unsigned char)nif->getChar());
 }
 
+bool NiPixelData::skip(NIFStream *nif)
+{
+    // format, masks, bpp and unknown data
+    nif->skip(6 * sizeof(int) + 12);
+
+    int mipCount = nif->getInt();
+    nif->getInt();
+    nif->skip(mipCount * 3 * sizeof(int));
+
+    unsigned int dataSize = nif->getInt();
+    nif->skip(dataSize);
+    return true;
+}
+
 void NiColorData::read(NIFStream *nif)
 {
     mKeyMap.reset(new Vector4KeyMap);
     mKeyMap->read(nif);
 }
 
+bool NiColorData::skip(NIFStream *nif)
+{
+    Vector4KeyMap::skip(nif);
+    return true;
+}
+
 void NiVisData::read(NIFStream *nif)
 {
     int count = nif->getInt();
@@ -192,6 +315,13 @@ void NiVisData::read(NIFStream *nif)
     }
 }
 
+bool NiVisData::skip(NIFStream *nif)
+{
+    int count = nif->getInt();
+    nif->skip(count * (sizeof(float) + sizeof(char)));
+    return true;
+}
+
 void NiSkinData::read(NIFStream *nif)
 {
     trafo.rotation = nif->getMatrix3();
@@ -237,6 +367,20 @@ void NiMorphData::read(NIFStream *nif)
     }
 }
 
+bool NiMorphData::skip(NIFStream *nif)
+{
+    int morphCount = nif->getInt();
+    int vertCount  = nif->getInt();
+    nif->getChar();
+
+    for(int i = 0;i < morphCount;i++)
+    {
+        FloatKeyMap::skip(nif, true);
+        nif->skip(vertCount * 3 * sizeof(float));
+    }
+    return true;
+}
+
 void NiKeyframeData::read(NIFStream *nif)
 {
     mRotations.reset(new QuaternionKeyMap);
@@ -258,4 +402,18 @@ void NiKeyframeData::read(NIFStream *nif)
     mScales->read(nif);
 }
 
+bool NiKeyframeData::skip(NIFStream *nif)
+{
+    if(QuaternionKeyMap::skip(nif) == QuaternionKeyMap::sXYZInterpolation)
+    {
+        nif->getFloat();
+        FloatKeyMap::skip(nif, true);
+        FloatKeyMap::skip(nif, true);
+        FloatKeyMap::skip(nif, true);
+    }
+    Vector3KeyMap::skip(nif);
+    FloatKeyMap::skip(nif);
+    return true;
+}
+
 } // Namespace
@@ -51,6 +51,7 @@ public:
     std::vector<unsigned short> triangles;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiAutoNormalParticlesData : public ShapeData
@@ -65,6 +66,7 @@ public:
     std::vector<float> sizes;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiRotatingParticlesData : public NiAutoNormalParticlesData
@@ -73,6 +75,7 @@ public:
     std::vector<osg::Quat> rotations;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiPosData : public Record
@@ -81,6 +84,7 @@ public:
     Vector3KeyMapPtr mKeyList;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiUVData : public Record
@@ -89,6 +93,7 @@ public:
     FloatKeyMapPtr mKeyList[4];
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiFloatData : public Record
@@ -97,6 +102,7 @@ public:
     FloatKeyMapPtr mKeyList;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiPixelData : public Record
@@ -127,6 +133,7 @@ public:
     std::vector<unsigned char> data;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiColorData : public Record
@@ -135,6 +142,7 @@ public:
     Vector4KeyMapPtr mKeyMap;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiVisData : public Record
@@ -147,6 +155,7 @@ public:
     std::vector<VisData> mVis;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 class NiSkinInstance : public Record
@@ -192,6 +201,7 @@ struct NiMorphData : public Record
     std::vector<MorphData> mMorphs;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 
@@ -208,6 +218,7 @@ struct NiKeyframeData : public Record
     FloatKeyMapPtr mScales;
 
     void read(NIFStream *nif);
+    bool skip(NIFStream *nif);
 };
 
 } // Namespace
@@ -4,16 +4,49 @@
 #include <map>
 #include <sstream>
 
+#include <OpenThreads/ScopedLock>
+
+#include <components/files/memorystream.hpp>
+
+namespace
+{
+
+    /// Read the rest of the stream into buffer, if the stream can tell its size.
+    /// @return false if the stream could not be read this way, in which case its position is unchanged.
+    bool readRemaining(std::istream& stream, std::vector<char>& buffer)
+    {
+        std::streampos start = stream.tellg();
+        if (start == std::streampos(-1) || !stream.seekg(0, std::ios_base::end))
+            return false;
+        std::streamoff size = stream.tellg() - start;
+        stream.seekg(start);
+        if (size <= 0 || !stream.good())
+            return false;
+
+        buffer.resize(static_cast<size_t>(size));
+        stream.read(&buffer[0], size);
+        if (stream.gcount() != size)
+        {
+            stream.clear();
+            stream.seekg(start);
+            return false;
+        }
+        return true;
+    }
+
+}
+
 namespace Nif
 {
 
 /// Open a NIF stream. The name is used for error messages.
-NIFFile::NIFFile(Files::IStreamPtr stream, const std::string &name)
+NIFFile::NIFFile(Files::IStreamPtr stream, const std::string &name, bool deferData)
     : ver(0)
     , filename(name)
     , mUseSkinning(false)
+    , mNumDeferred(0)
 {
-    parse(stream);
+    parse(stream, deferData);
 }
 
 NIFFile::~NIFFile()
@@ -133,8 +166,16 @@ std::string NIFFile::printVersion(unsigned int version)
     return stream.str();
 }
 
-void NIFFile::parse(Files::IStreamPtr stream)
+void NIFFile::parse(Files::IStreamPtr stream, bool deferData)
 {
+    // the records are made up of many small values, which are much faster to read from memory than through the file stream
+    std::vector<char> buffer;
+    if (readRemaining(*stream, buffer))
+        stream.reset(new Files::IMemStream(&buffer[0], buffer.size()));
+    else
+        // skipped data is read from the buffer later on
+        deferData = false;
+
     NIFStream nif (this, stream);
 
     // Check the header string
@@ -149,6 +190,8 @@ void NIFFile::parse(Files::IStreamPtr stream)
     // Number of records
     size_t recNum = nif.getInt();
     records.resize(recNum);
+    if (deferData)
+        mDeferredOffsets.resize(recNum);
 
     /* The format for 10.0.1.0 seems to be a bit different. After the
      header, it contains the number of records, r (int), just like
@@ -186,9 +229,29 @@ void NIFFile::parse(Files::IStreamPtr stream)
         r->recName = rec;
         r->recIndex = i;
         records[i] = r;
+
+        // the file format has no record sizes, so the records still need to be walked through to find the next one
+        if (deferData)
+        {
+            std::streampos offset = stream->tellg();
+            if (r->skip(&nif))
+            {
+                r->mFile = this;
+                r->mDeferred.exchange(1);
+                mDeferredOffsets[i] = static_cast<size_t>(offset);
+                ++mNumDeferred;
+                continue;
+            }
+        }
         r->read(&nif);
     }
 
+    if (mNumDeferred > 0)
+        // swapping keeps the data in place, so the stream can still read from it
+        mBuffer.swap(buffer);
+    else
+        mDeferredOffsets.clear();
+
     size_t rootNum = nif.getUInt();
     roots.resize(rootNum);
 
@@ -212,6 +275,31 @@ void NIFFile::parse(Files::IStreamPtr stream)
         records[i]->post(this);
 }
 
+void Record::loadDeferred() const
+{
+    mFile->loadDeferred(const_cast<Record*>(this));
+}
+
+void NIFFile::loadDeferred(Record *record) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mDeferredMutex);
+    // another thread may have read the data in the meantime
+    if (record->mDeferred == 0)
+        return;
+
+    size_t offset = mDeferredOffsets[record->recIndex];
+    // the stream only uses the file for error reporting
+    NIFStream nif (const_cast<NIFFile*>(this), Files::IStreamPtr(new Files::IMemStream(&mBuffer[offset], mBuffer.size() - offset)));
+    record->read(&nif);
+    record->mDeferred.exchange(0);
+
+    if (--mNumDeferred == 0)
+    {
+        std::vector<char>().swap(mBuffer);
+        std::vector<size_t>().swap(mDeferredOffsets);
+    }
+}
+
 void NIFFile::setUseSkinning(bool skinning)
 {
     mUseSkinning = skinning;
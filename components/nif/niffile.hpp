@@ -7,6 +7,8 @@
 #include <vector>
 #include <iostream>
 
+#include <OpenThreads/Mutex>
+
 #include <components/files/constrainedfilestream.hpp>
 
 #include "record.hpp"
@@ -34,8 +36,21 @@ class NIFFile
 
     bool mUseSkinning;
 
+    // guarded by mDeferredMutex once parsing is done
+    /// The file's data, kept while there are records whose data was skipped
+    mutable std::vector<char> mBuffer;
+    /// Position of each record's data in mBuffer, if it was skipped
+    mutable std::vector<size_t> mDeferredOffsets;
+    /// Number of records whose data was skipped and not read yet
+    mutable size_t mNumDeferred;
+    mutable OpenThreads::Mutex mDeferredMutex;
+
     /// Parse the file
-    void parse(Files::IStreamPtr stream);
+    void parse(Files::IStreamPtr stream, bool deferData);
+
+    /// Read the data of a record that was skipped while parsing. Called by Record::load().
+    void loadDeferred(Record *record) const;
+    friend struct Record;
 
     /// Get the file's version in a human readable form
     ///\returns A string containing a human readable NIF version number
@@ -62,11 +77,20 @@ public:
     }
 
     /// Open a NIF stream. The name is used for error messages.
-    NIFFile(Files::IStreamPtr stream, const std::string &name);
+    /// @param deferData Skip over the bulk data of records like geometry, animation keys and embedded textures,
+    /// and only read it once the record is accessed. Useful when users of the file may not need all of its data.
+    NIFFile(Files::IStreamPtr stream, const std::string &name, bool deferData=false);
     ~NIFFile();
 
-    /// Get a given record
+    /// Get a given record, reading its data if it was deferred
     Record *getRecord(size_t index) const
+    {
+        Record *res = records.at(index);
+        res->load();
+        return res;
+    }
+    /// Get a given record without reading its data, e.g. to resolve references between records
+    Record *getRecordUnloaded(size_t index) const
     {
         Record *res = records.at(index);
         return res;
@@ -5,8 +5,9 @@
 
 #include "nifstream.hpp"
 
+#include <algorithm>
 #include <sstream>
-#include <map>
+#include <vector>
 
 #include "niffile.hpp"
 
@@ -33,7 +34,8 @@ typedef KeyT<osg::Quat> QuaternionKey;
 
 template<typename T, T (NIFStream::*getValue)()>
 struct KeyMapT {
-    typedef std::map< float, KeyT<T> > MapType;
+    /// Keys and their times, sorted by time. Each time is unique.
+    typedef std::vector< std::pair<float, KeyT<T> > > MapType;
 
     typedef T ValueType;
     typedef KeyT<T> KeyType;
@@ -63,6 +65,10 @@ struct KeyMapT {
 
         mInterpolationType = nif->getUInt();
 
+        if(mInterpolationType == sLinearInterpolation || mInterpolationType == sQuadraticInterpolation
+                || mInterpolationType == sTBCInterpolation)
+            mKeys.reserve(count);
+
         KeyT<T> key;
         NIFStream &nifReference = *nif;
 
@@ -72,7 +78,7 @@ struct KeyMapT {
             {
                 float time = nif->getFloat();
                 readValue(nifReference, key);
-                mKeys[time] = key;
+                mKeys.push_back(std::make_pair(time, key));
             }
         }
         else if(mInterpolationType == sQuadraticInterpolation)
@@ -81,7 +87,7 @@ struct KeyMapT {
             {
                 float time = nif->getFloat();
                 readQuadratic(nifReference, key);
-                mKeys[time] = key;
+                mKeys.push_back(std::make_pair(time, key));
             }
         }
         else if(mInterpolationType == sTBCInterpolation)
@@ -90,15 +96,75 @@ struct KeyMapT {
             {
                 float time = nif->getFloat();
                 readTBC(nifReference, key);
-                mKeys[time] = key;
+                mKeys.push_back(std::make_pair(time, key));
             }
         }
-        //XYZ keys aren't actually read here.
-        //data.hpp sees that the last type read was sXYZInterpolation and:
-        //    Eats a floating point number, then
-        //    Re-runs the read function 3 more times.
-        //        When it does that it's reading in a bunch of sLinearInterpolation keys, not sXYZInterpolation.
-        else if(mInterpolationType == sXYZInterpolation)
+        else
+            checkKeylessInterpolation(nif, mInterpolationType, count);
+
+        sortKeys();
+    }
+
+    /// Skip over a KeyGroup without storing its keys, see read().
+    /// @return The interpolation type, or 0 if the group is empty
+    static unsigned int skip(NIFStream *nif, bool force=false)
+    {
+        assert(nif);
+
+        size_t count = nif->getUInt();
+        if(count == 0 && !force)
+            return 0;
+
+        unsigned int interpolationType = nif->getUInt();
+
+        const T* value = NULL;
+        if(interpolationType == sLinearInterpolation)
+            nif->skip(count * (sizeof(float) + getValueSize(value)));
+        else if(interpolationType == sQuadraticInterpolation)
+            nif->skip(count * (sizeof(float) + getQuadraticSize(value)));
+        else if(interpolationType == sTBCInterpolation)
+            nif->skip(count * (sizeof(float) + getValueSize(value) + 3 * sizeof(float)));
+        else
+            checkKeylessInterpolation(nif, interpolationType, count);
+        return interpolationType;
+    }
+
+private:
+    static bool compareTime(const typename MapType::value_type& left, const typename MapType::value_type& right)
+    {
+        return left.first < right.first;
+    }
+
+    /// Sort the keys by time in case the file did not, keeping the last one of several keys with the same time.
+    void sortKeys()
+    {
+        bool sorted = true;
+        for(size_t i = 1;i < mKeys.size() && sorted;i++)
+            sorted = mKeys[i-1].first < mKeys[i].first;
+        if(sorted)
+            return;
+
+        std::stable_sort(mKeys.begin(), mKeys.end(), compareTime);
+
+        MapType unique;
+        unique.reserve(mKeys.size());
+        for(size_t i = 0;i < mKeys.size();i++)
+        {
+            if(i+1 < mKeys.size() && mKeys[i+1].first == mKeys[i].first)
+                continue;
+            unique.push_back(mKeys[i]);
+        }
+        mKeys.swap(unique);
+    }
+
+    //XYZ keys aren't actually read here.
+    //data.hpp sees that the last type read was sXYZInterpolation and:
+    //    Eats a floating point number, then
+    //    Re-runs the read function 3 more times.
+    //        When it does that it's reading in a bunch of sLinearInterpolation keys, not sXYZInterpolation.
+    static void checkKeylessInterpolation(NIFStream *nif, unsigned int interpolationType, size_t count)
+    {
+        if(interpolationType == sXYZInterpolation)
         {
             //Don't try to read XYZ keys into the wrong part
             if ( count != 1 )
@@ -109,7 +175,7 @@ struct KeyMapT {
                 nif->file->fail(error.str());
             }
         }
-        else if (0 == mInterpolationType)
+        else if (0 == interpolationType)
         {
             if (count != 0)
                 nif->file->fail("Interpolation type 0 doesn't work with keys");
@@ -117,12 +183,35 @@ struct KeyMapT {
         else
         {
             std::stringstream error;
-            error << "Unhandled interpolation type: " << mInterpolationType;
+            error << "Unhandled interpolation type: " << interpolationType;
             nif->file->fail(error.str());
         }
     }
 
-private:
+    /// Size of a value in the file
+    template <typename U>
+    static size_t getValueSize(const U*)
+    {
+        return sizeof(U);
+    }
+
+    static size_t getValueSize(const osg::Quat*)
+    {
+        return 4 * sizeof(float);
+    }
+
+    /// Size of a quadratic key's values in the file, see readQuadratic()
+    template <typename U>
+    static size_t getQuadraticSize(const U* value)
+    {
+        return 3 * getValueSize(value);
+    }
+
+    static size_t getQuadraticSize(const osg::Quat* value)
+    {
+        return getValueSize(value);
+    }
+
     static void readValue(NIFStream &nif, KeyT<T> &key)
     {
         key.mValue = (nif.*getValue)();
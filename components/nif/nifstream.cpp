@@ -2,6 +2,8 @@
 //For error reporting
 #include "niffile.hpp"
 
+#include <osg/Endian>
+
 namespace Nif
 {
 
@@ -33,46 +35,51 @@ float NIFStream::read_le32f()
     return u.f;
 }
 
+template <typename T>
+void NIFStream::readLittleEndianBuffer(T* dest, size_t numElements)
+{
+    if (numElements == 0)
+        return;
+
+    inp->read(reinterpret_cast<char*>(dest), numElements * sizeof(T));
+
+    if (osg::getCpuByteOrder() == osg::BigEndian)
+    {
+        for (size_t i = 0;i < numElements;i++)
+            osg::swapBytes(reinterpret_cast<char*>(&dest[i]), sizeof(T));
+    }
+}
+
 //Public functions
 osg::Vec2f NIFStream::getVector2()
 {
     osg::Vec2f vec;
-    for(size_t i = 0;i < 2;i++)
-        vec._v[i] = getFloat();
+    readLittleEndianBuffer(vec._v, 2);
     return vec;
 }
 osg::Vec3f NIFStream::getVector3()
 {
     osg::Vec3f vec;
-    for(size_t i = 0;i < 3;i++)
-        vec._v[i] = getFloat();
+    readLittleEndianBuffer(vec._v, 3);
     return vec;
 }
 osg::Vec4f NIFStream::getVector4()
 {
     osg::Vec4f vec;
-    for(size_t i = 0;i < 4;i++)
-        vec._v[i] = getFloat();
+    readLittleEndianBuffer(vec._v, 4);
     return vec;
 }
 Matrix3 NIFStream::getMatrix3()
 {
     Matrix3 mat;
-    for(size_t i = 0;i < 3;i++)
-    {
-        for(size_t j = 0;j < 3;j++)
-            mat.mValues[i][j] = getFloat();
-    }
+    readLittleEndianBuffer(&mat.mValues[0][0], 9);
     return mat;
 }
 osg::Quat NIFStream::getQuaternion()
 {
-    osg::Quat quat;
-    quat.w() = getFloat();
-    quat.x() = getFloat();
-    quat.y() = getFloat();
-    quat.z() = getFloat();
-    return quat;
+    float values[4];
+    readLittleEndianBuffer(values, 4);
+    return osg::Quat(values[1], values[2], values[3], values[0]);
 }
 Transformation NIFStream::getTrafo()
 {
@@ -103,41 +110,52 @@ std::string NIFStream::getVersionString()
     return result;
 }
 
+// The vector types are plain arrays of floats, so whole vectors of them can be read at once.
+static_assert(sizeof(osg::Vec2f) == 2*sizeof(float), "unexpected padding in osg::Vec2f");
+static_assert(sizeof(osg::Vec3f) == 3*sizeof(float), "unexpected padding in osg::Vec3f");
+static_assert(sizeof(osg::Vec4f) == 4*sizeof(float), "unexpected padding in osg::Vec4f");
+
 void NIFStream::getUShorts(std::vector<unsigned short> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getUShort();
+    if (size > 0)
+        readLittleEndianBuffer(&vec[0], size);
 }
 void NIFStream::getFloats(std::vector<float> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getFloat();
+    if (size > 0)
+        readLittleEndianBuffer(&vec[0], size);
 }
 void NIFStream::getVector2s(std::vector<osg::Vec2f> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getVector2();
+    if (size > 0)
+        readLittleEndianBuffer(vec[0]._v, size*2);
 }
 void NIFStream::getVector3s(std::vector<osg::Vec3f> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getVector3();
+    if (size > 0)
+        readLittleEndianBuffer(vec[0]._v, size*3);
 }
 void NIFStream::getVector4s(std::vector<osg::Vec4f> &vec, size_t size)
 {
     vec.resize(size);
-    for(size_t i = 0;i < vec.size();i++)
-        vec[i] = getVector4();
+    if (size > 0)
+        readLittleEndianBuffer(vec[0]._v, size*4);
 }
 void NIFStream::getQuaternions(std::vector<osg::Quat> &quat, size_t size)
 {
     quat.resize(size);
-    for(size_t i = 0;i < quat.size();i++)
-        quat[i] = getQuaternion();
+    if (size == 0)
+        return;
+
+    // stored as w, x, y, z floats, while osg::Quat holds x, y, z, w doubles
+    std::vector<float> values (size*4);
+    readLittleEndianBuffer(&values[0], values.size());
+    for(size_t i = 0;i < size;i++)
+        quat[i].set(values[i*4+1], values[i*4+2], values[i*4+3], values[i*4]);
 }
 
 }
@@ -31,6 +31,10 @@ class NIFStream {
     uint32_t read_le32();
     float read_le32f();
 
+    /// Read numElements little endian values of type T at once.
+    template <typename T>
+    void readLittleEndianBuffer(T* dest, size_t numElements);
+
 public:
 
     NIFFile * const file;
@@ -26,6 +26,8 @@
 
 #include <string>
 
+#include <OpenThreads/Atomic>
+
 namespace Nif
 {
 
@@ -104,15 +106,37 @@ struct Record
     std::string recName;
     size_t recIndex;
 
-    Record() : recType(RC_MISSING), recIndex(~(size_t)0) {}
+    Record() : recType(RC_MISSING), recIndex(~(size_t)0), mFile(NULL) {}
 
     /// Parses the record from file
     virtual void read(NIFStream *nif) = 0;
 
+    /// Skips over the data that read() would parse, so that it can be read on first access instead.
+    /// Only supported by records that do not reference other records.
+    /// @return false if the data has to be read right away, in which case nothing was skipped
+    virtual bool skip(NIFStream *nif) { return false; }
+
     /// Does post-processing, after the entire tree is loaded
     virtual void post(NIFFile *nif) {}
 
+    /// Read the record's data if it was skipped while parsing the file. Thread safe.
+    void load() const
+    {
+        if (mDeferred > 0)
+            loadDeferred();
+    }
+
     virtual ~Record() {}
+
+private:
+    friend class NIFFile;
+
+    void loadDeferred() const;
+
+    /// The file that the skipped data is read from
+    const NIFFile *mFile;
+    /// Set while the record's data is not read yet
+    mutable OpenThreads::Atomic mDeferred;
 };
 
 } // Namespace
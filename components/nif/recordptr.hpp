@@ -41,22 +41,25 @@ public:
             ptr = NULL;
         else
         {
-            Record *r = nif->getRecord(index);
+            // the referenced record's data is not needed yet, so don't read it if it was deferred
+            Record *r = nif->getRecordUnloaded(index);
             // And cast it
             ptr = dynamic_cast<X*>(r);
             assert(ptr != NULL);
         }
     }
 
-    /// Look up the actual object from the index
+    /// Look up the actual object from the index, reading its data if it was deferred
     const X* getPtr() const
     {
         assert(ptr != NULL);
+        ptr->load();
         return ptr;
     }
     X* getPtr()
     {
         assert(ptr != NULL);
+        ptr->load();
         return ptr;
     }
 
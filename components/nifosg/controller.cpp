@@ -117,7 +117,8 @@ osg::Vec3f KeyframeController::getTranslation(float time) const
 
 void KeyframeController::operator() (osg::Node* node, osg::NodeVisitor* nv)
 {
-    if (hasInput())
+    // a frozen animation keeps the pose of the last update
+    if (hasInput() && !isInputFrozen())
     {
         osg::MatrixTransform* trans = static_cast<osg::MatrixTransform*>(node);
         osg::Matrix mat = trans->getMatrix();
@@ -9,6 +9,7 @@
 #include <components/sceneutil/controller.hpp>
 #include <components/sceneutil/statesetupdater.hpp>
 
+#include <algorithm>
 #include <set> //UVController
 
 // FlipController
@@ -43,18 +44,15 @@ namespace NifOsg
 
         ValueInterpolator()
             : mDefaultVal(ValueT())
+            , mLastHighKey(0)
         {
         }
 
         ValueInterpolator(std::shared_ptr<const MapT> keys, ValueT defaultVal = ValueT())
             : mKeys(keys)
             , mDefaultVal(defaultVal)
+            , mLastHighKey(0)
         {
-            if (keys)
-            {
-                mLastLowKey = mKeys->mKeys.end();
-                mLastHighKey = mKeys->mKeys.end();
-            }
         }
 
         ValueT interpKey(float time) const
@@ -64,47 +62,35 @@ namespace NifOsg
 
             const typename MapT::MapType & keys = mKeys->mKeys;
 
-            if(time <= keys.begin()->first)
-                return keys.begin()->second.mValue;
+            if(time <= keys.front().first)
+                return keys.front().second.mValue;
 
-            // retrieve the current position in the map, optimized for the most common case
+            // retrieve the first key at or after the given time, optimized for the most common case
             // where time moves linearly along the keyframe track
-            typename MapT::MapType::const_iterator it = mLastHighKey;
-            if (mLastHighKey != keys.end())
+            size_t index = mLastHighKey;
+            if (index < keys.size() && time > keys[index].first)
             {
-                if (time > mLastHighKey->first)
-                {
-                    // try if we're there by incrementing one
-                    ++mLastLowKey;
-                    ++mLastHighKey;
-                    it = mLastHighKey;
-                }
-                if (mLastHighKey == keys.end() || (time < mLastLowKey->first || time > mLastHighKey->first))
-                    it = keys.lower_bound(time); // still not there, reorient by performing lower_bound check on the whole map
+                // try if we're there by incrementing one
+                ++index;
             }
-            else
-                it = keys.lower_bound(time);
-
-            // now do the actual interpolation
-            if (it != keys.end())
+            if (index == 0 || index >= keys.size() || time > keys[index].first || time <= keys[index-1].first)
             {
-                float aTime = it->first;
-                const typename MapT::KeyType* aKey = &it->second;
+                // still not there, reorient by performing a binary search on all keys
+                index = std::lower_bound(keys.begin(), keys.end(), time, compareTime) - keys.begin();
+                if (index == keys.size())
+                    return keys.back().second.mValue;
+            }
 
-                // cache for next time
-                mLastHighKey = it;
+            // cache for next time
+            mLastHighKey = index;
 
-                typename MapT::MapType::const_iterator last = --it;
-                mLastLowKey = last;
-                float aLastTime = last->first;
-                const typename MapT::KeyType* aLastKey = &last->second;
+            // now do the actual interpolation
+            const typename MapT::MapType::value_type& key = keys[index];
+            const typename MapT::MapType::value_type& lastKey = keys[index-1];
 
-                float a = (time - aLastTime) / (aTime - aLastTime);
+            float a = (time - lastKey.first) / (key.first - lastKey.first);
 
-                return InterpolationFunc()(aLastKey->mValue, aKey->mValue, a);
-            }
-            else
-                return keys.rbegin()->second.mValue;
+            return InterpolationFunc()(lastKey.second.mValue, key.second.mValue, a);
         }
 
         bool empty() const
@@ -113,12 +99,17 @@ namespace NifOsg
         }
 
     private:
-        mutable typename MapT::MapType::const_iterator mLastLowKey;
-        mutable typename MapT::MapType::const_iterator mLastHighKey;
+        static bool compareTime(const typename MapT::MapType::value_type& key, float time)
+        {
+            return key.first < time;
+        }
 
         std::shared_ptr<const MapT> mKeys;
 
         ValueT mDefaultVal;
+
+        /// Index of the key found by the last lookup
+        mutable size_t mLastHighKey;
     };
 
     struct LerpFunc
@@ -7,6 +7,8 @@
 #include <osg/Version>
 
 #include <BulletCollision/CollisionShapes/btTriangleMesh.h>
+#include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
+#include <BulletCollision/CollisionShapes/btCompoundShape.h>
 
 #include <components/vfs/manager.hpp>
 
@@ -21,6 +23,38 @@
 namespace Resource
 {
 
+namespace
+{
+
+/// Rough estimate of the memory used by a collision shape: per triangle, the indices, up to three vertices and the BVH nodes.
+size_t estimateShapeSize(const btCollisionShape* shape)
+{
+    if (!shape)
+        return 0;
+
+    if (shape->isCompound())
+    {
+        const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+        size_t size = sizeof(btCompoundShape);
+        for (int i=0; i<compound->getNumChildShapes(); ++i)
+            size += estimateShapeSize(compound->getChildShape(i));
+        return size;
+    }
+
+    if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
+    {
+        const btTriangleMeshShape* meshShape = static_cast<const btTriangleMeshShape*>(shape);
+        if (const btTriangleMesh* mesh = dynamic_cast<const btTriangleMesh*>(meshShape->getMeshInterface()))
+            return sizeof(btBvhTriangleMeshShape) + mesh->getNumTriangles() * (3 * sizeof(unsigned int) + 3 * sizeof(btVector3) + 2 * sizeof(btQuantizedBvhNode));
+        return sizeof(btBvhTriangleMeshShape);
+    }
+
+    // primitive shapes
+    return sizeof(btCollisionShape);
+}
+
+}
+
 struct GetTriangleFunctor
 {
     GetTriangleFunctor()
@@ -147,7 +181,7 @@ osg::ref_ptr<const BulletShape> BulletShapeManager::getShape(const std::string &
             }
         }
 
-        mCache->addEntryToObjectCache(normalized, shape);
+        mCache->addEntryToObjectCache(normalized, shape, 0.0, sizeof(BulletShape) + estimateShapeSize(shape->mCollisionShape));
     }
     return shape;
 }
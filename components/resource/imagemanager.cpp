@@ -131,7 +131,7 @@ namespace Resource
                 return mWarningImage;
             }
 
-            mCache->addEntryToObjectCache(normalized, image);
+            mCache->addEntryToObjectCache(normalized, image, 0.0, image->getTotalSizeInBytesIncludingMipmaps());
             return image;
         }
     }
@@ -27,9 +27,12 @@ namespace Resource
         else
         {
             osg::ref_ptr<NifOsg::KeyframeHolder> loaded (new NifOsg::KeyframeHolder);
-            NifOsg::Loader::loadKf(Nif::NIFFilePtr(new Nif::NIFFile(mVFS->getNormalized(normalized), normalized)), *loaded.get());
+            Files::IStreamPtr stream = mVFS->getNormalized(normalized);
+            NifOsg::Loader::loadKf(Nif::NIFFilePtr(new Nif::NIFFile(stream, normalized)), *loaded.get());
 
-            mCache->addEntryToObjectCache(normalized, loaded);
+            // the keyframes make up most of a .kf file
+            std::streamoff size = stream->tellg();
+            mCache->addEntryToObjectCache(normalized, loaded, 0.0, size > 0 ? static_cast<size_t>(size) : 0);
             return loaded;
         }
     }
@@ -44,15 +44,29 @@ namespace Resource
 
     Nif::NIFFilePtr NifFileManager::get(const std::string &name)
     {
-        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(name);
-        if (obj)
+        // if another thread is parsing the same file, wait for it rather than parsing it twice
+        bool reserved = false;
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCacheOrReserve(name, reserved);
+        if (!reserved)
             return static_cast<NifFileHolder*>(obj.get())->mNifFile;
         else
         {
-            Nif::NIFFilePtr file (new Nif::NIFFile(mVFS->get(name), name));
-            obj = new NifFileHolder(file);
-            mCache->addEntryToObjectCache(name, obj);
-            return file;
+            try
+            {
+                Files::IStreamPtr stream = mVFS->get(name);
+                // the file is shared by the scene and collision loaders, which each only need part of its data
+                Nif::NIFFilePtr file (new Nif::NIFFile(stream, name, true));
+                obj = new NifFileHolder(file);
+                // the parsed records take about as much memory as the data they were read from
+                std::streamoff size = stream->tellg();
+                mCache->addEntryToObjectCache(name, obj, 0.0, size > 0 ? static_cast<size_t>(size) : 0);
+                return file;
+            }
+            catch (...)
+            {
+                mCache->cancelReservation(name);
+                throw;
+            }
         }
     }
 
@@ -13,6 +13,8 @@
 
 #include "objectcache.hpp"
 
+#include <functional>
+
 #include <osg/Object>
 #include <osg/Node>
 
@@ -32,30 +34,85 @@ ObjectCache::~ObjectCache()
 {
 }
 
-void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp)
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[filename]=ObjectTimeStampPair(object,timestamp);
+    return _shards[std::hash<std::string>()(fileName) % NumShards];
+}
+
+void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, size_t size)
+{
+    osg::ref_ptr<osg::Object> replaced;
+    Shard& shard = getShard(filename);
+    {
+        ShardLock lock(*this, shard);
+        Entry& entry = shard._objectCache[filename];
+        replaced = entry._object;
+        bool wasLoading = entry._loading;
+        shard._memoryUsage -= entry._size;
+        entry = Entry(object, timestamp, size);
+        shard._memoryUsage += size;
+        if (wasLoading)
+            shard._condition.broadcast();
+    }
+    // note, the replaced object is unrefed outside of the lock
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    ShardLock lock(*this, shard);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr!=shard._objectCache.end())
     {
-        return itr->second.first;
+        return itr->second._object;
     }
     else return 0;
 }
 
+osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCacheOrReserve(const std::string& fileName, bool& reserved)
+{
+    Shard& shard = getShard(fileName);
+    ShardLock lock(*this, shard);
+    while (true)
+    {
+        ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+        if (itr == shard._objectCache.end())
+        {
+            shard._objectCache[fileName]._loading = true;
+            reserved = true;
+            return 0;
+        }
+        if (!itr->second._loading)
+        {
+            reserved = false;
+            return itr->second._object;
+        }
+        ++shard._numWaiting;
+        shard._condition.wait(&shard._mutex);
+        --shard._numWaiting;
+    }
+}
+
+void ObjectCache::cancelReservation(const std::string& fileName)
+{
+    Shard& shard = getShard(fileName);
+    ShardLock lock(*this, shard);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr != shard._objectCache.end() && itr->second._loading)
+    {
+        shard._objectCache.erase(itr);
+        shard._condition.broadcast();
+    }
+}
+
 bool ObjectCache::checkInObjectCache(const std::string &fileName, double timeStamp)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(fileName);
+    ShardLock lock(*this, shard);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr!=shard._objectCache.end() && !itr->second._loading)
     {
-        itr->second.second = timeStamp;
+        itr->second._timeStamp = timeStamp;
         return true;
     }
     else return false;
@@ -63,18 +120,22 @@ bool ObjectCache::checkInObjectCache(const std::string &fileName, double timeSta
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Shard& shard = _shards[i];
+        ShardLock lock(*this, shard);
+
+        // look for objects with external references and update their time stamp.
+        for(ObjectCacheMap::iterator itr=shard._objectCache.begin();
+            itr!=shard._objectCache.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second._object.valid() && itr->second._object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second._timeStamp = referenceTime;
+            }
         }
     }
 }
@@ -83,17 +144,20 @@ void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
     std::vector<osg::ref_ptr<osg::Object> > objectsToRemove;
 
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+        Shard& shard = _shards[i];
+        ShardLock lock(*this, shard);
 
         // Remove expired entries from object cache
-        ObjectCacheMap::iterator oitr = _objectCache.begin();
-        while(oitr != _objectCache.end())
+        ObjectCacheMap::iterator oitr = shard._objectCache.begin();
+        while(oitr != shard._objectCache.end())
         {
-            if (oitr->second.second<=expiryTime)
+            if (oitr->second._timeStamp<=expiryTime && !oitr->second._loading)
             {
-                objectsToRemove.push_back(oitr->second.first);
-                _objectCache.erase(oitr++);
+                objectsToRemove.push_back(oitr->second._object);
+                shard._memoryUsage -= oitr->second._size;
+                shard._objectCache.erase(oitr++);
             }
             else
             {
@@ -108,52 +172,161 @@ void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = _objectCache.find(fileName);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    ShardLock lock(*this, shard);
+    ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+    if (itr!=shard._objectCache.end() && !itr->second._loading)
+    {
+        shard._memoryUsage -= itr->second._size;
+        shard._objectCache.erase(itr);
+    }
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        Shard& shard = _shards[i];
+        ShardLock lock(*this, shard);
+
+        // keep the reservations, so the threads waiting for them are woken up once their objects are loaded
+        ObjectCacheMap::iterator oitr = shard._objectCache.begin();
+        while(oitr != shard._objectCache.end())
+        {
+            if (!oitr->second._loading)
+                shard._objectCache.erase(oitr++);
+            else
+                ++oitr;
+        }
+        shard._memoryUsage = 0;
+    }
 }
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        osg::Object* object = itr->second.first.get();
-        object->releaseGLObjects(state);
+        Shard& shard = _shards[i];
+        ShardLock lock(*this, shard);
+
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            ++itr)
+        {
+            osg::Object* object = itr->second._object.get();
+            if (object)
+                object->releaseGLObjects(state);
+        }
     }
 }
 
 void ObjectCache::accept(osg::NodeVisitor &nv)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    for (unsigned int i=0; i<NumShards; ++i)
     {
-        osg::Object* object = itr->second.first.get();
-        if (object)
+        Shard& shard = _shards[i];
+        ShardLock lock(*this, shard);
+
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            ++itr)
         {
-            osg::Node* node = dynamic_cast<osg::Node*>(object);
-            if (node)
-                node->accept(nv);
+            osg::Object* object = itr->second._object.get();
+            if (object)
+            {
+                osg::Node* node = dynamic_cast<osg::Node*>(object);
+                if (node)
+                    node->accept(nv);
+            }
         }
     }
 }
 
 unsigned int ObjectCache::getCacheSize() const
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    return _objectCache.size();
+    unsigned int size = 0;
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        ShardLock lock(*this, _shards[i]);
+        size += _shards[i]._objectCache.size();
+    }
+    return size;
+}
+
+unsigned int ObjectCache::getNumWaitingThreads() const
+{
+    unsigned int numWaiting = 0;
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        ShardLock lock(*this, _shards[i]);
+        numWaiting += _shards[i]._numWaiting;
+    }
+    return numWaiting;
+}
+
+size_t ObjectCache::getMemoryUsage() const
+{
+    size_t usage = 0;
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        ShardLock lock(*this, _shards[i]);
+        usage += _shards[i]._memoryUsage;
+    }
+    return usage;
+}
+
+unsigned int ObjectCache::takeNumContentions()
+{
+    return _numContentions.exchange(0);
+}
+
+void ObjectCache::getEvictionCandidates(std::vector<EvictionCandidate>& candidates)
+{
+    for (unsigned int i=0; i<NumShards; ++i)
+    {
+        Shard& shard = _shards[i];
+        ShardLock lock(*this, shard);
+
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            ++itr)
+        {
+            const Entry& entry = itr->second;
+            // objects that are referenced elsewhere would stay in memory anyway
+            if (entry._size == 0 || !entry._object.valid() || entry._object->referenceCount()>1)
+                continue;
+
+            EvictionCandidate candidate;
+            candidate._cache = this;
+            candidate._fileName = itr->first;
+            candidate._timeStamp = entry._timeStamp;
+            candidate._size = entry._size;
+            candidates.push_back(candidate);
+        }
+    }
+}
+
+size_t ObjectCache::evict(const std::string &fileName)
+{
+    osg::ref_ptr<osg::Object> object;
+    size_t size = 0;
+
+    {
+        Shard& shard = getShard(fileName);
+        ShardLock lock(*this, shard);
+        ObjectCacheMap::iterator itr = shard._objectCache.find(fileName);
+        // the object may have been picked up again since the candidates were gathered
+        if (itr == shard._objectCache.end() || !itr->second._object.valid() || itr->second._object->referenceCount()>1)
+            return 0;
+
+        object = itr->second._object;
+        size = itr->second._size;
+        shard._memoryUsage -= size;
+        shard._objectCache.erase(itr);
+    }
+
+    // note, actual unref happens outside of the lock
+    return size;
 }
 
 }
@@ -1,5 +1,8 @@
 // Resource ObjectCache for OpenMW, forked from osgDB ObjectCache by Robert Osfield, see copyright notice below.
 // The main change from the upstream version is that removeExpiredObjectsInCache no longer keeps a lock while the unref happens.
+// In addition, the cache keeps track of the estimated memory used by its objects, so that they can be evicted to stay within a budget,
+// the entries are spread over several independently locked shards to reduce contention between loading threads, and an entry
+// can be reserved while its object is being loaded, so that other threads wait for that object instead of loading it again.
 
 /* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
  *
@@ -20,8 +23,13 @@
 #include <osg/Referenced>
 #include <osg/ref_ptr>
 
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
+
 #include <string>
 #include <map>
+#include <vector>
 
 namespace osg
 {
@@ -55,8 +63,10 @@ class ObjectCache : public osg::Referenced
         /** Remove all objects in the cache regardless of having external references or expiry times.*/
         void clear();
 
-        /** Add a filename,object,timestamp triple to the Registry::ObjectCache.*/
-        void addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp = 0.0);
+        /** Add a filename,object,timestamp triple to the Registry::ObjectCache.
+          * size is the estimated memory used by the object in bytes, to be used for getMemoryUsage().
+          * Completes a reservation of the entry, waking up the threads waiting for it.*/
+        void addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp = 0.0, size_t size = 0);
 
         /** Remove Object from cache.*/
         void removeFromObjectCache(const std::string& fileName);
@@ -64,6 +74,16 @@ class ObjectCache : public osg::Referenced
         /** Get an ref_ptr<Object> from the object cache*/
         osg::ref_ptr<osg::Object> getRefFromObjectCache(const std::string& fileName);
 
+        /** Get an ref_ptr<Object> from the object cache. If the object is not in the cache, reserve its entry and set reserved to true,
+          * in which case the caller must load the object and then call either addEntryToObjectCache or cancelReservation.
+          * If another thread has reserved the entry, wait until it is done loading.
+          * @note The reserving thread must not request the same entry again before completing the reservation.*/
+        osg::ref_ptr<osg::Object> getRefFromObjectCacheOrReserve(const std::string& fileName, bool& reserved);
+
+        /** Give up a reservation made by getRefFromObjectCacheOrReserve, e.g. because the object failed to load.
+          * One of the threads waiting for the entry will reserve it in turn.*/
+        void cancelReservation(const std::string& fileName);
+
         /** Check if an object is in the cache, and if it is, update its usage time stamp. */
         bool checkInObjectCache(const std::string& fileName, double timeStamp);
 
@@ -77,23 +97,104 @@ class ObjectCache : public osg::Referenced
         template <class Functor>
         void call(Functor& f)
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-            for (ObjectCacheMap::iterator it = _objectCache.begin(); it != _objectCache.end(); ++it)
-                f(it->second.first.get());
+            for (unsigned int i=0; i<NumShards; ++i)
+            {
+                ShardLock lock(*this, _shards[i]);
+                for (ObjectCacheMap::iterator it = _shards[i]._objectCache.begin(); it != _shards[i]._objectCache.end(); ++it)
+                {
+                    if (!it->second._loading)
+                        f(it->second._object.get());
+                }
+            }
         }
 
         /** Get the number of objects in the cache. */
         unsigned int getCacheSize() const;
 
+        /** Get the sum of the estimated sizes of the objects in the cache, in bytes. */
+        size_t getMemoryUsage() const;
+
+        /** Get the number of threads currently waiting for a reservation of another thread to be completed. */
+        unsigned int getNumWaitingThreads() const;
+
+        /** Get the number of times a thread had to wait for another thread to access the cache since the previous call, and reset it. */
+        unsigned int takeNumContentions();
+
+        struct EvictionCandidate
+        {
+            ObjectCache* _cache;
+            std::string _fileName;
+            double _timeStamp;
+            size_t _size;
+
+            /** Least recently used first. */
+            bool operator<(const EvictionCandidate& other) const
+            {
+                return _timeStamp < other._timeStamp;
+            }
+        };
+
+        /** Append the entries that are not referenced outside of the cache and have a size to candidates. */
+        void getEvictionCandidates(std::vector<EvictionCandidate>& candidates);
+
+        /** Remove an entry if it is still not referenced outside of the cache.
+          * @return The estimated memory freed in bytes. */
+        size_t evict(const std::string& fileName);
+
     protected:
 
         virtual ~ObjectCache();
 
-        typedef std::pair<osg::ref_ptr<osg::Object>, double >           ObjectTimeStampPair;
-        typedef std::map<std::string, ObjectTimeStampPair >             ObjectCacheMap;
+        struct Entry
+        {
+            Entry() : _timeStamp(0.0), _size(0), _loading(false) {}
+            Entry(osg::Object* object, double timeStamp, size_t size) : _object(object), _timeStamp(timeStamp), _size(size), _loading(false) {}
+
+            osg::ref_ptr<osg::Object> _object;
+            double _timeStamp;
+            size_t _size;
+            /** Reserved by a thread that is loading the object. */
+            bool _loading;
+        };
+
+        typedef std::map<std::string, Entry >                           ObjectCacheMap;
 
-        ObjectCacheMap                          _objectCache;
-        mutable OpenThreads::Mutex              _objectCacheMutex;
+        struct Shard
+        {
+            Shard() : _memoryUsage(0), _numWaiting(0) {}
+
+            ObjectCacheMap                      _objectCache;
+            size_t                              _memoryUsage;
+            unsigned int                        _numWaiting;
+            OpenThreads::Mutex                  _mutex;
+            /** Signaled when a reservation is completed or canceled. */
+            OpenThreads::Condition              _condition;
+        };
+
+        /** Locks a shard, counting the times the lock is held by another thread. */
+        class ShardLock
+        {
+            public:
+                ShardLock(const ObjectCache& cache, Shard& shard) : _mutex(shard._mutex)
+                {
+                    if (_mutex.trylock() != 0)
+                    {
+                        ++cache._numContentions;
+                        _mutex.lock();
+                    }
+                }
+                ~ShardLock() { _mutex.unlock(); }
+
+            private:
+                OpenThreads::Mutex& _mutex;
+        };
+
+        Shard& getShard(const std::string& fileName);
+
+        static const unsigned int NumShards = 16;
+
+        mutable Shard                           _shards[NumShards];
+        mutable OpenThreads::Atomic             _numContentions;
 
 };
 
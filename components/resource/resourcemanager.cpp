@@ -38,6 +38,21 @@ namespace Resource
         return mVFS;
     }
 
+    size_t ResourceManager::getMemoryUsage() const
+    {
+        return mCache->getMemoryUsage();
+    }
+
+    void ResourceManager::getEvictionCandidates(std::vector<ObjectCache::EvictionCandidate> &candidates)
+    {
+        mCache->getEvictionCandidates(candidates);
+    }
+
+    unsigned int ResourceManager::takeNumCacheContentions()
+    {
+        return mCache->takeNumContentions();
+    }
+
     void ResourceManager::releaseGLObjects(osg::State *state)
     {
         mCache->releaseGLObjects(state);
@@ -3,6 +3,8 @@
 
 #include <osg/ref_ptr>
 
+#include "objectcache.hpp"
+
 namespace VFS
 {
     class Manager;
@@ -16,7 +18,6 @@ namespace osg
 
 namespace Resource
 {
-    class ObjectCache;
 
     /// @brief Base class for managers that require a virtual file system and object cache.
     /// @par This base class implements clearing of the cache, but populating it and what it's used for is up to the individual sub classes.
@@ -37,6 +38,15 @@ namespace Resource
 
         const VFS::Manager* getVFS() const;
 
+        /// Estimated memory used by the cached objects, in bytes.
+        size_t getMemoryUsage() const;
+
+        /// Append the cache entries that may be evicted to free memory.
+        void getEvictionCandidates(std::vector<ObjectCache::EvictionCandidate>& candidates);
+
+        /// Number of times a thread had to wait for another thread to access the cache since the previous call.
+        unsigned int takeNumCacheContentions();
+
         virtual void reportStats(unsigned int frameNumber, osg::Stats* stats) const {}
 
         virtual void releaseGLObjects(osg::State* state);
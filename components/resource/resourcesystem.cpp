@@ -6,12 +6,16 @@
 #include "imagemanager.hpp"
 #include "niffilemanager.hpp"
 #include "keyframemanager.hpp"
+#include "objectcache.hpp"
+
+#include <osg/Stats>
 
 namespace Resource
 {
 
     ResourceSystem::ResourceSystem(const VFS::Manager *vfs)
         : mVFS(vfs)
+        , mMemoryBudget(0)
     {
         mNifFileManager.reset(new NifFileManager(vfs));
         mKeyframeManager.reset(new KeyframeManager(vfs));
@@ -62,10 +66,43 @@ namespace Resource
         mNifFileManager->setExpiryDelay(0.0);
     }
 
+    void ResourceSystem::setMemoryBudget(size_t bytes)
+    {
+        mMemoryBudget = bytes;
+    }
+
+    size_t ResourceSystem::getMemoryUsage() const
+    {
+        size_t usage = 0;
+        for (std::vector<ResourceManager*>::const_iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
+            usage += (*it)->getMemoryUsage();
+        return usage;
+    }
+
     void ResourceSystem::updateCache(double referenceTime)
     {
         for (std::vector<ResourceManager*>::iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
             (*it)->updateCache(referenceTime);
+
+        if (mMemoryBudget == 0)
+            return;
+
+        size_t usage = getMemoryUsage();
+        if (usage <= mMemoryBudget)
+            return;
+
+        std::vector<ObjectCache::EvictionCandidate> candidates;
+        for (std::vector<ResourceManager*>::iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
+            (*it)->getEvictionCandidates(candidates);
+
+        // the time stamps of all caches are updated with the same reference time, so they can be compared across managers
+        std::sort(candidates.begin(), candidates.end());
+
+        for (std::vector<ObjectCache::EvictionCandidate>::const_iterator it = candidates.begin(); it != candidates.end() && usage > mMemoryBudget; ++it)
+        {
+            size_t freed = it->_cache->evict(it->_fileName);
+            usage -= std::min(usage, freed);
+        }
     }
 
     void ResourceSystem::clearCache()
@@ -93,8 +130,15 @@ namespace Resource
 
     void ResourceSystem::reportStats(unsigned int frameNumber, osg::Stats *stats) const
     {
+        unsigned int contentions = 0;
         for (std::vector<ResourceManager*>::const_iterator it = mResourceManagers.begin(); it != mResourceManagers.end(); ++it)
+        {
             (*it)->reportStats(frameNumber, stats);
+            contentions += (*it)->takeNumCacheContentions();
+        }
+
+        stats->setAttribute(frameNumber, "Cache Memory", getMemoryUsage() / (1024.0 * 1024.0));
+        stats->setAttribute(frameNumber, "Cache Contention", contentions);
     }
 
     void ResourceSystem::releaseGLObjects(osg::State *state)
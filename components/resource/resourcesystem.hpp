@@ -56,6 +56,13 @@ namespace Resource
         /// How long to keep objects in cache after no longer being referenced.
         void setExpiryDelay(double expiryDelay);
 
+        /// If the estimated memory used by all caches exceeds \a bytes, updateCache() evicts the least recently used
+        /// objects that are no longer referenced, regardless of the expiry delay. 0 means no limit.
+        void setMemoryBudget(size_t bytes);
+
+        /// Estimated memory used by the caches of all resource managers, in bytes.
+        size_t getMemoryUsage() const;
+
         /// @note May be called from any thread.
         const VFS::Manager* getVFS() const;
 
@@ -76,6 +83,8 @@ namespace Resource
 
         const VFS::Manager* mVFS;
 
+        size_t mMemoryBudget;
+
         ResourceSystem(const ResourceSystem&);
         void operator = (const ResourceSystem&);
     };
@@ -24,6 +24,7 @@
 #include <components/sceneutil/util.hpp>
 #include <components/sceneutil/controller.hpp>
 #include <components/sceneutil/optimizer.hpp>
+#include <components/sceneutil/visitor.hpp>
 
 #include <components/shader/shadervisitor.hpp>
 #include <components/shader/shadermanager.hpp>
@@ -32,6 +33,7 @@
 #include "niffilemanager.hpp"
 #include "objectcache.hpp"
 #include "multiobjectcache.hpp"
+#include "templatecache.hpp"
 
 namespace
 {
@@ -312,6 +314,11 @@ namespace Resource
         mShaderManager->setShaderPath(path);
     }
 
+    void SceneManager::setTemplateCachePath(const std::string &path)
+    {
+        mTemplateCache.reset(new TemplateCache(path));
+    }
+
     bool SceneManager::checkLoaded(const std::string &name, double timeStamp)
     {
         std::string normalized = name;
@@ -478,78 +485,134 @@ namespace Resource
         std::string normalized = name;
         mVFS->normalizeFilename(normalized);
 
-        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(normalized);
-        if (obj)
+        // if another thread is already loading this file, wait for its result rather than loading and optimizing the file again
+        bool reserved = false;
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCacheOrReserve(normalized, reserved);
+        if (!reserved)
             return osg::ref_ptr<const osg::Node>(static_cast<osg::Node*>(obj.get()));
         else
         {
             osg::ref_ptr<osg::Node> loaded;
             try
             {
-                Files::IStreamPtr file = mVFS->get(normalized);
-
-                loaded = load(file, normalized, mImageManager, mNifFileManager);
+                loaded = loadTemplate(normalized);
             }
-            catch (std::exception& e)
+            catch (...)
             {
-                static const char * const sMeshTypes[] = { "nif", "osg", "osgt", "osgb", "osgx", "osg2" };
+                mCache->cancelReservation(normalized);
+                throw;
+            }
 
-                for (unsigned int i=0; i<sizeof(sMeshTypes)/sizeof(sMeshTypes[0]); ++i)
-                {
-                    normalized = "meshes/marker_error." + std::string(sMeshTypes[i]);
-                    if (mVFS->exists(normalized))
-                    {
-                        std::cerr << "Failed to load '" << name << "': " << e.what() << ", using marker_error." << sMeshTypes[i] << " instead" << std::endl;
-                        Files::IStreamPtr file = mVFS->get(normalized);
-                        loaded = load(file, normalized, mImageManager, mNifFileManager);
-                        break;
-                    }
-                }
+            SceneUtil::MemoryUsageVisitor memoryUsageVisitor;
+            loaded->accept(memoryUsageVisitor);
 
-                if (!loaded)
-                    throw;
-            }
+            mCache->addEntryToObjectCache(normalized, loaded, 0.0, memoryUsageVisitor.mSize);
+            return loaded;
+        }
+    }
 
-            // set filtering settings
-            SetFilterSettingsVisitor setFilterSettingsVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
-            loaded->accept(setFilterSettingsVisitor);
-            SetFilterSettingsControllerVisitor setFilterSettingsControllerVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
-            loaded->accept(setFilterSettingsControllerVisitor);
-
-            Shader::ShaderVisitor shaderVisitor(*mShaderManager.get(), *mImageManager, "objects_vertex.glsl", "objects_fragment.glsl");
-            shaderVisitor.setForceShaders(mForceShaders);
-            shaderVisitor.setClampLighting(mClampLighting);
-            shaderVisitor.setForcePerPixelLighting(mForcePerPixelLighting);
-            shaderVisitor.setAutoUseNormalMaps(mAutoUseNormalMaps);
-            shaderVisitor.setNormalMapPattern(mNormalMapPattern);
-            shaderVisitor.setNormalHeightMapPattern(mNormalHeightMapPattern);
-            shaderVisitor.setAutoUseSpecularMaps(mAutoUseSpecularMaps);
-            shaderVisitor.setSpecularMapPattern(mSpecularMapPattern);
-            loaded->accept(shaderVisitor);
-
-            // share state
-            // do this before optimizing so the optimizer will be able to combine nodes more aggressively
-            // note, because StateSets will be shared at this point, StateSets can not be modified inside the optimizer
-            mSharedStateMutex.lock();
-            mSharedStateManager->share(loaded.get());
-            mSharedStateMutex.unlock();
-
-            if (canOptimize(normalized))
+    std::string SceneManager::getTemplateFingerprint() const
+    {
+        std::ostringstream stream;
+        stream << mForceShaders << mClampLighting << mForcePerPixelLighting << mAutoUseNormalMaps << mAutoUseSpecularMaps
+               << ' ' << mNormalMapPattern << ' ' << mNormalHeightMapPattern << ' ' << mSpecularMapPattern
+               << ' ' << mMinFilter << ' ' << mMagFilter << ' ' << mMaxAnisotropy << ' ' << getOptimizationOptions();
+        return stream.str();
+    }
+
+    osg::ref_ptr<osg::Node> SceneManager::loadTemplate(const std::string &normalized)
+    {
+        std::string fingerprint;
+        if (mTemplateCache && mVFS->exists(normalized))
+        {
+            fingerprint = getTemplateFingerprint();
+
+            osg::ref_ptr<osgDB::Options> options (new osgDB::Options);
+            options->setReadFileCallback(new ImageReadCallback(mImageManager));
+            osg::ref_ptr<osg::Node> cached = mTemplateCache->read(normalized, fingerprint, *mVFS->getNormalized(normalized), options);
+            if (cached)
             {
-                SceneUtil::Optimizer optimizer;
-                optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
+                mSharedStateMutex.lock();
+                mSharedStateManager->share(cached.get());
+                mSharedStateMutex.unlock();
 
-                static const unsigned int options = getOptimizationOptions();
+                if (mIncrementalCompileOperation)
+                    mIncrementalCompileOperation->add(cached);
 
-                optimizer.optimize(loaded, options);
+                return cached;
             }
+        }
 
-            if (mIncrementalCompileOperation)
-                mIncrementalCompileOperation->add(loaded);
+        osg::ref_ptr<osg::Node> loaded;
+        bool usedMarker = false;
+        try
+        {
+            Files::IStreamPtr file = mVFS->get(normalized);
 
-            mCache->addEntryToObjectCache(normalized, loaded);
-            return loaded;
+            loaded = load(file, normalized, mImageManager, mNifFileManager);
+        }
+        catch (std::exception& e)
+        {
+            static const char * const sMeshTypes[] = { "nif", "osg", "osgt", "osgb", "osgx", "osg2" };
+
+            for (unsigned int i=0; i<sizeof(sMeshTypes)/sizeof(sMeshTypes[0]); ++i)
+            {
+                std::string marker = "meshes/marker_error." + std::string(sMeshTypes[i]);
+                if (mVFS->exists(marker))
+                {
+                    std::cerr << "Failed to load '" << normalized << "': " << e.what() << ", using marker_error." << sMeshTypes[i] << " instead" << std::endl;
+                    Files::IStreamPtr file = mVFS->get(marker);
+                    loaded = load(file, marker, mImageManager, mNifFileManager);
+                    usedMarker = true;
+                    break;
+                }
+            }
+
+            if (!loaded)
+                throw;
         }
+
+        // set filtering settings
+        SetFilterSettingsVisitor setFilterSettingsVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
+        loaded->accept(setFilterSettingsVisitor);
+        SetFilterSettingsControllerVisitor setFilterSettingsControllerVisitor(mMinFilter, mMagFilter, mMaxAnisotropy);
+        loaded->accept(setFilterSettingsControllerVisitor);
+
+        Shader::ShaderVisitor shaderVisitor(*mShaderManager.get(), *mImageManager, "objects_vertex.glsl", "objects_fragment.glsl");
+        shaderVisitor.setForceShaders(mForceShaders);
+        shaderVisitor.setClampLighting(mClampLighting);
+        shaderVisitor.setForcePerPixelLighting(mForcePerPixelLighting);
+        shaderVisitor.setAutoUseNormalMaps(mAutoUseNormalMaps);
+        shaderVisitor.setNormalMapPattern(mNormalMapPattern);
+        shaderVisitor.setNormalHeightMapPattern(mNormalHeightMapPattern);
+        shaderVisitor.setAutoUseSpecularMaps(mAutoUseSpecularMaps);
+        shaderVisitor.setSpecularMapPattern(mSpecularMapPattern);
+        loaded->accept(shaderVisitor);
+
+        // share state
+        // do this before optimizing so the optimizer will be able to combine nodes more aggressively
+        // note, because StateSets will be shared at this point, StateSets can not be modified inside the optimizer
+        mSharedStateMutex.lock();
+        mSharedStateManager->share(loaded.get());
+        mSharedStateMutex.unlock();
+
+        if (canOptimize(normalized))
+        {
+            SceneUtil::Optimizer optimizer;
+            optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
+
+            static const unsigned int options = getOptimizationOptions();
+
+            optimizer.optimize(loaded, options);
+        }
+
+        if (mTemplateCache && !usedMarker && !fingerprint.empty())
+            mTemplateCache->write(normalized, fingerprint, *mVFS->getNormalized(normalized), loaded);
+
+        if (mIncrementalCompileOperation)
+            mIncrementalCompileOperation->add(loaded);
+
+        return loaded;
     }
 
     osg::ref_ptr<osg::Node> SceneManager::cacheInstance(const std::string &name)
@@ -16,6 +16,7 @@ namespace Resource
     class ImageManager;
     class NifFileManager;
     class SharedStateManager;
+    class TemplateCache;
 }
 
 namespace osgUtil
@@ -78,13 +79,17 @@ namespace Resource
 
         void setShaderPath(const std::string& path);
 
+        /// Store prepared templates in the given directory, and load them from there in later sessions.
+        /// @see TemplateCache
+        void setTemplateCachePath(const std::string& path);
+
         /// Check if a given scene is loaded and if so, update its usage timestamp to prevent it from being unloaded
         bool checkLoaded(const std::string& name, double referenceTime);
 
         /// Get a read-only copy of this scene "template"
         /// @note If the given filename does not exist or fails to load, an error marker mesh will be used instead.
         ///  If even the error marker mesh can not be found, an exception is thrown.
-        /// @note Thread safe.
+        /// @note Thread safe. Threads requesting a file that is being loaded by another thread wait for that thread's result.
         osg::ref_ptr<const osg::Node> getTemplate(const std::string& name);
 
         /// Create an instance of the given scene template and cache it for later use, so that future calls to getInstance() can simply
@@ -149,7 +154,14 @@ namespace Resource
 
     private:
 
+        /// Load the given file and prepare it for rendering, or the error marker mesh if that fails.
+        osg::ref_ptr<osg::Node> loadTemplate(const std::string& normalized);
+
+        /// Describes the settings that affect the prepared templates.
+        std::string getTemplateFingerprint() const;
+
         std::unique_ptr<Shader::ShaderManager> mShaderManager;
+        std::unique_ptr<TemplateCache> mTemplateCache;
         bool mForceShaders;
         bool mClampLighting;
         bool mForcePerPixelLighting;
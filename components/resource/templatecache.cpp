@@ -0,0 +1,439 @@
+#include "templatecache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <iomanip>
+
+#include <osg/Drawable>
+#include <osg/Program>
+#include <osg/Texture>
+#include <osg/UserDataContainer>
+
+#include <osgDB/ObjectWrapper>
+#include <osgDB/Registry>
+#include <osgDB/Serializer>
+#include <osgDB/InputStream>
+#include <osgDB/OutputStream>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <components/nifosg/userdata.hpp>
+
+namespace
+{
+
+    /// Increment when the format or the preparation of templates changes, so that existing entries are not used.
+    const uint32_t sVersion = 1;
+
+    const char sMagic[4] = { 'O', 'M', 'W', 'T' };
+
+    uint64_t hashData(const char* data, size_t size, uint64_t hash)
+    {
+        // FNV-1a
+        for (size_t i=0; i<size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    const uint64_t sHashSeed = 14695981039346656037ull;
+
+    void writeString(std::ostream& stream, const std::string& str)
+    {
+        uint32_t size = str.size();
+        stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        stream.write(str.data(), size);
+    }
+
+    bool readString(std::istream& stream, std::string& str)
+    {
+        uint32_t size = 0;
+        stream.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!stream.good() || size > 65536)
+            return false;
+        str.resize(size);
+        if (size > 0)
+            stream.read(&str[0], size);
+        return stream.good();
+    }
+
+    osg::Object* createNodeUserData() { return new NifOsg::NodeUserData; }
+
+    bool checkNodeUserData(const NifOsg::NodeUserData&)
+    {
+        return true;
+    }
+
+    bool readNodeUserData(osgDB::InputStream& is, NifOsg::NodeUserData& data)
+    {
+        is >> data.mIndex >> data.mScale;
+        for (int i=0; i<3; ++i)
+            for (int j=0; j<3; ++j)
+                is >> data.mRotationScale.mValues[i][j];
+        return true;
+    }
+
+    bool writeNodeUserData(osgDB::OutputStream& os, const NifOsg::NodeUserData& data)
+    {
+        os << data.mIndex << data.mScale;
+        for (int i=0; i<3; ++i)
+            for (int j=0; j<3; ++j)
+                os << data.mRotationScale.mValues[i][j];
+        os << std::endl;
+        return true;
+    }
+
+    /// The NIF loader attaches NodeUserData to every node, so templates made from NIF files can only be stored with it.
+    class NodeUserDataSerializer : public osgDB::ObjectWrapper
+    {
+    public:
+        NodeUserDataSerializer()
+            : osgDB::ObjectWrapper(createNodeUserData, "NifOsg::NodeUserData", "osg::Object NifOsg::NodeUserData")
+        {
+            addSerializer(new osgDB::UserSerializer<NifOsg::NodeUserData>("Data", checkNodeUserData, readNodeUserData, writeNodeUserData),
+                          osgDB::BaseSerializer::RW_USER);
+        }
+    };
+
+    /// Check that no other serializers replaced the ones the stored templates rely on.
+    bool hasSerializers()
+    {
+        osgDB::ObjectWrapperManager* manager = osgDB::Registry::instance()->getObjectWrapperManager();
+
+        // SceneUtil::registerSerializers() replaces some serializers to write smaller scene dumps, which would lose the geometry and user data
+        osgDB::ObjectWrapper* geometryWrapper = manager->findWrapper("osg::Geometry");
+        if (!geometryWrapper || !geometryWrapper->getSerializer("VertexArray"))
+            return false;
+        osgDB::ObjectWrapper* userDataWrapper = manager->findWrapper("NifOsg::NodeUserData");
+        return userDataWrapper && userDataWrapper->getSerializer("Data");
+    }
+
+    /// Checks that a scene graph consists only of objects that the OSG serializers can store without loss.
+    class CanStoreVisitor : public osg::NodeVisitor
+    {
+    public:
+        CanStoreVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mCanStore(true)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (!isPlain(node) || node.getUpdateCallback() || node.getEventCallback() || node.getCullCallback()
+                    || node.getComputeBoundingSphereCallback())
+                mCanStore = false;
+            else
+            {
+                checkStateSet(node.getStateSet());
+                traverse(node);
+            }
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            if (!isPlain(drawable) || drawable.getUpdateCallback() || drawable.getEventCallback() || drawable.getCullCallback()
+                    || drawable.getDrawCallback() || drawable.getComputeBoundingBoxCallback())
+                mCanStore = false;
+            else
+                checkStateSet(drawable.getStateSet());
+        }
+
+        bool isPlain(const osg::Object& object) const
+        {
+            return std::strcmp(object.libraryName(), "osg") == 0 && canStoreUserData(object.getUserDataContainer());
+        }
+
+        bool canStoreUserData(const osg::UserDataContainer* container) const
+        {
+            if (!container)
+                return true;
+            if (std::strcmp(container->libraryName(), "osg") != 0 || container->getUserData())
+                return false;
+            for (unsigned int i=0; i<container->getNumUserObjects(); ++i)
+            {
+                const osg::Object* object = container->getUserObject(i);
+                if (!dynamic_cast<const NifOsg::NodeUserData*>(object) && std::strcmp(object->libraryName(), "osg") != 0)
+                    return false;
+            }
+            return true;
+        }
+
+        void checkStateSet(const osg::StateSet* stateset)
+        {
+            if (!stateset)
+                return;
+            if (!isPlain(*stateset) || stateset->getUpdateCallback() || stateset->getEventCallback())
+            {
+                mCanStore = false;
+                return;
+            }
+
+            checkAttributes(stateset->getAttributeList());
+            const osg::StateSet::TextureAttributeList& texAttributes = stateset->getTextureAttributeList();
+            for (unsigned int unit=0; unit<texAttributes.size(); ++unit)
+                checkAttributes(texAttributes[unit]);
+
+            const osg::StateSet::UniformList& uniforms = stateset->getUniformList();
+            for (osg::StateSet::UniformList::const_iterator it = uniforms.begin(); it != uniforms.end(); ++it)
+            {
+                const osg::Uniform* uniform = it->second.first.get();
+                if (!isPlain(*uniform) || uniform->getUpdateCallback() || uniform->getEventCallback())
+                    mCanStore = false;
+            }
+        }
+
+        void checkAttributes(const osg::StateSet::AttributeList& attributes)
+        {
+            for (osg::StateSet::AttributeList::const_iterator it = attributes.begin(); it != attributes.end(); ++it)
+            {
+                const osg::StateAttribute* attr = it->second.first.get();
+                if (!isPlain(*attr) || attr->getUpdateCallback() || attr->getEventCallback())
+                {
+                    mCanStore = false;
+                    continue;
+                }
+
+                // images are stored as file references, so they must have been read from a file
+                if (const osg::Texture* texture = attr->asTexture())
+                {
+                    if (texture->getNumImages() == 0)
+                        mCanStore = false;
+                    for (unsigned int i=0; i<texture->getNumImages(); ++i)
+                    {
+                        const osg::Image* image = texture->getImage(i);
+                        if (!image || image->getFileName().empty())
+                            mCanStore = false;
+                    }
+                }
+            }
+        }
+
+        bool mCanStore;
+    };
+
+    class CollectStateSetsVisitor : public osg::NodeVisitor
+    {
+    public:
+        CollectStateSetsVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            if (node.getStateSet())
+                mStateSets.insert(node.getStateSet());
+            traverse(node);
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            if (drawable.getStateSet())
+                mStateSets.insert(drawable.getStateSet());
+        }
+
+        std::set<osg::StateSet*> mStateSets;
+    };
+
+    std::string getProgramKey(const osg::Program& program)
+    {
+        std::ostringstream key;
+        for (unsigned int i=0; i<program.getNumShaders(); ++i)
+        {
+            const osg::Shader* shader = program.getShader(i);
+            key << shader->getType() << '\n' << shader->getShaderSource() << '\0';
+        }
+        const osg::Program::AttribBindingList& bindings = program.getAttribBindingList();
+        for (osg::Program::AttribBindingList::const_iterator it = bindings.begin(); it != bindings.end(); ++it)
+            key << it->first << ' ' << it->second << '\n';
+        return key.str();
+    }
+
+}
+
+namespace Resource
+{
+
+    TemplateCache::TemplateCache(const std::string &path)
+        : mPath(path)
+        , mProgramLimit(64)
+    {
+        static bool registered = false;
+        if (!registered)
+        {
+            osgDB::Registry::instance()->getObjectWrapperManager()->addWrapper(new NodeUserDataSerializer);
+            registered = true;
+        }
+
+        try
+        {
+            boost::filesystem::create_directories(mPath);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Failed to create template cache directory: " << e.what() << std::endl;
+        }
+    }
+
+    std::string TemplateCache::getFileName(const std::string &normalizedName) const
+    {
+        std::ostringstream stream;
+        stream << std::hex << std::setw(16) << std::setfill('0') << hashData(normalizedName.data(), normalizedName.size(), sHashSeed) << ".osgb";
+        return (boost::filesystem::path(mPath) / stream.str()).string();
+    }
+
+    uint64_t TemplateCache::getChecksum(std::istream &stream)
+    {
+        uint64_t hash = sHashSeed;
+        char buffer[65536];
+        while (stream.good())
+        {
+            stream.read(buffer, sizeof(buffer));
+            hash = hashData(buffer, stream.gcount(), hash);
+        }
+        return hash;
+    }
+
+    osg::ref_ptr<osg::Node> TemplateCache::read(const std::string &normalizedName, const std::string &fingerprint, std::istream &source, const osgDB::Options *options)
+    {
+        if (!hasSerializers())
+            return NULL;
+
+        osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+        if (!reader)
+            return NULL;
+
+        boost::filesystem::ifstream stream (getFileName(normalizedName), std::ios::binary);
+        if (!stream.is_open())
+            return NULL;
+
+        char magic[sizeof(sMagic)];
+        uint32_t version = 0;
+        stream.read(magic, sizeof(magic));
+        stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (!stream.good() || std::memcmp(magic, sMagic, sizeof(magic)) != 0 || version != sVersion)
+            return NULL;
+
+        std::string storedName;
+        uint64_t storedChecksum = 0;
+        std::string storedFingerprint;
+        if (!readString(stream, storedName))
+            return NULL;
+        stream.read(reinterpret_cast<char*>(&storedChecksum), sizeof(storedChecksum));
+        if (!readString(stream, storedFingerprint))
+            return NULL;
+
+        // a different file with the same hash or different settings
+        if (storedName != normalizedName || storedFingerprint != fingerprint)
+            return NULL;
+
+        // an outdated entry
+        if (storedChecksum != getChecksum(source))
+            return NULL;
+
+        osgDB::ReaderWriter::ReadResult result = reader->readNode(stream, options);
+        if (!result.success() || !result.getNode())
+        {
+            std::cerr << "Failed to read cached template for '" << normalizedName << "': " << result.message() << std::endl;
+            return NULL;
+        }
+
+        osg::ref_ptr<osg::Node> node = result.getNode();
+        sharePrograms(node);
+        return node;
+    }
+
+    void TemplateCache::write(const std::string &normalizedName, const std::string &fingerprint, std::istream &source, osg::Node *node)
+    {
+        CanStoreVisitor canStoreVisitor;
+        node->accept(canStoreVisitor);
+        if (!canStoreVisitor.mCanStore || !hasSerializers())
+            return;
+
+        osgDB::ReaderWriter* writer = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+        if (!writer)
+            return;
+
+        const uint64_t checksum = getChecksum(source);
+
+        const std::string fileName = getFileName(normalizedName);
+        // write to a temporary file first, so that a partially written file is never read
+        const std::string tempFileName = fileName + ".tmp";
+        try
+        {
+            {
+                boost::filesystem::ofstream stream (tempFileName, std::ios::binary);
+                if (!stream.is_open())
+                    return;
+
+                stream.write(sMagic, sizeof(sMagic));
+                stream.write(reinterpret_cast<const char*>(&sVersion), sizeof(sVersion));
+                writeString(stream, normalizedName);
+                stream.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+                writeString(stream, fingerprint);
+
+                osg::ref_ptr<osgDB::Options> options (new osgDB::Options("WriteImageHint=UseExternal"));
+                osgDB::ReaderWriter::WriteResult result = writer->writeNode(*node, stream, options);
+                if (!result.success() || !stream.good())
+                {
+                    std::cerr << "Failed to write cached template for '" << normalizedName << "': " << result.message() << std::endl;
+                    stream.close();
+                    boost::filesystem::remove(tempFileName);
+                    return;
+                }
+            }
+            boost::filesystem::rename(tempFileName, fileName);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Failed to write cached template for '" << normalizedName << "': " << e.what() << std::endl;
+        }
+    }
+
+    void TemplateCache::sharePrograms(osg::Node *node)
+    {
+        CollectStateSetsVisitor visitor;
+        node->accept(visitor);
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mProgramMutex);
+        if (mPrograms.size() >= mProgramLimit)
+            removeUnusedPrograms();
+
+        for (std::set<osg::StateSet*>::const_iterator it = visitor.mStateSets.begin(); it != visitor.mStateSets.end(); ++it)
+        {
+            osg::StateSet::RefAttributePair* pair = (*it)->getAttributePair(osg::StateAttribute::PROGRAM);
+            if (!pair)
+                continue;
+
+            osg::ref_ptr<osg::Program> program = static_cast<osg::Program*>(pair->first.get());
+            osg::StateAttribute::OverrideValue value = pair->second;
+
+            osg::ref_ptr<osg::Program>& shared = mPrograms[getProgramKey(*program)];
+            if (!shared)
+                shared = program;
+            else if (shared != program)
+                (*it)->setAttribute(shared, value);
+        }
+    }
+
+    void TemplateCache::removeUnusedPrograms()
+    {
+        for (ProgramMap::iterator it = mPrograms.begin(); it != mPrograms.end();)
+        {
+            // only referenced by the map
+            if (it->second->referenceCount() <= 1)
+                mPrograms.erase(it++);
+            else
+                ++it;
+        }
+        mProgramLimit = std::max(mProgramLimit, mPrograms.size() * 2);
+    }
+
+}
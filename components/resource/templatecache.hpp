@@ -0,0 +1,72 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_TEMPLATECACHE_H
+#define OPENMW_COMPONENTS_RESOURCE_TEMPLATECACHE_H
+
+#include <map>
+#include <string>
+#include <istream>
+#include <cstdint>
+
+#include <osg/ref_ptr>
+
+#include <OpenThreads/Mutex>
+
+namespace osg
+{
+    class Node;
+    class Program;
+}
+
+namespace osgDB
+{
+    class Options;
+}
+
+namespace Resource
+{
+
+    /// @brief Stores prepared scene templates on disk in the OSG binary format, so that later sessions can skip parsing, optimizing
+    /// and setting up shaders for their source files.
+    /// @par Entries are identified by the file name, a checksum of the source file and a fingerprint of the settings that affect
+    /// the template. Only templates that consist of plain OSG objects and NifOsg::NodeUserData are stored, as OpenMW's other node,
+    /// drawable and callback classes (e.g. controllers, skinned geometry and particle systems) have no serializers.
+    /// @par Images are stored as references to their files, to be read through the ImageManager again.
+    /// @note Thread safe.
+    class TemplateCache
+    {
+    public:
+        /// @param path The directory to store the templates in. Will be created if it does not exist.
+        TemplateCache(const std::string& path);
+
+        /// @return The template stored for the given source file and settings, or NULL if there is none.
+        /// @param source The source file, only read if there is an entry to check its checksum against.
+        /// @param options Used for reading the images that the template references.
+        osg::ref_ptr<osg::Node> read(const std::string& normalizedName, const std::string& fingerprint, std::istream& source, const osgDB::Options* options);
+
+        /// Store the template, if it can be serialized without loss.
+        /// @param source The source file, only read if the template can be stored.
+        void write(const std::string& normalizedName, const std::string& fingerprint, std::istream& source, osg::Node* node);
+
+        /// Checksum of the data remaining in the stream.
+        static uint64_t getChecksum(std::istream& stream);
+
+    private:
+        std::string getFileName(const std::string& normalizedName) const;
+
+        /// Use the same program for all templates with the same shader sources, so that each program is only compiled once.
+        void sharePrograms(osg::Node* node);
+
+        /// Forget the programs that no template uses anymore.
+        void removeUnusedPrograms();
+
+        std::string mPath;
+
+        OpenThreads::Mutex mProgramMutex;
+        typedef std::map<std::string, osg::ref_ptr<osg::Program> > ProgramMap;
+        ProgramMap mPrograms;
+        /// The number of programs at which to look for unused ones again.
+        size_t mProgramLimit;
+    };
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "boundinghierarchy.hpp"
+
+#include <algorithm>
+
+#include <osg/BoundingBox>
+
+namespace
+{
+
+    typedef std::vector<std::pair<osg::ref_ptr<osg::Node>, osg::Vec3f> > NodeCenterList;
+
+    struct CompareCenter
+    {
+        CompareCenter(int axis) : mAxis(axis) {}
+
+        bool operator()(const NodeCenterList::value_type& left, const NodeCenterList::value_type& right) const
+        {
+            return left.second[mAxis] < right.second[mAxis];
+        }
+
+        int mAxis;
+    };
+
+    void buildHierarchy(NodeCenterList::iterator begin, NodeCenterList::iterator end, osg::Group* parent, unsigned int maxNodesPerLeaf)
+    {
+        if (static_cast<unsigned int>(end - begin) <= maxNodesPerLeaf)
+        {
+            osg::ref_ptr<osg::Group> leaf (new osg::Group);
+            for (NodeCenterList::iterator it = begin; it != end; ++it)
+                leaf->addChild(it->first);
+            parent->addChild(leaf);
+            return;
+        }
+
+        osg::BoundingBox box;
+        for (NodeCenterList::iterator it = begin; it != end; ++it)
+            box.expandBy(it->second);
+
+        osg::Vec3f extents = box._max - box._min;
+        int axis = 0;
+        if (extents.y() > extents[axis])
+            axis = 1;
+        if (extents.z() > extents[axis])
+            axis = 2;
+
+        NodeCenterList::iterator middle = begin + (end - begin) / 2;
+        std::nth_element(begin, middle, end, CompareCenter(axis));
+
+        osg::ref_ptr<osg::Group> group (new osg::Group);
+        buildHierarchy(begin, middle, group, maxNodesPerLeaf);
+        buildHierarchy(middle, end, group, maxNodesPerLeaf);
+        parent->addChild(group);
+    }
+
+}
+
+namespace SceneUtil
+{
+
+    void buildBoundingVolumeHierarchy(const std::vector<osg::ref_ptr<osg::Node> >& nodes, osg::Group* parent, unsigned int maxNodesPerLeaf)
+    {
+        NodeCenterList centers;
+        centers.reserve(nodes.size());
+        for (std::vector<osg::ref_ptr<osg::Node> >::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+            centers.push_back(std::make_pair(*it, osg::Vec3f((*it)->getBound().center())));
+
+        buildHierarchy(centers.begin(), centers.end(), parent, std::max(1u, maxNodesPerLeaf));
+    }
+
+}
@@ -0,0 +1,18 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_BOUNDINGHIERARCHY_H
+#define OPENMW_COMPONENTS_SCENEUTIL_BOUNDINGHIERARCHY_H
+
+#include <vector>
+
+#include <osg/Group>
+
+namespace SceneUtil
+{
+
+    /// Add the nodes to \a parent as a binary tree of groups, splitting them at the median of the longest axis
+    /// of their bounding sphere centers, so that the cull traversal can skip whole regions at once.
+    /// @param maxNodesPerLeaf Maximum number of nodes in a leaf group of the tree.
+    void buildBoundingVolumeHierarchy(const std::vector<osg::ref_ptr<osg::Node> >& nodes, osg::Group* parent, unsigned int maxNodesPerLeaf);
+
+}
+
+#endif
@@ -22,6 +22,11 @@ namespace SceneUtil
         return mSource.get() != NULL;
     }
 
+    bool Controller::isInputFrozen() const
+    {
+        return mSource && mSource->isFrozen();
+    }
+
     float Controller::getInputValue(osg::NodeVisitor* nv)
     {
         if (mFunction)
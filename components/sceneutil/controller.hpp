@@ -12,6 +12,10 @@ namespace SceneUtil
     public:
         virtual ~ControllerSource() { }
         virtual float getValue(osg::NodeVisitor* nv) = 0;
+
+        /// @return If the value is not going to change until the source is unfrozen,
+        /// so that controllers may keep their target as it is instead of updating it.
+        virtual bool isFrozen() const { return false; }
     };
 
     class FrameTimeSource : public ControllerSource
@@ -40,6 +44,9 @@ namespace SceneUtil
 
         bool hasInput() const;
 
+        /// @see ControllerSource::isFrozen
+        bool isInputFrozen() const;
+
         float getInputValue(osg::NodeVisitor* nv);
 
         void setSource(std::shared_ptr<ControllerSource> source);
@@ -1,5 +1,9 @@
 #include "lightmanager.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include <osg/Stats>
 #include <osgUtil/CullVisitor>
 
 #include <components/sceneutil/util.hpp>
@@ -161,7 +165,12 @@ namespace SceneUtil
     };
 
     LightManager::LightManager()
-        : mStartLight(0)
+        : mLightsTested(0)
+        , mNumLightsTested(0)
+        , mNumLights(0)
+        , mLightChangesValid(false)
+        , mLightRevision(1)
+        , mStartLight(0)
         , mLightingMask(~0u)
     {
         setUpdateCallback(new LightManagerUpdateCallback);
@@ -169,6 +178,11 @@ namespace SceneUtil
 
     LightManager::LightManager(const LightManager &copy, const osg::CopyOp &copyop)
         : osg::Group(copy, copyop)
+        , mLightsTested(0)
+        , mNumLightsTested(0)
+        , mNumLights(0)
+        , mLightChangesValid(false)
+        , mLightRevision(1)
         , mStartLight(copy.mStartLight)
         , mLightingMask(copy.mLightingMask)
     {
@@ -187,8 +201,13 @@ namespace SceneUtil
 
     void LightManager::update()
     {
+        mNumLights = mLights.size();
+        mNumLightsTested = mLightsTested;
+        mLightsTested = 0;
+
         mLights.clear();
         mLightsInViewSpace.clear();
+        mLightChangesValid = false;
 
         // do an occasional cleanup for orphaned lights
         for (int i=0; i<2; ++i)
@@ -265,13 +284,23 @@ namespace SceneUtil
     }
 
     const std::vector<LightManager::LightSourceViewBound>& LightManager::getLightsInViewSpace(osg::Camera *camera, const osg::RefMatrix* viewMatrix)
+    {
+        return getViewLights(camera, viewMatrix).mLights;
+    }
+
+    void LightManager::getLightsIntersecting(osg::Camera *camera, const osg::RefMatrix *viewMatrix, const osg::BoundingSphere &viewBound, LightList &lightList)
+    {
+        mLightsTested += getViewLights(camera, viewMatrix).mGrid.query(viewBound, lightList);
+    }
+
+    LightManager::ViewLights& LightManager::getViewLights(osg::Camera *camera, const osg::RefMatrix *viewMatrix)
     {
         osg::observer_ptr<osg::Camera> camPtr (camera);
-        std::map<osg::observer_ptr<osg::Camera>, LightSourceViewBoundCollection>::iterator it = mLightsInViewSpace.find(camPtr);
+        std::map<osg::observer_ptr<osg::Camera>, ViewLights>::iterator it = mLightsInViewSpace.find(camPtr);
 
         if (it == mLightsInViewSpace.end())
         {
-            it = mLightsInViewSpace.insert(std::make_pair(camPtr, LightSourceViewBoundCollection())).first;
+            it = mLightsInViewSpace.insert(std::make_pair(camPtr, ViewLights())).first;
 
             for (std::vector<LightSourceTransform>::iterator lightIt = mLights.begin(); lightIt != mLights.end(); ++lightIt)
             {
@@ -282,12 +311,265 @@ namespace SceneUtil
                 LightSourceViewBound l;
                 l.mLightSource = lightIt->mLightSource;
                 l.mViewBound = viewBound;
-                it->second.push_back(l);
+                it->second.mLights.push_back(l);
             }
+
+            // built in place, the grid refers to the light collection
+            it->second.mGrid.build(it->second.mLights);
         }
         return it->second;
     }
 
+    void LightManager::updateLightChanges()
+    {
+        mPreviousLightIds.swap(mLightIds);
+        mLightIds.clear();
+        for (unsigned int i=0; i<mLights.size(); ++i)
+        {
+            LightId light;
+            light.mId = mLights[i].mLightSource->getId();
+            light.mIndex = i;
+            light.mWorldBound = osg::BoundingSphere(mLights[i].mWorldMatrix.getTrans(), mLights[i].mLightSource->getRadius());
+            mLightIds.push_back(light);
+        }
+        std::sort(mLightIds.begin(), mLightIds.end());
+
+        mChangedLightBounds.clear();
+        std::vector<LightId>::const_iterator current = mLightIds.begin();
+        std::vector<LightId>::const_iterator previous = mPreviousLightIds.begin();
+        while (current != mLightIds.end() || previous != mPreviousLightIds.end())
+        {
+            if (previous == mPreviousLightIds.end() || (current != mLightIds.end() && current->mId < previous->mId))
+            {
+                // added
+                mChangedLightBounds.push_back(current->mWorldBound);
+                ++current;
+            }
+            else if (current == mLightIds.end() || previous->mId < current->mId)
+            {
+                // removed
+                mChangedLightBounds.push_back(previous->mWorldBound);
+                ++previous;
+            }
+            else
+            {
+                if (current->mWorldBound != previous->mWorldBound)
+                {
+                    mChangedLightBounds.push_back(previous->mWorldBound);
+                    mChangedLightBounds.push_back(current->mWorldBound);
+                }
+                ++current;
+                ++previous;
+            }
+        }
+
+        ++mLightRevision;
+        mLightChangesValid = true;
+    }
+
+    bool LightManager::getCachedLightList(CachedLightList &cache, const osg::BoundingSphere &worldBound, osg::Camera *camera,
+                                          const osg::RefMatrix *viewMatrix, LightList &lightList)
+    {
+        if (!mLightChangesValid)
+            updateLightChanges();
+
+        if (cache.mWorldBound != worldBound)
+            return false;
+
+        if (cache.mRevision + 1 == mLightRevision)
+        {
+            for (std::vector<osg::BoundingSphere>::const_iterator it = mChangedLightBounds.begin(); it != mChangedLightBounds.end(); ++it)
+            {
+                if (it->intersects(worldBound))
+                    return false;
+            }
+        }
+        else if (cache.mRevision != mLightRevision)
+            return false;
+
+        const ViewLights& viewLights = getViewLights(camera, viewMatrix);
+        size_t numLights = lightList.size();
+        for (std::vector<int>::const_iterator it = cache.mLightIds.begin(); it != cache.mLightIds.end(); ++it)
+        {
+            LightId key;
+            key.mId = *it;
+            std::vector<LightId>::const_iterator found = std::lower_bound(mLightIds.begin(), mLightIds.end(), key);
+            if (found == mLightIds.end() || found->mId != *it)
+            {
+                lightList.resize(numLights);
+                return false;
+            }
+            lightList.push_back(&viewLights.mLights[found->mIndex]);
+        }
+
+        cache.mRevision = mLightRevision;
+        return true;
+    }
+
+    void LightManager::setCachedLightList(CachedLightList &cache, const osg::BoundingSphere &worldBound, const LightList &lightList)
+    {
+        if (!mLightChangesValid)
+            updateLightChanges();
+
+        cache.mWorldBound = worldBound;
+        cache.mRevision = mLightRevision;
+        cache.mLightIds.clear();
+        for (LightList::const_iterator it = lightList.begin(); it != lightList.end(); ++it)
+            cache.mLightIds.push_back((*it)->mLightSource->getId());
+    }
+
+    void LightManager::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+    {
+        stats->setAttribute(frameNumber, "Lights", mNumLights);
+        stats->setAttribute(frameNumber, "Lights Tested", mNumLightsTested);
+    }
+
+    // Below this number of lights, testing all of them is cheaper than building a grid
+    const unsigned int sMinGridLights = 16;
+
+    // Maximum number of cells along each axis of the grid
+    const int sMaxGridSize = 16;
+
+    LightManager::LightGrid::LightGrid()
+        : mLights(NULL)
+        , mQueryId(0)
+    {
+        mSize[0] = mSize[1] = mSize[2] = 0;
+    }
+
+    void LightManager::LightGrid::build(const std::vector<LightSourceViewBound> &lights)
+    {
+        mLights = &lights;
+        mCellStart.clear();
+        mCellLights.clear();
+        mLastQuery.assign(lights.size(), 0);
+        mQueryId = 0;
+
+        if (lights.size() < sMinGridLights)
+            return;
+
+        mBounds.init();
+        for (unsigned int i=0; i<lights.size(); ++i)
+        {
+            if (lights[i].mViewBound.valid())
+                mBounds.expandBy(lights[i].mViewBound);
+        }
+        if (!mBounds.valid())
+            return;
+
+        // about two lights per cell if they were evenly distributed
+        int size = std::min(sMaxGridSize, static_cast<int>(std::ceil(std::pow(lights.size() / 2.f, 1.f/3.f))));
+        for (int c=0; c<3; ++c)
+        {
+            mSize[c] = size;
+            float extent = mBounds._max[c] - mBounds._min[c];
+            mInvCellSize[c] = extent > 0.f ? size / extent : 0.f;
+        }
+
+        // count the lights of each cell, then store the light indices grouped by cell
+        mCellStart.assign(size*size*size + 1, 0);
+        for (int pass=0; pass<2; ++pass)
+        {
+            std::vector<unsigned int> cursor;
+            if (pass == 1)
+            {
+                for (unsigned int i=1; i<mCellStart.size(); ++i)
+                    mCellStart[i] += mCellStart[i-1];
+                mCellLights.resize(mCellStart.back());
+                cursor.assign(mCellStart.begin(), mCellStart.end()-1);
+            }
+
+            for (unsigned int i=0; i<lights.size(); ++i)
+            {
+                int min[3], max[3];
+                if (!getCellRange(lights[i].mViewBound, min, max))
+                    continue;
+
+                for (int z=min[2]; z<=max[2]; ++z)
+                    for (int y=min[1]; y<=max[1]; ++y)
+                        for (int x=min[0]; x<=max[0]; ++x)
+                        {
+                            int cell = (z*mSize[1] + y)*mSize[0] + x;
+                            if (pass == 0)
+                                ++mCellStart[cell+1];
+                            else
+                                mCellLights[cursor[cell]++] = i;
+                        }
+            }
+        }
+    }
+
+    bool LightManager::LightGrid::getCellRange(const osg::BoundingSphere &bound, int min[3], int max[3]) const
+    {
+        if (!bound.valid())
+            return false;
+
+        for (int c=0; c<3; ++c)
+        {
+            float low = bound.center()[c] - bound.radius();
+            float high = bound.center()[c] + bound.radius();
+            if (high < mBounds._min[c] || low > mBounds._max[c])
+                return false;
+
+            min[c] = std::max(0, static_cast<int>((low - mBounds._min[c]) * mInvCellSize[c]));
+            max[c] = std::min(mSize[c]-1, static_cast<int>((high - mBounds._min[c]) * mInvCellSize[c]));
+        }
+        return true;
+    }
+
+    unsigned int LightManager::LightGrid::query(const osg::BoundingSphere &bound, LightList &lightList) const
+    {
+        if (!mLights)
+            return 0;
+
+        const std::vector<LightSourceViewBound>& lights = *mLights;
+        if (mCellStart.empty())
+        {
+            for (unsigned int i=0; i<lights.size(); ++i)
+            {
+                if (lights[i].mViewBound.intersects(bound))
+                    lightList.push_back(&lights[i]);
+            }
+            return lights.size();
+        }
+
+        int min[3], max[3];
+        if (!getCellRange(bound, min, max))
+            return 0;
+
+        if (++mQueryId == 0)
+        {
+            std::fill(mLastQuery.begin(), mLastQuery.end(), 0);
+            mQueryId = 1;
+        }
+
+        unsigned int tested = 0;
+        mCandidates.clear();
+        for (int z=min[2]; z<=max[2]; ++z)
+            for (int y=min[1]; y<=max[1]; ++y)
+                for (int x=min[0]; x<=max[0]; ++x)
+                {
+                    int cell = (z*mSize[1] + y)*mSize[0] + x;
+                    for (unsigned int j=mCellStart[cell]; j<mCellStart[cell+1]; ++j)
+                    {
+                        unsigned int light = mCellLights[j];
+                        if (mLastQuery[light] == mQueryId)
+                            continue;
+                        mLastQuery[light] = mQueryId;
+
+                        ++tested;
+                        if (lights[light].mViewBound.intersects(bound))
+                            mCandidates.push_back(light);
+                    }
+                }
+
+        // keep the order independent of the cells, so that equal light lists share a StateSet
+        std::sort(mCandidates.begin(), mCandidates.end());
+        for (unsigned int i=0; i<mCandidates.size(); ++i)
+            lightList.push_back(&lights[mCandidates[i]]);
+        return tested;
+    }
+
     class DisableLight : public osg::StateAttribute
     {
     public:
@@ -402,10 +684,6 @@ namespace SceneUtil
         if (!(cv->getCurrentCamera()->getCullMask() & mLightManager->getLightingMask()))
             return false;
 
-        // Possible optimizations:
-        // - cull list of lights by the camera frustum
-        // - organize lights in a quad tree
-
 
         // update light list if necessary
         // makes sure we don't update it more than once per frame when rendering with multiple cameras
@@ -415,7 +693,6 @@ namespace SceneUtil
 
             // Don't use Camera::getViewMatrix, that one might be relative to another camera!
             const osg::RefMatrix* viewMatrix = cv->getCurrentRenderStage()->getInitialViewMatrix();
-            const std::vector<LightManager::LightSourceViewBound>& lights = mLightManager->getLightsInViewSpace(cv->getCurrentCamera(), viewMatrix);
 
             // get the node bounds in view space
             // NB do not node->getBound() * modelView, that would apply the node's transformation twice
@@ -428,19 +705,30 @@ namespace SceneUtil
             }
             else
                 nodeBound = node->getBound();
-            osg::Matrixf mat = *cv->getModelViewMatrix();
-            transformBoundingSphere(mat, nodeBound);
+
+            // the world bound is independent of the camera, so it stays the same as long as the node doesn't move
+            osg::BoundingSphere worldBound = nodeBound;
+            transformBoundingSphere(osg::computeLocalToWorld(cv->getNodePath()), worldBound);
 
             mLightList.clear();
-            for (unsigned int i=0; i<lights.size(); ++i)
+            if (!mLightManager->getCachedLightList(mCachedLightList, worldBound, cv->getCurrentCamera(), viewMatrix, mLightList))
             {
-                const LightManager::LightSourceViewBound& l = lights[i];
+                osg::Matrixf mat = *cv->getModelViewMatrix();
+                transformBoundingSphere(mat, nodeBound);
 
-                if (mIgnoredLightSources.count(l.mLightSource))
-                    continue;
+                mLightManager->getLightsIntersecting(cv->getCurrentCamera(), viewMatrix, nodeBound, mLightList);
+                mLightManager->setCachedLightList(mCachedLightList, worldBound, mLightList);
+            }
 
-                if (l.mViewBound.intersects(nodeBound))
-                    mLightList.push_back(&l);
+            if (!mIgnoredLightSources.empty())
+            {
+                for (LightManager::LightList::iterator it = mLightList.begin(); it != mLightList.end(); )
+                {
+                    if (mIgnoredLightSources.count((*it)->mLightSource))
+                        it = mLightList.erase(it);
+                    else
+                        ++it;
+                }
             }
         }
         if (!mLightList.empty())
@@ -5,10 +5,16 @@
 
 #include <osg/Light>
 
+#include <osg/BoundingBox>
 #include <osg/Group>
 #include <osg/NodeVisitor>
 #include <osg/observer_ptr>
 
+namespace osg
+{
+    class Stats;
+}
+
 namespace osgUtil
 {
     class CullVisitor;
@@ -127,14 +133,106 @@ namespace SceneUtil
 
         typedef std::vector<const LightSourceViewBound*> LightList;
 
+        /// Get the lights whose view space bounds intersect \a viewBound, in the order of getLightsInViewSpace().
+        /// @par The lights are looked up in a grid built once per camera and frame.
+        void getLightsIntersecting(osg::Camera* camera, const osg::RefMatrix* viewMatrix, const osg::BoundingSphere& viewBound, LightList& lightList);
+
         osg::ref_ptr<osg::StateSet> getLightListStateSet(const LightList& lightList, unsigned int frameNum);
 
+        void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
+        /// Light list of an object in world space, reused until the object or a light near it changes.
+        struct CachedLightList
+        {
+            CachedLightList() : mRevision(0) {}
+
+            osg::BoundingSphere mWorldBound;
+            std::vector<int> mLightIds;
+            unsigned int mRevision;
+        };
+
+        /// Get the lights of \a cache for the given camera, if it is still valid for an object with \a worldBound.
+        /// @par The cache is invalidated if the object moves, if a light intersecting the object is added, removed
+        /// or moved, or if the cache was not used in the previous frame.
+        /// @return false if the cache is out of date and needs to be rebuilt with setCachedLightList().
+        bool getCachedLightList(CachedLightList& cache, const osg::BoundingSphere& worldBound, osg::Camera* camera,
+                                const osg::RefMatrix* viewMatrix, LightList& lightList);
+
+        void setCachedLightList(CachedLightList& cache, const osg::BoundingSphere& worldBound, const LightList& lightList);
+
+        /// @brief Uniform grid over the view space bounds of the lights of one camera.
+        /// @par Objects only test the lights overlapping the grid cells that their bounds overlap,
+        /// so the cost of finding the lights of an object does not grow with the number of lights in the scene.
+        class LightGrid
+        {
+        public:
+            LightGrid();
+
+            /// @note \a lights must stay valid until the next call to build().
+            void build(const std::vector<LightSourceViewBound>& lights);
+
+            /// Append the lights intersecting \a bound to \a lightList, in the order of the lights passed to build().
+            /// @return The number of light bounds tested.
+            unsigned int query(const osg::BoundingSphere& bound, LightList& lightList) const;
+
+        private:
+            bool getCellRange(const osg::BoundingSphere& bound, int min[3], int max[3]) const;
+
+            const std::vector<LightSourceViewBound>* mLights;
+
+            osg::BoundingBox mBounds;
+            osg::Vec3f mInvCellSize;
+            int mSize[3];
+
+            // mCellLights[mCellStart[i], mCellStart[i+1]) are the indices of the lights overlapping cell i,
+            // no cells are used if there are too few lights for the grid to pay off
+            std::vector<unsigned int> mCellStart;
+            std::vector<unsigned int> mCellLights;
+
+            // avoids testing lights overlapping several cells more than once per query
+            mutable std::vector<unsigned int> mLastQuery;
+            mutable unsigned int mQueryId;
+            mutable std::vector<unsigned int> mCandidates;
+        };
+
     private:
         // Lights collected from the scene graph. Only valid during the cull traversal.
         std::vector<LightSourceTransform> mLights;
 
         typedef std::vector<LightSourceViewBound> LightSourceViewBoundCollection;
-        std::map<osg::observer_ptr<osg::Camera>, LightSourceViewBoundCollection> mLightsInViewSpace;
+        struct ViewLights
+        {
+            LightSourceViewBoundCollection mLights;
+            LightGrid mGrid;
+        };
+        std::map<osg::observer_ptr<osg::Camera>, ViewLights> mLightsInViewSpace;
+
+        ViewLights& getViewLights(osg::Camera* camera, const osg::RefMatrix* viewMatrix);
+
+        struct LightId
+        {
+            int mId;
+            unsigned int mIndex; ///< in mLights
+            osg::BoundingSphere mWorldBound;
+
+            bool operator<(const LightId& other) const { return mId < other.mId; }
+        };
+
+        // Lights of the current and previous frame sorted by ID, and the world bounds of the lights that were added,
+        // removed or moved in between. Computed on demand, once per frame.
+        std::vector<LightId> mLightIds;
+        std::vector<LightId> mPreviousLightIds;
+        std::vector<osg::BoundingSphere> mChangedLightBounds;
+        bool mLightChangesValid;
+        // Incremented whenever the light changes are computed, see CachedLightList::mRevision
+        unsigned int mLightRevision;
+
+        void updateLightChanges();
+
+        // Number of light bounds tested by light list callbacks since the last update
+        unsigned int mLightsTested;
+        unsigned int mNumLightsTested;
+        unsigned int mNumLights;
 
         // < Light list hash , StateSet >
         typedef std::map<size_t, osg::ref_ptr<osg::StateSet> > LightStateSetMap;
@@ -180,6 +278,7 @@ namespace SceneUtil
         LightManager* mLightManager;
         unsigned int mLastFrameNumber;
         LightManager::LightList mLightList;
+        LightManager::CachedLightList mCachedLightList;
         std::set<SceneUtil::LightSource*> mIgnoredLightSources;
     };
 
@@ -4,14 +4,122 @@
 #include <iostream>
 #include <cstdlib>
 
+#include <OpenThreads/ScopedLock>
+#include <osg/observer_ptr>
+
 #include "skeleton.hpp"
+#include "skinning.hpp"
 #include "util.hpp"
 
 namespace SceneUtil
 {
 
+/// Waits for the skinning work item of a buffer before drawing it.
+class RigGeometry::SkinningSync : public osg::Drawable::DrawCallback
+{
+public:
+    virtual void drawImplementation(osg::RenderInfo& renderInfo, const osg::Drawable* drawable) const
+    {
+        wait();
+        drawable->drawImplementation(renderInfo);
+    }
+
+    void wait() const
+    {
+        if (mWorkItem)
+            mWorkItem->waitTillDone();
+    }
+
+    /// Set by the cull traversal, which never overlaps the draw of the same buffer.
+    osg::ref_ptr<WorkItem> mWorkItem;
+};
+
+class RigGeometry::SkinData : public osg::Referenced
+{
+public:
+    SkinData()
+        : mInitialized(false)
+    {
+    }
+
+    OpenThreads::Mutex mMutex;
+    bool mInitialized;
+
+    /// Inverse bind matrix of each bone, in the order of the influence map
+    std::vector<osg::Matrixf> mInvBindMatrices;
+
+    /// Index in mInvBindMatrices and weight
+    typedef std::pair<unsigned int, float> BoneWeight;
+
+    /// Bone weights of all vertex groups in mVertices, the weights of group i are in
+    /// [mGroupWeightOffsets[i], mGroupWeightOffsets[i+1])
+    std::vector<BoneWeight> mBoneWeights;
+    std::vector<unsigned int> mGroupWeightOffsets;
+
+    SkinnedVertices mVertices;
+};
+
+class SkinningWorkItem : public WorkItem
+{
+public:
+    SkinningWorkItem(const RigGeometry* rig, osg::Geometry* geom)
+        : mRig(rig)
+        , mGeometry(geom)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mRig->skin(*mGeometry, mGroupMatrices);
+    }
+
+    std::vector<osg::Matrixf> mGroupMatrices;
+
+private:
+    // the RigGeometry waits for pending work items when it is destroyed
+    const RigGeometry* mRig;
+    osg::ref_ptr<osg::Geometry> mGeometry;
+};
+
+namespace
+{
+    /// Makes the internal geometries use the bounds of their RigGeometry, computed from the bone bounding spheres,
+    /// rather than the bounds of their vertices, which may be in the process of being skinned.
+    class CopyBoundingBoxCallback : public osg::Drawable::ComputeBoundingBoxCallback
+    {
+    public:
+        virtual osg::BoundingBox computeBound(const osg::Drawable&) const
+        {
+            return mBoundingBox;
+        }
+
+        /// Set by the update traversal, which never overlaps the cull traversal.
+        osg::BoundingBox mBoundingBox;
+    };
+
+    struct SharedSkinning
+    {
+        std::vector<osg::Matrixf> mGroupMatrices;
+        osg::observer_ptr<osg::Geometry> mGeometry;
+    };
+
+    // skinned geometries of the current frame, by source geometry
+    typedef std::multimap<const osg::Geometry*, SharedSkinning> SharedSkinningMap;
+    SharedSkinningMap sSharedSkinning;
+    unsigned int sSharedSkinningFrame = 0;
+    OpenThreads::Mutex sSharedSkinningMutex;
+}
+
+osg::ref_ptr<WorkQueue> RigGeometry::sWorkQueue;
+
+void RigGeometry::setWorkQueue(osg::ref_ptr<WorkQueue> workQueue)
+{
+    sWorkQueue = workQueue;
+}
+
 RigGeometry::RigGeometry()
-    : mSkeleton(NULL)
+    : mShareSkinning(false)
+    , mSkeleton(NULL)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
@@ -21,17 +129,29 @@ RigGeometry::RigGeometry()
 
 RigGeometry::RigGeometry(const RigGeometry &copy, const osg::CopyOp &copyop)
     : Drawable(copy, copyop)
+    , mShareSkinning(copy.mShareSkinning)
     , mSkeleton(NULL)
     , mInfluenceMap(copy.mInfluenceMap)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
     setSourceGeometry(copy.mSourceGeometry);
+    mSkinData = copy.mSkinData;
+}
+
+RigGeometry::~RigGeometry()
+{
+    for (unsigned int i=0; i<2; ++i)
+    {
+        if (mSkinningSync[i])
+            mSkinningSync[i]->wait();
+    }
 }
 
 void RigGeometry::setSourceGeometry(osg::ref_ptr<osg::Geometry> sourceGeometry)
 {
     mSourceGeometry = sourceGeometry;
+    mSkinData = new SkinData;
 
     for (unsigned int i=0; i<2; ++i)
     {
@@ -42,6 +162,11 @@ void RigGeometry::setSourceGeometry(osg::ref_ptr<osg::Geometry> sourceGeometry)
         to.setUseVertexBufferObjects(true);
         to.setCullingActive(false); // make sure to disable culling since that's handled by this class
 
+        mSkinningSync[i] = new SkinningSync;
+        to.setDrawCallback(mSkinningSync[i]);
+
+        to.setComputeBoundingBoxCallback(new CopyBoundingBoxCallback);
+
         // vertices and normals are modified every frame, so we need to deep copy them.
         // assign a dedicated VBO to make sure that modifications don't interfere with source geometry's VBO.
         osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
@@ -81,6 +206,35 @@ osg::ref_ptr<osg::Geometry> RigGeometry::getSourceGeometry()
     return mSourceGeometry;
 }
 
+void RigGeometry::setShareSkinning(bool share)
+{
+    mShareSkinning = share;
+}
+
+osg::Geometry* RigGeometry::acquireSharedSkinning(unsigned int frame, const std::vector<osg::Matrixf>& groupMatrices, osg::Geometry* geom)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sSharedSkinningMutex);
+    if (frame != sSharedSkinningFrame)
+    {
+        sSharedSkinning.clear();
+        sSharedSkinningFrame = frame;
+    }
+
+    std::pair<SharedSkinningMap::iterator, SharedSkinningMap::iterator> range = sSharedSkinning.equal_range(mSourceGeometry.get());
+    for (SharedSkinningMap::iterator it = range.first; it != range.second; ++it)
+    {
+        osg::ref_ptr<osg::Geometry> shared;
+        if (it->second.mGroupMatrices == groupMatrices && it->second.mGeometry.lock(shared))
+            return shared.get();
+    }
+
+    SharedSkinning entry;
+    entry.mGroupMatrices = groupMatrices;
+    entry.mGeometry = geom;
+    sSharedSkinning.insert(std::make_pair(mSourceGeometry.get(), entry));
+    return geom;
+}
+
 bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 {
     const osg::NodePath& path = nv->getNodePath();
@@ -106,38 +260,64 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
         return false;
     }
 
-    typedef std::map<unsigned short, std::vector<BoneWeight> > Vertex2BoneMap;
-    Vertex2BoneMap vertex2BoneMap;
+    initSkinData();
+
+    mBoneIndices.reserve(mSkinData->mInvBindMatrices.size());
     for (std::map<std::string, BoneInfluence>::const_iterator it = mInfluenceMap->mMap.begin(); it != mInfluenceMap->mMap.end(); ++it)
     {
-        Bone* bone = mSkeleton->getBone(it->first);
-        if (!bone)
+        int bone = mSkeleton->getBoneIndex(it->first);
+        mBoneIndices.push_back(bone);
+        if (bone == -1)
         {
             std::cerr << "Error: RigGeometry did not find bone " << it->first << std::endl;
             continue;
         }
 
         mBoneSphereMap[bone] = it->second.mBoundSphere;
+    }
 
-        const BoneInfluence& bi = it->second;
+    return true;
+}
 
-        const std::map<unsigned short, float>& weights = it->second.mWeights;
-        for (std::map<unsigned short, float>::const_iterator weightIt = weights.begin(); weightIt != weights.end(); ++weightIt)
-        {
-            std::vector<BoneWeight>& vec = vertex2BoneMap[weightIt->first];
+void RigGeometry::initSkinData()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mSkinData->mMutex);
+    if (mSkinData->mInitialized)
+        return;
 
-            BoneWeight b = std::make_pair(std::make_pair(bone, bi.mInvBindMatrix), weightIt->second);
+    SkinData& data = *mSkinData;
 
-            vec.push_back(b);
-        }
+    typedef std::map<unsigned short, std::vector<SkinData::BoneWeight> > Vertex2BoneMap;
+    Vertex2BoneMap vertex2BoneMap;
+    for (std::map<std::string, BoneInfluence>::const_iterator it = mInfluenceMap->mMap.begin(); it != mInfluenceMap->mMap.end(); ++it)
+    {
+        unsigned int bone = data.mInvBindMatrices.size();
+        data.mInvBindMatrices.push_back(it->second.mInvBindMatrix);
+
+        const std::map<unsigned short, float>& weights = it->second.mWeights;
+        for (std::map<unsigned short, float>::const_iterator weightIt = weights.begin(); weightIt != weights.end(); ++weightIt)
+            vertex2BoneMap[weightIt->first].push_back(std::make_pair(bone, weightIt->second));
     }
 
+    typedef std::map<std::vector<SkinData::BoneWeight>, std::vector<unsigned short> > Bone2VertexMap;
+    Bone2VertexMap bone2VertexMap;
     for (Vertex2BoneMap::iterator it = vertex2BoneMap.begin(); it != vertex2BoneMap.end(); ++it)
     {
-        mBone2VertexMap[it->second].push_back(it->first);
+        bone2VertexMap[it->second].push_back(it->first);
     }
 
-    return true;
+    const osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
+    const osg::Vec3Array* normalSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getNormalArray());
+
+    data.mGroupWeightOffsets.push_back(0);
+    for (Bone2VertexMap::const_iterator it = bone2VertexMap.begin(); it != bone2VertexMap.end(); ++it)
+    {
+        data.mBoneWeights.insert(data.mBoneWeights.end(), it->first.begin(), it->first.end());
+        data.mGroupWeightOffsets.push_back(data.mBoneWeights.size());
+        data.mVertices.addGroup(it->second, positionSrc, normalSrc, mSourceTangents);
+    }
+
+    data.mInitialized = true;
 }
 
 void accumulateMatrix(const osg::Matrixf& invBindMatrix, const osg::Matrixf& matrix, float weight, osg::Matrixf& result)
@@ -172,70 +352,112 @@ void RigGeometry::cull(osg::NodeVisitor* nv)
             return;
     }
 
-    if ((!mSkeleton->getActive() && mLastFrameNumber != 0) || mLastFrameNumber == nv->getTraversalNumber())
+    // a shared geometry is overwritten by its owner in later frames, so it can't be kept while skinning is inactive
+    int drawnBuffer = getDrawnBuffer();
+    if ((!mSkeleton->getSkinningActive() && mLastFrameNumber != 0 && drawnBuffer != -1) || mLastFrameNumber == nv->getTraversalNumber())
     {
-        osg::Geometry& geom = *getGeometry(mLastFrameNumber);
+        osg::Geometry& geom = mDrawnGeometry ? *mDrawnGeometry : *mGeometry[0];
         nv->pushOntoNodePath(&geom);
         nv->apply(geom);
         nv->popFromNodePath();
         return;
     }
     mLastFrameNumber = nv->getTraversalNumber();
-    osg::Geometry& geom = *getGeometry(mLastFrameNumber);
 
-    mSkeleton->updateBoneMatrices(nv->getTraversalNumber());
+    // the buffer drawn in the previous frame may still be in use by its draw traversal
+    unsigned int buffer = drawnBuffer == 0 ? 1 : 0;
+    osg::Geometry& geom = *mGeometry[buffer];
 
-    // skinning
-    const osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
-    const osg::Vec3Array* normalSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getNormalArray());
-    const osg::Vec4Array* tangentSrc = mSourceTangents;
+    mSkeleton->updateBoneMatrices(nv->getTraversalNumber());
 
-    osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(geom.getVertexArray());
-    osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(geom.getNormalArray());
-    osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(geom.getTexCoordArray(7));
+    // The skinning matrices are computed here, as the bone matrices will change with the next frame's cull traversal,
+    // while skinning of this buffer may still be in progress.
+    osg::ref_ptr<SkinningWorkItem> workItem (new SkinningWorkItem(this, &geom));
+    std::vector<osg::Matrixf>& groupMatrices = workItem->mGroupMatrices;
+    const SkinData& data = *mSkinData;
+    groupMatrices.reserve(data.mVertices.getNumGroups());
 
-    for (Bone2VertexMap::const_iterator it = mBone2VertexMap.begin(); it != mBone2VertexMap.end(); ++it)
+    for (unsigned int group = 0; group < data.mVertices.getNumGroups(); ++group)
     {
         osg::Matrixf resultMat  (0, 0, 0, 0,
                                 0, 0, 0, 0,
                                 0, 0, 0, 0,
                                 0, 0, 0, 1);
 
-        for (std::vector<BoneWeight>::const_iterator weightIt = it->first.begin(); weightIt != it->first.end(); ++weightIt)
+        for (unsigned int i = data.mGroupWeightOffsets[group]; i < data.mGroupWeightOffsets[group+1]; ++i)
         {
-            Bone* bone = weightIt->first.first;
-            const osg::Matrix& invBindMatrix = weightIt->first.second;
-            float weight = weightIt->second;
-            const osg::Matrixf& boneMatrix = bone->mMatrixInSkeletonSpace;
-            accumulateMatrix(invBindMatrix, boneMatrix, weight, resultMat);
+            const SkinData::BoneWeight& boneWeight = data.mBoneWeights[i];
+            int bone = mBoneIndices[boneWeight.first];
+            if (bone == -1)
+                continue;
+            const osg::Matrixf& invBindMatrix = data.mInvBindMatrices[boneWeight.first];
+            const osg::Matrixf& boneMatrix = mSkeleton->getBoneMatrix(bone);
+            accumulateMatrix(invBindMatrix, boneMatrix, boneWeight.second, resultMat);
         }
         if (mGeomToSkelMatrix)
             resultMat *= (*mGeomToSkelMatrix);
 
-        for (std::vector<unsigned short>::const_iterator vertexIt = it->second.begin(); vertexIt != it->second.end(); ++vertexIt)
+        groupMatrices.push_back(resultMat);
+    }
+
+    // the pose has not changed, e.g. because the animation is updated at a reduced rate, keep drawing the same buffer
+    if (drawnBuffer != -1 && groupMatrices == mDrawnGroupMatrices)
+    {
+        nv->pushOntoNodePath(mDrawnGeometry.get());
+        nv->apply(*mDrawnGeometry);
+        nv->popFromNodePath();
+        return;
+    }
+
+    if (mShareSkinning)
+    {
+        osg::Geometry* shared = acquireSharedSkinning(mLastFrameNumber, groupMatrices, &geom);
+        if (shared != &geom)
         {
-            unsigned short vertex = *vertexIt;
-            (*positionDst)[vertex] = resultMat.preMult((*positionSrc)[vertex]);
-            if (normalDst)
-                (*normalDst)[vertex] = osg::Matrix::transform3x3((*normalSrc)[vertex], resultMat);
-            if (tangentDst)
-            {
-                osg::Vec4f srcTangent = (*tangentSrc)[vertex];
-                osg::Vec3f transformedTangent = osg::Matrix::transform3x3(osg::Vec3f(srcTangent.x(), srcTangent.y(), srcTangent.z()), resultMat);
-                (*tangentDst)[vertex] = osg::Vec4f(transformedTangent, srcTangent.w());
-            }
+            // drawing the shared geometry waits for its skinning through the owner's SkinningSync
+            mDrawnGeometry = shared;
+            nv->pushOntoNodePath(shared);
+            nv->apply(*shared);
+            nv->popFromNodePath();
+            return;
         }
     }
+    mDrawnGeometry = &geom;
+    mDrawnGroupMatrices = groupMatrices;
+
+    SkinningSync* sync = mSkinningSync[buffer];
+    // the previous skinning of this buffer has normally been waited for by its draw already
+    sync->wait();
+    if (sWorkQueue)
+    {
+        sync->mWorkItem = workItem;
+        sWorkQueue->addWorkItem(workItem);
+    }
+    else
+    {
+        sync->mWorkItem = NULL;
+        skin(geom, groupMatrices);
+    }
+
+    nv->pushOntoNodePath(&geom);
+    nv->apply(geom);
+    nv->popFromNodePath();
+}
+
+void RigGeometry::skin(osg::Geometry& geom, const std::vector<osg::Matrixf>& groupMatrices) const
+{
+    osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(geom.getVertexArray());
+    osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(geom.getNormalArray());
+    osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(geom.getTexCoordArray(7));
+
+    for (unsigned int group = 0; group < groupMatrices.size(); ++group)
+        mSkinData->mVertices.transform(group, groupMatrices[group], positionDst, normalDst, tangentDst);
 
     positionDst->dirty();
     if (normalDst)
         normalDst->dirty();
     if (tangentDst)
         tangentDst->dirty();
-
-    nv->pushOntoNodePath(&geom);
-    nv->apply(geom);
-    nv->popFromNodePath();
 }
 
 void RigGeometry::updateBounds(osg::NodeVisitor *nv)
@@ -246,7 +468,7 @@ void RigGeometry::updateBounds(osg::NodeVisitor *nv)
             return;
     }
 
-    if (!mSkeleton->getActive() && !mBoundsFirstFrame)
+    if (!mSkeleton->getSkinningActive() && !mBoundsFirstFrame)
         return;
     mBoundsFirstFrame = false;
 
@@ -257,12 +479,12 @@ void RigGeometry::updateBounds(osg::NodeVisitor *nv)
     osg::BoundingBox box;
     for (BoneSphereMap::const_iterator it = mBoneSphereMap.begin(); it != mBoneSphereMap.end(); ++it)
     {
-        Bone* bone = it->first;
+        const osg::Matrixf& boneMatrix = mSkeleton->getBoneMatrix(it->first);
         osg::BoundingSpheref bs = it->second;
         if (mGeomToSkelMatrix)
-            transformBoundingSphere(bone->mMatrixInSkeletonSpace * (*mGeomToSkelMatrix), bs);
+            transformBoundingSphere(boneMatrix * (*mGeomToSkelMatrix), bs);
         else
-            transformBoundingSphere(bone->mMatrixInSkeletonSpace, bs);
+            transformBoundingSphere(boneMatrix, bs);
         box.expandBy(bs);
     }
 
@@ -273,6 +495,13 @@ void RigGeometry::updateBounds(osg::NodeVisitor *nv)
         _boundingSphereComputed = true;
         for (unsigned int i=0; i<getNumParents(); ++i)
             getParent(i)->dirtyBound();
+
+        for (unsigned int i=0; i<2; ++i)
+        {
+            osg::Geometry& geom = *mGeometry[i];
+            static_cast<CopyBoundingBoxCallback*>(geom.getComputeBoundingBoxCallback())->mBoundingBox = _boundingBox;
+            geom.dirtyBound();
+        }
     }
 }
 
@@ -305,6 +534,7 @@ void RigGeometry::updateGeomToSkelMatrix(const osg::NodePath& nodePath)
 void RigGeometry::setInfluenceMap(osg::ref_ptr<InfluenceMap> influenceMap)
 {
     mInfluenceMap = influenceMap;
+    mSkinData = new SkinData;
 }
 
 void RigGeometry::accept(osg::NodeVisitor &nv)
@@ -326,12 +556,20 @@ void RigGeometry::accept(osg::NodeVisitor &nv)
 
 void RigGeometry::accept(osg::PrimitiveFunctor& func) const
 {
-    getGeometry(mLastFrameNumber)->accept(func);
+    if (mDrawnGeometry)
+        mDrawnGeometry->accept(func);
+    else
+        mGeometry[0]->accept(func);
 }
 
-osg::Geometry* RigGeometry::getGeometry(unsigned int frame) const
+int RigGeometry::getDrawnBuffer() const
 {
-    return mGeometry[frame%2].get();
+    for (unsigned int i=0; i<2; ++i)
+    {
+        if (mDrawnGeometry == mGeometry[i])
+            return i;
+    }
+    return -1;
 }
 
 
@@ -4,17 +4,22 @@
 #include <osg/Geometry>
 #include <osg/Matrixf>
 
+#include "workqueue.hpp"
+
 namespace SceneUtil
 {
 
     class Skeleton;
-    class Bone;
+    class SkinningWorkItem;
 
     /// @brief Mesh skinning implementation.
     /// @note A RigGeometry may be attached directly to a Skeleton, or somewhere below a Skeleton.
     /// Note though that the RigGeometry ignores any transforms below the Skeleton, so the attachment point is not that important.
     /// @note The internal Geometry used for rendering is double buffered, this allows updates to be done in a thread safe way while
     /// not compromising rendering performance. This is crucial when using osg's default threading model of DrawThreadPerContext.
+    /// If the skinning matrices did not change since the previous frame, the buffer drawn in that frame is drawn again.
+    /// @note If a work queue is set with setWorkQueue(), the cull traversal only computes the skinning matrices, and the vertices
+    /// are skinned on the work queue. The draw of the internal Geometry then waits until skinning of that buffer has completed.
     class RigGeometry : public osg::Drawable
     {
     public:
@@ -23,6 +28,16 @@ namespace SceneUtil
 
         META_Object(SceneUtil, RigGeometry)
 
+        /// Set the work queue used to skin all RigGeometries, or NULL to skin in the cull traversal (the default).
+        /// @note Not thread safe, should be called before any rendering takes place. The work queue must not be
+        /// destroyed before all RigGeometries that used it.
+        static void setWorkQueue(osg::ref_ptr<WorkQueue> workQueue);
+
+        /// Allow this geometry to draw the vertices of another RigGeometry sharing the same source geometry, instead of
+        /// skinning its own, if both were skinned with identical matrices in the same frame. Only geometries with this
+        /// option enabled share their results. Intended for distant instances of the same model playing the same animation.
+        void setShareSkinning(bool share);
+
         // At this point compileGLObjects() remains unimplemented, hard to avoid race conditions
         // and there is limited value in compiling anyway since the data will change again for the next frame
 
@@ -51,12 +66,40 @@ namespace SceneUtil
         virtual bool supports(const osg::PrimitiveFunctor&) const { return true; }
         virtual void accept(osg::PrimitiveFunctor&) const;
 
+    protected:
+        virtual ~RigGeometry();
+
     private:
+        friend class SkinningWorkItem;
+
         void cull(osg::NodeVisitor* nv);
         void updateBounds(osg::NodeVisitor* nv);
 
+        /// Transform the vertices of each group by the given matrices and write them to \a geom.
+        void skin(osg::Geometry& geom, const std::vector<osg::Matrixf>& groupMatrices) const;
+
         osg::ref_ptr<osg::Geometry> mGeometry[2];
-        osg::Geometry* getGeometry(unsigned int frame) const;
+
+        /// The geometry drawn in the last frame, either one of mGeometry or one shared by another RigGeometry
+        osg::ref_ptr<osg::Geometry> mDrawnGeometry;
+        /// The skinning matrices of mDrawnGeometry, if it is one of mGeometry
+        std::vector<osg::Matrixf> mDrawnGroupMatrices;
+
+        /// @return The index of mDrawnGeometry in mGeometry, or -1 if not drawing an own buffer.
+        int getDrawnBuffer() const;
+
+        bool mShareSkinning;
+
+        /// Find a geometry skinned with \a groupMatrices in this frame by another RigGeometry with the same source geometry,
+        /// or register \a geom as the result for these matrices if there is none.
+        /// @return The geometry to draw.
+        osg::Geometry* acquireSharedSkinning(unsigned int frame, const std::vector<osg::Matrixf>& groupMatrices, osg::Geometry* geom);
+
+        class SkinningSync;
+        /// Draw callbacks of mGeometry, waiting for the skinning work item of their buffer
+        osg::ref_ptr<SkinningSync> mSkinningSync[2];
+
+        static osg::ref_ptr<WorkQueue> sWorkQueue;
 
         osg::ref_ptr<osg::Geometry> mSourceGeometry;
         osg::ref_ptr<const osg::Vec4Array> mSourceTangents;
@@ -66,17 +109,14 @@ namespace SceneUtil
 
         osg::ref_ptr<InfluenceMap> mInfluenceMap;
 
-        typedef std::pair<Bone*, osg::Matrixf> BoneBindMatrixPair;
+        class SkinData;
+        /// Vertex groups and bone weights derived from the source geometry and influence map, shared between clones
+        osg::ref_ptr<SkinData> mSkinData;
 
-        typedef std::pair<BoneBindMatrixPair, float> BoneWeight;
+        /// Bone index in mSkeleton of each bone of mSkinData, or -1 if the skeleton does not have the bone
+        std::vector<int> mBoneIndices;
 
-        typedef std::vector<unsigned short> VertexList;
-
-        typedef std::map<std::vector<BoneWeight>, VertexList> Bone2VertexMap;
-
-        Bone2VertexMap mBone2VertexMap;
-
-        typedef std::map<Bone*, osg::BoundingSpheref> BoneSphereMap;
+        typedef std::map<int, osg::BoundingSpheref> BoneSphereMap;
 
         BoneSphereMap mBoneSphereMap;
 
@@ -85,6 +125,9 @@ namespace SceneUtil
 
         bool initFromParentSkeleton(osg::NodeVisitor* nv);
 
+        /// Group the source vertices by their bone influences, if not already done by a clone of this geometry.
+        void initSkinData();
+
         void updateGeomToSkelMatrix(const osg::NodePath& nodePath);
     };
 
@@ -36,7 +36,9 @@ private:
 Skeleton::Skeleton()
     : mBoneCacheInit(false)
     , mNeedToUpdateBoneMatrices(true)
+    , mBonesAdded(false)
     , mActive(true)
+    , mFreezeSkinning(false)
     , mLastFrameNumber(0)
 {
 
@@ -46,13 +48,15 @@ Skeleton::Skeleton(const Skeleton &copy, const osg::CopyOp &copyop)
     : osg::Group(copy, copyop)
     , mBoneCacheInit(false)
     , mNeedToUpdateBoneMatrices(true)
+    , mBonesAdded(false)
     , mActive(copy.mActive)
+    , mFreezeSkinning(copy.mFreezeSkinning)
     , mLastFrameNumber(0)
 {
 
 }
 
-Bone* Skeleton::getBone(const std::string &name)
+int Skeleton::getBoneIndex(const std::string &name)
 {
     if (!mBoneCacheInit)
     {
@@ -63,45 +67,38 @@ Bone* Skeleton::getBone(const std::string &name)
 
     BoneCache::iterator found = mBoneCache.find(Misc::StringUtils::lowerCase(name));
     if (found == mBoneCache.end())
-        return NULL;
+        return -1;
 
-    // find or insert in the bone hierarchy
-
-    if (!mRootBone.get())
-    {
-        mRootBone.reset(new Bone);
-    }
+    // find or insert in the bone hierarchy, the path is walked from the root so parents are always inserted first
 
     const osg::NodePath& path = found->second.first;
-    Bone* bone = mRootBone.get();
+    int index = -1;
     for (osg::NodePath::const_iterator it = path.begin(); it != path.end(); ++it)
     {
         osg::MatrixTransform* matrixTransform = dynamic_cast<osg::MatrixTransform*>(*it);
         if (!matrixTransform)
             continue;
 
-        Bone* child = NULL;
-        for (unsigned int i=0; i<bone->mChildren.size(); ++i)
+        std::map<osg::MatrixTransform*, int>::const_iterator existing = mBoneIndices.find(matrixTransform);
+        if (existing != mBoneIndices.end())
         {
-            if (bone->mChildren[i]->mNode == *it)
-            {
-                child = bone->mChildren[i];
-                break;
-            }
+            index = existing->second;
+            continue;
         }
 
-        if (!child)
-        {
-            child = new Bone;
-            bone->mChildren.push_back(child);
-            mNeedToUpdateBoneMatrices = true;
-        }
-        bone = child;
+        Bone bone;
+        bone.mNode = matrixTransform;
+        bone.mParent = index;
+        bone.mDirty = true;
+        mBones.push_back(bone);
 
-        bone->mNode = matrixTransform;
+        index = mBones.size()-1;
+        mBoneIndices[matrixTransform] = index;
+        mNeedToUpdateBoneMatrices = true;
+        mBonesAdded = true;
     }
 
-    return bone;
+    return index;
 }
 
 void Skeleton::updateBoneMatrices(unsigned int traversalNumber)
@@ -113,12 +110,25 @@ void Skeleton::updateBoneMatrices(unsigned int traversalNumber)
 
     if (mNeedToUpdateBoneMatrices)
     {
-        if (mRootBone.get())
+        // Parents come first, so a single pass suffices. Bones whose local matrix and parent are unchanged,
+        // e.g. because no animation is playing on them, keep their skeleton-space matrix.
+        for (std::vector<Bone>::iterator bone = mBones.begin(); bone != mBones.end(); ++bone)
         {
-            for (unsigned int i=0; i<mRootBone->mChildren.size(); ++i)
-                mRootBone->mChildren[i]->update(NULL);
+            const osg::Matrix& matrix = bone->mNode->getMatrix();
+            const Bone* parent = bone->mParent != -1 ? &mBones[bone->mParent] : NULL;
+
+            bone->mDirty = mBonesAdded || (parent && parent->mDirty) || matrix != bone->mMatrix;
+            if (!bone->mDirty)
+                continue;
+
+            bone->mMatrix = matrix;
+            if (parent)
+                bone->mMatrixInSkeletonSpace = matrix * parent->mMatrixInSkeletonSpace;
+            else
+                bone->mMatrixInSkeletonSpace = matrix;
         }
 
+        mBonesAdded = false;
         mNeedToUpdateBoneMatrices = false;
     }
 }
@@ -133,6 +143,21 @@ bool Skeleton::getActive() const
     return mActive;
 }
 
+void Skeleton::setFreezeSkinning(bool freeze)
+{
+    mFreezeSkinning = freeze;
+}
+
+bool Skeleton::getFreezeSkinning() const
+{
+    return mFreezeSkinning;
+}
+
+bool Skeleton::getSkinningActive() const
+{
+    return mActive && !mFreezeSkinning;
+}
+
 void Skeleton::markDirty()
 {
     mLastFrameNumber = 0;
@@ -157,34 +182,4 @@ void Skeleton::childRemoved(unsigned int, unsigned int)
     markDirty();
 }
 
-Bone::Bone()
-    : mNode(NULL)
-{
-}
-
-Bone::~Bone()
-{
-    for (unsigned int i=0; i<mChildren.size(); ++i)
-        delete mChildren[i];
-    mChildren.clear();
-}
-
-void Bone::update(const osg::Matrixf* parentMatrixInSkeletonSpace)
-{
-    if (!mNode)
-    {
-        std::cerr << "Error: Bone without node " << std::endl;
-        return;
-    }
-    if (parentMatrixInSkeletonSpace)
-        mMatrixInSkeletonSpace = mNode->getMatrix() * (*parentMatrixInSkeletonSpace);
-    else
-        mMatrixInSkeletonSpace = mNode->getMatrix();
-
-    for (unsigned int i=0; i<mChildren.size(); ++i)
-    {
-        mChildren[i]->update(&mMatrixInSkeletonSpace);
-    }
-}
-
 }
@@ -2,34 +2,14 @@
 #define OPENMW_COMPONENTS_NIFOSG_SKELETON_H
 
 #include <osg/Group>
+#include <osg/MatrixTransform>
 
-#include <memory>
+#include <map>
+#include <vector>
 
 namespace SceneUtil
 {
 
-    /// @brief Defines a Bone hierarchy, used for updating of skeleton-space bone matrices.
-    /// @note To prevent unnecessary updates, only bones that are used for skinning will be added to this hierarchy.
-    class Bone
-    {
-    public:
-        Bone();
-        ~Bone();
-
-        osg::Matrixf mMatrixInSkeletonSpace;
-
-        osg::MatrixTransform* mNode;
-
-        std::vector<Bone*> mChildren;
-
-        /// Update the skeleton-space matrix of this bone and all its children.
-        void update(const osg::Matrixf* parentMatrixInSkeletonSpace);
-
-    private:
-        Bone(const Bone&);
-        void operator=(const Bone&);
-    };
-
     /// @brief Handles the bone matrices for any number of child RigGeometries.
     /// @par Bones should be created as osg::MatrixTransform children of the skeleton.
     /// To be a referenced by a RigGeometry, a bone needs to have a unique name.
@@ -41,8 +21,12 @@ namespace SceneUtil
 
         META_Node(SceneUtil, Skeleton)
 
-        /// Retrieve a bone by name.
-        Bone* getBone(const std::string& name);
+        /// Retrieve the index of a bone by name, adding it and its parents to the bone hierarchy if necessary.
+        /// @return The bone index, which stays valid for the lifetime of the skeleton, or -1 if there is no such bone.
+        int getBoneIndex(const std::string& name);
+
+        /// Get the skeleton-space matrix of a bone, as of the last updateBoneMatrices().
+        const osg::Matrixf& getBoneMatrix(int index) const { return mBones[index].mMatrixInSkeletonSpace; }
 
         /// Request an update of bone matrices. May be a no-op if already updated in this frame.
         void updateBoneMatrices(unsigned int traversalNumber);
@@ -53,6 +37,15 @@ namespace SceneUtil
 
         bool getActive() const;
 
+        /// Set the freeze skinning flag. While frozen, child rigs keep drawing their last skinned pose,
+        /// but unlike an inactive skeleton, the bones and all other children are still updated.
+        void setFreezeSkinning(bool freeze);
+
+        bool getFreezeSkinning() const;
+
+        /// @return If child rigs should be skinned, i.e. the skeleton is active and skinning is not frozen.
+        bool getSkinningActive() const;
+
         void traverse(osg::NodeVisitor& nv);
 
         void markDirty();
@@ -61,17 +54,31 @@ namespace SceneUtil
         virtual void childRemoved(unsigned int, unsigned int);
 
     private:
-        // The root bone is not a "real" bone, it has no corresponding node in the scene graph.
-        // As far as the scene graph goes we support multiple root bones.
-        std::unique_ptr<Bone> mRootBone;
+        /// @note To prevent unnecessary updates, only bones that are used for skinning are added to the hierarchy.
+        struct Bone
+        {
+            osg::MatrixTransform* mNode;
+            int mParent; ///< -1 for root bones, as far as the scene graph goes we support multiple root bones
+
+            osg::Matrix mMatrix; ///< local matrix the skeleton-space matrix was last computed from
+            osg::Matrixf mMatrixInSkeletonSpace;
+            bool mDirty; ///< skeleton-space matrix changed in the last update
+        };
+
+        /// The bone hierarchy, sorted so that parents always come before their children. Bones are only ever appended,
+        /// so that indices held by RigGeometries remain valid.
+        std::vector<Bone> mBones;
+        std::map<osg::MatrixTransform*, int> mBoneIndices;
 
         typedef std::map<std::string, std::pair<osg::NodePath, osg::MatrixTransform*> > BoneCache;
         BoneCache mBoneCache;
         bool mBoneCacheInit;
 
         bool mNeedToUpdateBoneMatrices;
+        bool mBonesAdded;
 
         bool mActive;
+        bool mFreezeSkinning;
 
         unsigned int mLastFrameNumber;
     };
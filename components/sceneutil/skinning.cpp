@@ -0,0 +1,198 @@
+#include "skinning.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OPENMW_SKINNING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+    const unsigned int sBatchSize = 4;
+
+    // Layout of osg::Matrixf::ptr(): element (row, col) is at row*4+col, and osg transforms row vectors,
+    // so a point is transformed as x * row0 + y * row1 + z * row2 + row3.
+    // The kernels write the first three components of each destination element, \a stride is the number of floats per element.
+
+    void transformScalar(const float* m, const float* const* src, unsigned int first, unsigned int count,
+                         const unsigned short* indices, bool translate, float* dst, unsigned int stride)
+    {
+        const float tx = translate ? m[12] : 0.f;
+        const float ty = translate ? m[13] : 0.f;
+        const float tz = translate ? m[14] : 0.f;
+        for (unsigned int i=first; i<first+count; ++i)
+        {
+            float x = src[0][i];
+            float y = src[1][i];
+            float z = src[2][i];
+            float* out = dst + indices[i] * stride;
+            out[0] = m[0]*x + m[4]*y + m[8]*z + tx;
+            out[1] = m[1]*x + m[5]*y + m[9]*z + ty;
+            out[2] = m[2]*x + m[6]*y + m[10]*z + tz;
+        }
+    }
+
+#ifdef OPENMW_SKINNING_SSE
+    void transformSSE(const float* m, const float* const* src, unsigned int first, unsigned int paddedCount,
+                      const unsigned short* indices, bool translate, float* dst, unsigned int stride)
+    {
+        const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+        const __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+        const __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+        const __m128 m12 = _mm_set1_ps(translate ? m[12] : 0.f);
+        const __m128 m13 = _mm_set1_ps(translate ? m[13] : 0.f);
+        const __m128 m14 = _mm_set1_ps(translate ? m[14] : 0.f);
+
+        float outX[sBatchSize], outY[sBatchSize], outZ[sBatchSize];
+        for (unsigned int i=first; i<first+paddedCount; i+=sBatchSize)
+        {
+            __m128 x = _mm_loadu_ps(&src[0][i]);
+            __m128 y = _mm_loadu_ps(&src[1][i]);
+            __m128 z = _mm_loadu_ps(&src[2][i]);
+
+            _mm_storeu_ps(outX, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m0), _mm_mul_ps(y, m4)), _mm_add_ps(_mm_mul_ps(z, m8), m12)));
+            _mm_storeu_ps(outY, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m1), _mm_mul_ps(y, m5)), _mm_add_ps(_mm_mul_ps(z, m9), m13)));
+            _mm_storeu_ps(outZ, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m2), _mm_mul_ps(y, m6)), _mm_add_ps(_mm_mul_ps(z, m10), m14)));
+
+            // padding lanes repeat the last vertex of the group, so writing them is harmless
+            for (unsigned int j=0; j<sBatchSize; ++j)
+            {
+                float* out = dst + indices[i+j] * stride;
+                out[0] = outX[j];
+                out[1] = outY[j];
+                out[2] = outZ[j];
+            }
+        }
+    }
+#endif
+}
+
+namespace SceneUtil
+{
+
+#ifdef OPENMW_SKINNING_SSE
+    SkinnedVertices::Kernel SkinnedVertices::sKernel = SkinnedVertices::Kernel_SSE;
+#else
+    SkinnedVertices::Kernel SkinnedVertices::sKernel = SkinnedVertices::Kernel_Scalar;
+#endif
+
+    void SkinnedVertices::setKernel(Kernel kernel)
+    {
+        sKernel = isKernelSupported(kernel) ? kernel : Kernel_Scalar;
+    }
+
+    SkinnedVertices::Kernel SkinnedVertices::getKernel()
+    {
+        return sKernel;
+    }
+
+    bool SkinnedVertices::isKernelSupported(Kernel kernel)
+    {
+#ifdef OPENMW_SKINNING_SSE
+        return kernel == Kernel_Scalar || kernel == Kernel_SSE;
+#else
+        return kernel == Kernel_Scalar;
+#endif
+    }
+
+    SkinnedVertices::SkinnedVertices()
+        : mHasNormals(false)
+        , mHasTangents(false)
+    {
+    }
+
+    unsigned int SkinnedVertices::addGroup(const std::vector<unsigned short>& vertices, const osg::Vec3Array* positions,
+                                           const osg::Vec3Array* normals, const osg::Vec4Array* tangents)
+    {
+        Group group;
+        group.mFirst = mIndices.size();
+        group.mCount = vertices.size();
+        group.mPaddedCount = (group.mCount + sBatchSize - 1) / sBatchSize * sBatchSize;
+        mGroups.push_back(group);
+
+        mHasNormals = normals != NULL;
+        mHasTangents = tangents != NULL;
+
+        for (unsigned int i=0; i<group.mPaddedCount; ++i)
+        {
+            unsigned short vertex = vertices[std::min(i, group.mCount-1)];
+            mIndices.push_back(vertex);
+
+            const osg::Vec3f& position = (*positions)[vertex];
+            for (int c=0; c<3; ++c)
+                mPositions[c].push_back(position[c]);
+
+            if (normals)
+            {
+                const osg::Vec3f& normal = (*normals)[vertex];
+                for (int c=0; c<3; ++c)
+                    mNormals[c].push_back(normal[c]);
+            }
+
+            // the w component of tangents is not affected by skinning
+            if (tangents)
+            {
+                const osg::Vec4f& tangent = (*tangents)[vertex];
+                for (int c=0; c<3; ++c)
+                    mTangents[c].push_back(tangent[c]);
+            }
+        }
+
+        return mGroups.size()-1;
+    }
+
+    unsigned int SkinnedVertices::getNumGroups() const
+    {
+        return mGroups.size();
+    }
+
+    void SkinnedVertices::transform(unsigned int group, const osg::Matrixf &matrix,
+                                    osg::Vec3Array *positions, osg::Vec3Array *normals, osg::Vec4Array *tangents) const
+    {
+        transform(group, matrix, positions, normals, tangents, sKernel);
+    }
+
+    void SkinnedVertices::transform(unsigned int groupIndex, const osg::Matrixf &matrix,
+                                    osg::Vec3Array *positions, osg::Vec3Array *normals, osg::Vec4Array *tangents, Kernel kernel) const
+    {
+        const Group& group = mGroups[groupIndex];
+        if (group.mCount == 0)
+            return;
+
+        const float* m = matrix.ptr();
+
+        const float* positionSrc[3] = { &mPositions[0][0], &mPositions[1][0], &mPositions[2][0] };
+        const float* normalSrc[3] = { NULL, NULL, NULL };
+        if (mHasNormals && normals)
+        {
+            for (int c=0; c<3; ++c)
+                normalSrc[c] = &mNormals[c][0];
+        }
+        const float* tangentSrc[3] = { NULL, NULL, NULL };
+        if (mHasTangents && tangents)
+        {
+            for (int c=0; c<3; ++c)
+                tangentSrc[c] = &mTangents[c][0];
+        }
+
+#ifdef OPENMW_SKINNING_SSE
+        if (kernel == Kernel_SSE)
+        {
+            transformSSE(m, positionSrc, group.mFirst, group.mPaddedCount, &mIndices[0], true, (*positions)[0].ptr(), 3);
+            if (normalSrc[0])
+                transformSSE(m, normalSrc, group.mFirst, group.mPaddedCount, &mIndices[0], false, (*normals)[0].ptr(), 3);
+            if (tangentSrc[0])
+                transformSSE(m, tangentSrc, group.mFirst, group.mPaddedCount, &mIndices[0], false, (*tangents)[0].ptr(), 4);
+            return;
+        }
+#endif
+
+        transformScalar(m, positionSrc, group.mFirst, group.mCount, &mIndices[0], true, (*positions)[0].ptr(), 3);
+        if (normalSrc[0])
+            transformScalar(m, normalSrc, group.mFirst, group.mCount, &mIndices[0], false, (*normals)[0].ptr(), 3);
+        if (tangentSrc[0])
+            transformScalar(m, tangentSrc, group.mFirst, group.mCount, &mIndices[0], false, (*tangents)[0].ptr(), 4);
+    }
+
+}
@@ -0,0 +1,79 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_SKINNING_H
+#define OPENMW_COMPONENTS_SCENEUTIL_SKINNING_H
+
+#include <vector>
+
+#include <osg/Array>
+#include <osg/Matrixf>
+
+namespace SceneUtil
+{
+
+    /// @brief Source vertices of a skinned mesh, in a structure-of-arrays layout suited for batched transformation.
+    /// @par Vertices are partitioned into groups that are influenced by the same bones with the same weights, and thus
+    /// share a skinning matrix. The vertices of a group are stored contiguously, padded to a multiple of the batch size
+    /// by repeating the last vertex of the group.
+    class SkinnedVertices
+    {
+    public:
+        enum Kernel
+        {
+            Kernel_Scalar,
+            Kernel_SSE ///< Transforms four vertices at a time, only available on builds targeting SSE capable CPUs
+        };
+
+        /// Set the kernel used by transform(). Unsupported kernels fall back to Kernel_Scalar.
+        /// @note Not thread safe, should be called before any rendering takes place.
+        static void setKernel(Kernel kernel);
+        static Kernel getKernel();
+
+        static bool isKernelSupported(Kernel kernel);
+
+        SkinnedVertices();
+
+        /// Add a group of vertices sharing the same skinning matrix.
+        /// @param normals May be NULL.
+        /// @param tangents May be NULL.
+        /// @return The index of the new group.
+        unsigned int addGroup(const std::vector<unsigned short>& vertices, const osg::Vec3Array* positions,
+                              const osg::Vec3Array* normals, const osg::Vec4Array* tangents);
+
+        unsigned int getNumGroups() const;
+
+        /// Transform the vertices of a group by an affine matrix, and write them to the given arrays at
+        /// the vertices' original indices. Normals and tangents are only written if they were added.
+        /// The w component of tangents is left unchanged.
+        void transform(unsigned int group, const osg::Matrixf& matrix,
+                       osg::Vec3Array* positions, osg::Vec3Array* normals, osg::Vec4Array* tangents) const;
+
+        /// Transform using the given kernel rather than the one set with setKernel(), for benchmarking.
+        void transform(unsigned int group, const osg::Matrixf& matrix,
+                       osg::Vec3Array* positions, osg::Vec3Array* normals, osg::Vec4Array* tangents, Kernel kernel) const;
+
+    private:
+        struct Group
+        {
+            unsigned int mFirst;
+            unsigned int mCount;
+            unsigned int mPaddedCount;
+        };
+
+        std::vector<Group> mGroups;
+
+        // original index of each vertex
+        std::vector<unsigned short> mIndices;
+
+        // one array per component
+        std::vector<float> mPositions[3];
+        std::vector<float> mNormals[3];
+        std::vector<float> mTangents[3];
+
+        bool mHasNormals;
+        bool mHasTangents;
+
+        static Kernel sKernel;
+    };
+
+}
+
+#endif
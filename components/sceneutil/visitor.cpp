@@ -1,5 +1,6 @@
 #include "visitor.hpp"
 
+#include <osg/Geometry>
 #include <osg/MatrixTransform>
 
 #include <osgParticle/ParticleSystem>
@@ -46,4 +47,52 @@ namespace SceneUtil
             partsys->setFreezeOnCull(false);
     }
 
+    void MemoryUsageVisitor::apply(osg::Node &node)
+    {
+        mSize += sizeof(osg::Group);
+        countStateSet(node.getStateSet());
+        traverse(node);
+    }
+
+    void MemoryUsageVisitor::apply(osg::Drawable &drw)
+    {
+        if (!mCounted.insert(&drw).second)
+            return;
+
+        mSize += sizeof(osg::Geometry);
+        countStateSet(drw.getStateSet());
+
+        osg::Geometry* geom = drw.asGeometry();
+        if (!geom)
+            return;
+
+        countData(geom->getVertexArray());
+        countData(geom->getNormalArray());
+        countData(geom->getColorArray());
+        countData(geom->getSecondaryColorArray());
+        countData(geom->getFogCoordArray());
+        for (unsigned int i=0; i<geom->getNumTexCoordArrays(); ++i)
+            countData(geom->getTexCoordArray(i));
+        for (unsigned int i=0; i<geom->getNumVertexAttribArrays(); ++i)
+            countData(geom->getVertexAttribArray(i));
+        for (unsigned int i=0; i<geom->getNumPrimitiveSets(); ++i)
+            countData(geom->getPrimitiveSet(i));
+    }
+
+    void MemoryUsageVisitor::countStateSet(osg::StateSet *stateset)
+    {
+        if (!stateset || !mCounted.insert(stateset).second)
+            return;
+
+        mSize += sizeof(osg::StateSet);
+    }
+
+    void MemoryUsageVisitor::countData(const osg::BufferData *data)
+    {
+        if (!data || !mCounted.insert(data).second)
+            return;
+
+        mSize += data->getTotalDataSize();
+    }
+
 }
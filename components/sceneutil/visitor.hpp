@@ -3,6 +3,13 @@
 
 #include <osg/NodeVisitor>
 
+#include <set>
+
+namespace osg
+{
+    class BufferData;
+}
+
 // Commonly used scene graph visitors
 namespace SceneUtil
 {
@@ -44,6 +51,30 @@ namespace SceneUtil
         virtual void apply(osg::Drawable& drw);
     };
 
+    // Estimate the memory used by the visited nodes, their geometry arrays and primitives, in bytes
+    // Texture images are not counted, as they are owned by the ImageManager
+    // Objects that are shared between nodes are counted once
+    class MemoryUsageVisitor : public osg::NodeVisitor
+    {
+    public:
+        MemoryUsageVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mSize(0)
+        {
+        }
+
+        virtual void apply(osg::Node& node);
+
+        virtual void apply(osg::Drawable& drw);
+
+        void countStateSet(osg::StateSet* stateset);
+
+        void countData(const osg::BufferData* data);
+
+        size_t mSize;
+        std::set<const osg::Referenced*> mCounted;
+    };
+
 }
 
 #endif
@@ -1,6 +1,10 @@
 #include "workqueue.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
 
 namespace SceneUtil
 {
@@ -19,14 +23,24 @@ void WorkItem::waitTillDone()
 
 void WorkItem::signalDone()
 {
+    std::vector<osg::ref_ptr<WorkItem> > dependents;
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
         mDone.exchange(1);
+        dependents.swap(mDependents);
     }
     mCondition.broadcast();
+
+    for (std::vector<osg::ref_ptr<WorkItem> >::const_iterator it = dependents.begin(); it != dependents.end(); ++it)
+        (*it)->dependencyDone();
 }
 
 WorkItem::WorkItem()
+    : mPriority(WorkQueue::Priority_Normal)
+    , mNumPendingDependencies(0)
+    , mWaitingQueue(NULL)
+    , mFront(false)
+    , mQueueTick(0)
 {
 }
 
@@ -39,12 +53,83 @@ bool WorkItem::isDone() const
     return (mDone > 0);
 }
 
+void WorkItem::setPriority(int priority)
+{
+    mPriority = priority;
+}
+
+int WorkItem::getPriority() const
+{
+    return mPriority;
+}
+
+void WorkItem::cancel()
+{
+    mCanceled.exchange(1);
+    abort();
+}
+
+bool WorkItem::isCanceled() const
+{
+    return (mCanceled > 0);
+}
+
+void WorkItem::addDependency(WorkItem *item)
+{
+    // lock order is dependency before dependent, same as in signalDone()
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(item->mMutex);
+    if (item->mDone > 0)
+        return;
+    item->mDependents.push_back(this);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(mMutex);
+    ++mNumPendingDependencies;
+}
+
+void WorkItem::dependencyDone()
+{
+    WorkQueue* queue = NULL;
+    bool front = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        if (--mNumPendingDependencies == 0)
+        {
+            queue = mWaitingQueue;
+            front = mFront;
+            mWaitingQueue = NULL;
+        }
+    }
+    if (queue)
+        queue->enqueue(this, front);
+}
+
+struct WorkQueue::ItemQueue
+{
+    OpenThreads::Mutex mMutex;
+    typedef std::map<int, std::deque<osg::ref_ptr<WorkItem> >, std::greater<int> > ItemMap;
+    // non-empty deques of items, highest priority first
+    ItemMap mItems;
+};
+
+WorkQueue::Stats::Stats()
+    : mNumStarted(0)
+    , mNumStolen(0)
+    , mTotalWaitTime(0.0)
+    , mMaxWaitTime(0.0)
+{
+}
+
 WorkQueue::WorkQueue(int workerThreads)
     : mIsReleased(false)
+    , mNumItems(0)
+    , mNextQueue(0)
 {
+    for (int i=0; i<workerThreads; ++i)
+        mQueues.push_back(new ItemQueue);
+
     for (int i=0; i<workerThreads; ++i)
     {
-        WorkThread* thread = new WorkThread(this);
+        WorkThread* thread = new WorkThread(this, i);
         mThreads.push_back(thread);
         thread->startThread();
     }
@@ -54,17 +139,25 @@ WorkQueue::~WorkQueue()
 {
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-        while (!mQueue.empty())
-            mQueue.pop_back();
         mIsReleased = true;
+        mNumItems = 0;
         mCondition.broadcast();
     }
 
+    for (unsigned int i=0; i<mQueues.size(); ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mQueues[i]->mMutex);
+        mQueues[i]->mItems.clear();
+    }
+
     for (unsigned int i=0; i<mThreads.size(); ++i)
     {
         mThreads[i]->join();
         delete mThreads[i];
     }
+
+    for (unsigned int i=0; i<mQueues.size(); ++i)
+        delete mQueues[i];
 }
 
 void WorkQueue::addWorkItem(osg::ref_ptr<WorkItem> item, bool front)
@@ -75,35 +168,139 @@ void WorkQueue::addWorkItem(osg::ref_ptr<WorkItem> item, bool front)
         return;
     }
 
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(item->mMutex);
+        if (item->mNumPendingDependencies > 0)
+        {
+            // queued by the last dependency to complete
+            item->mWaitingQueue = this;
+            item->mFront = front;
+            return;
+        }
+    }
+
+    enqueue(item, front);
+}
+
+void WorkQueue::enqueue(osg::ref_ptr<WorkItem> item, bool front)
+{
+    if (mQueues.empty())
+        return;
+
+    // work added by a work thread likely depends on that thread's data, so keep it local
+    unsigned int queueIndex = mQueues.size();
+    OpenThreads::Thread* current = OpenThreads::Thread::CurrentThread();
+    for (unsigned int i=0; i<mThreads.size(); ++i)
+    {
+        if (mThreads[i] == current)
+            queueIndex = i;
+    }
+    if (queueIndex == mQueues.size())
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        queueIndex = mNextQueue;
+        mNextQueue = (mNextQueue + 1) % mQueues.size();
+    }
+
+    item->mQueueTick = osg::Timer::instance()->tick();
+
+    {
+        ItemQueue* queue = mQueues[queueIndex];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue->mMutex);
+        std::deque<osg::ref_ptr<WorkItem> >& items = queue->mItems[item->getPriority()];
+        if (front)
+            items.push_front(item);
+        else
+            items.push_back(item);
+    }
+
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    if (front)
-        mQueue.push_front(item);
-    else
-        mQueue.push_back(item);
+    if (mIsReleased)
+        return;
+    ++mNumItems;
     mCondition.signal();
 }
 
-osg::ref_ptr<WorkItem> WorkQueue::removeWorkItem()
+osg::ref_ptr<WorkItem> WorkQueue::takeItem(unsigned int thread, bool& stolen)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    while (mQueue.empty() && !mIsReleased)
+    // find the queue with the highest priority item, starting with the thread's own queue so it wins ties
+    int bestQueue = -1;
+    int bestPriority = 0;
+    for (unsigned int i=0; i<mQueues.size(); ++i)
     {
-        mCondition.wait(&mMutex);
+        unsigned int index = (thread + i) % mQueues.size();
+        ItemQueue* queue = mQueues[index];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue->mMutex);
+        if (queue->mItems.empty())
+            continue;
+        int priority = queue->mItems.begin()->first;
+        if (bestQueue == -1 || priority > bestPriority)
+        {
+            bestQueue = index;
+            bestPriority = priority;
+        }
     }
-    if (!mQueue.empty())
+
+    if (bestQueue == -1)
+        return NULL;
+
+    // another thread may have taken the item in the meantime, in which case the caller retries
+    ItemQueue* queue = mQueues[bestQueue];
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queue->mMutex);
+    if (queue->mItems.empty())
+        return NULL;
+
+    ItemQueue::ItemMap::iterator first = queue->mItems.begin();
+    osg::ref_ptr<WorkItem> item = first->second.front();
+    first->second.pop_front();
+    if (first->second.empty())
+        queue->mItems.erase(first);
+
+    stolen = (static_cast<unsigned int>(bestQueue) != thread);
+    return item;
+}
+
+osg::ref_ptr<WorkItem> WorkQueue::removeWorkItem(unsigned int thread)
+{
     {
-        osg::ref_ptr<WorkItem> item = mQueue.front();
-        mQueue.pop_front();
-        return item;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        while (mNumItems == 0 && !mIsReleased)
+        {
+            mCondition.wait(&mMutex);
+        }
+        if (mIsReleased)
+            return NULL;
+
+        // claim one of the queued items, so that it can not be taken by any other thread
+        --mNumItems;
+    }
+
+    while (true)
+    {
+        bool stolen = false;
+        osg::ref_ptr<WorkItem> item = takeItem(thread, stolen);
+        if (item)
+        {
+            double waitTime = osg::Timer::instance()->delta_s(item->mQueueTick, osg::Timer::instance()->tick());
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mStatsMutex);
+            ++mStats.mNumStarted;
+            if (stolen)
+                ++mStats.mNumStolen;
+            mStats.mTotalWaitTime += waitTime;
+            mStats.mMaxWaitTime = std::max(mStats.mMaxWaitTime, waitTime);
+            return item;
+        }
+        if (mIsReleased)
+            return NULL;
+        OpenThreads::Thread::YieldCurrentThread();
     }
-    else
-        return NULL;
 }
 
 unsigned int WorkQueue::getNumItems() const
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-    return mQueue.size();
+    return mNumItems;
 }
 
 unsigned int WorkQueue::getNumActiveThreads() const
@@ -117,8 +314,18 @@ unsigned int WorkQueue::getNumActiveThreads() const
     return count;
 }
 
-WorkThread::WorkThread(WorkQueue *workQueue)
+WorkQueue::Stats WorkQueue::takeStats()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mStatsMutex);
+    Stats stats = mStats;
+    mStats = Stats();
+    return stats;
+}
+
+WorkThread::WorkThread(WorkQueue *workQueue, unsigned int index)
     : mWorkQueue(workQueue)
+    , mIndex(index)
+    , mActive(false)
 {
 }
 
@@ -126,11 +333,12 @@ void WorkThread::run()
 {
     while (true)
     {
-        osg::ref_ptr<WorkItem> item = mWorkQueue->removeWorkItem();
+        osg::ref_ptr<WorkItem> item = mWorkQueue->removeWorkItem(mIndex);
         if (!item)
             return;
         mActive = true;
-        item->doWork();
+        if (!item->isCanceled())
+            item->doWork();
         item->signalDone();
         mActive = false;
     }
@@ -8,12 +8,15 @@
 
 #include <osg/Referenced>
 #include <osg/ref_ptr>
+#include <osg/Timer>
 
-#include <queue>
+#include <vector>
 
 namespace SceneUtil
 {
 
+    class WorkQueue;
+
     class WorkItem : public osg::Referenced
     {
     public:
@@ -34,52 +37,126 @@ namespace SceneUtil
         /// Set abort flag in order to return from doWork() as soon as possible. May not be respected by all WorkItems.
         virtual void abort() {}
 
+        /// Items with a higher priority are started before items with a lower priority. The default is WorkQueue::Priority_Normal.
+        /// @note Has no effect once the item was added to a WorkQueue.
+        void setPriority(int priority);
+        int getPriority() const;
+
+        /// If the item was not started yet, it will be completed without calling doWork(). Otherwise, calls abort().
+        void cancel();
+        bool isCanceled() const;
+
+        /// Do not start this item before \a item is done. Must be called before this item is added to a WorkQueue.
+        /// @note A canceled dependency still counts as done.
+        void addDependency(WorkItem* item);
+
     protected:
         OpenThreads::Atomic mDone;
         OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
+
+    private:
+        friend class WorkQueue;
+
+        /// Called when one of the items this item depends on is done.
+        void dependencyDone();
+
+        int mPriority;
+        OpenThreads::Atomic mCanceled;
+
+        // guarded by mMutex
+        unsigned int mNumPendingDependencies;
+        std::vector<osg::ref_ptr<WorkItem> > mDependents;
+        WorkQueue* mWaitingQueue;
+        bool mFront;
+
+        osg::Timer_t mQueueTick;
     };
 
     class WorkThread;
 
     /// @brief A work queue that users can push work items onto, to be completed by one or more background threads.
-    /// @note Work items will be processed in the order that they were given in, however
+    /// @par Each thread has its own queue of items, ordered by priority. Items added from outside of the work threads are
+    /// distributed over the queues, items added from within a work thread go to that thread's queue. A thread takes the
+    /// highest priority item available in any of the queues, preferring its own queue, so idle threads steal work from busy ones.
+    /// @note Items of the same priority are started in the order that they were given in, however
     /// if multiple work threads are involved then it is possible for a later item to complete before earlier items.
     class WorkQueue : public osg::Referenced
     {
     public:
+        enum Priority
+        {
+            /// Speculative work whose result may never be needed, e.g. drawing distant objects.
+            Priority_Low = -10,
+            Priority_Normal = 0,
+            /// Work that the game is likely to wait for soon, e.g. preloading the cells the player is about to enter.
+            Priority_High = 10
+        };
+
         WorkQueue(int numWorkerThreads=1);
         ~WorkQueue();
 
-        /// Add a new work item to the back of the queue.
+        /// Add a new work item to the queue. The item is queued once all of its dependencies are done.
         /// @par The work item's waitTillDone() method may be used by the caller to wait until the work is complete.
-        /// @param front If true, add item to the front of the queue. If false (default), add to the back.
+        /// @param front If true, add item in front of the queued items of the same priority. If false (default), add behind them.
         void addWorkItem(osg::ref_ptr<WorkItem> item, bool front=false);
 
-        /// Get the next work item from the front of the queue. If the queue is empty, waits until a new item is added.
+        /// Get the next work item for the given thread. If no items are queued, waits until a new item is added.
         /// If the workqueue is in the process of being destroyed, may return NULL.
         /// @par Used internally by the WorkThread.
-        osg::ref_ptr<WorkItem> removeWorkItem();
+        osg::ref_ptr<WorkItem> removeWorkItem(unsigned int thread);
 
         unsigned int getNumItems() const;
 
         unsigned int getNumActiveThreads() const;
 
+        struct Stats
+        {
+            Stats();
+
+            /// Number of items started since the statistics were last taken.
+            unsigned int mNumStarted;
+            /// Number of the started items that were taken from the queue of another thread.
+            unsigned int mNumStolen;
+            /// Time in seconds the started items spent in the queue.
+            double mTotalWaitTime;
+            double mMaxWaitTime;
+        };
+
+        /// Return the statistics of the items started since the previous call, and reset them.
+        Stats takeStats();
+
     private:
-        bool mIsReleased;
-        std::deque<osg::ref_ptr<WorkItem> > mQueue;
+        friend class WorkItem;
+
+        struct ItemQueue;
+
+        /// Add an item whose dependencies are done to one of the thread queues.
+        void enqueue(osg::ref_ptr<WorkItem> item, bool front);
+
+        /// Take the highest priority item from the thread queues, preferring the queue of the given thread.
+        osg::ref_ptr<WorkItem> takeItem(unsigned int thread, bool& stolen);
+
+        volatile bool mIsReleased;
+        // number of queued items that no thread has claimed yet
+        unsigned int mNumItems;
+        unsigned int mNextQueue;
 
         mutable OpenThreads::Mutex mMutex;
         OpenThreads::Condition mCondition;
 
+        std::vector<ItemQueue*> mQueues;
         std::vector<WorkThread*> mThreads;
+
+        OpenThreads::Mutex mStatsMutex;
+        Stats mStats;
     };
 
     /// Internally used by WorkQueue.
     class WorkThread : public OpenThreads::Thread
     {
     public:
-        WorkThread(WorkQueue* workQueue);
+        WorkThread(WorkQueue* workQueue, unsigned int index);
 
         virtual void run();
 
@@ -87,6 +164,7 @@ namespace SceneUtil
 
     private:
         WorkQueue* mWorkQueue;
+        unsigned int mIndex;
         volatile bool mActive;
     };
 
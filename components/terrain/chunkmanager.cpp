@@ -11,6 +11,7 @@
 
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/lightmanager.hpp>
+#include <components/sceneutil/visitor.hpp>
 
 #include "terraindrawable.hpp"
 #include "material.hpp"
@@ -45,7 +46,11 @@ osg::ref_ptr<osg::Node> ChunkManager::getChunk(float size, const osg::Vec2f &cen
     else
     {
         osg::ref_ptr<osg::Node> node = createChunk(size, center, lod, lodFlags);
-        mCache->addEntryToObjectCache(id, node.get());
+
+        SceneUtil::MemoryUsageVisitor memoryUsageVisitor;
+        node->accept(memoryUsageVisitor);
+
+        mCache->addEntryToObjectCache(id, node.get(), 0.0, memoryUsageVisitor.mSize);
         return node;
     }
 }